@@ -0,0 +1,103 @@
+#include "diagnostic_scanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace shadercompile::detail;
+
+// Measures how fast the scalar and the SIMD diagnostic scanners split synthetic dxc output into messages and find their
+// fields. Both scanners have to produce the same spans.
+//
+// usage: shadercompile_diagnostic_bench [output megabytes] [iterations]
+
+std::string makeSyntheticOutput(size_t byteCount)
+{
+    std::string output;
+    output.reserve(byteCount + 512);
+
+    for(size_t messageIndex = 0; output.size() < byteCount; ++messageIndex)
+    {
+        const std::string path = "C:\\Users\\test\\shaders\\permutation_" + std::to_string(messageIndex % 97) + ".hlsl";
+        const std::string line = std::to_string(10 + messageIndex % 400);
+        const std::string column = std::to_string(1 + messageIndex % 80);
+
+        switch(messageIndex % 4)
+        {
+        case 0:
+        case 1:
+            output += path + ":" + line + ":" + column +
+                      ": warning: implicit truncation of vector type [-Wconversion]\n"
+                      "    output.clipPosition = mul(gObjectToClip, float4(input.position, 1.0));\n"
+                      "                          ^\n";
+            break;
+        case 2:
+            output += path + ":" + line + ": error: Not all elements of SV_Position were written.\r\n";
+            break;
+        default: output += "error: validation errors\n\nValidation failed.\n"; break;
+        }
+    }
+
+    return output;
+}
+
+bool equalSpans(const DiagnosticSpans& left, const DiagnosticSpans& right)
+{
+    return left.messageOffsets == right.messageOffsets && left.messageSizes == right.messageSizes &&
+           left.colonStarts == right.colonStarts && left.colonOffsets == right.colonOffsets;
+}
+
+// the best of several runs, in megabytes per second
+double measureThroughput(std::string_view output, DiagnosticScanner scanner, int iterations, DiagnosticSpans& spans)
+{
+    double bestSeconds = 0.0;
+
+    for(int iteration = 0; iteration < iterations; ++iteration)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        scanDiagnostics(output, spans, scanner);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+        if(iteration == 0 || elapsed.count() < bestSeconds) { bestSeconds = elapsed.count(); }
+    }
+
+    return (output.size() / (1024.0 * 1024.0)) / bestSeconds;
+}
+
+int main(int argc, char** argv)
+{
+    const int megabytes = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 16;
+    const int iterations = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 20;
+
+    const std::string output = makeSyntheticOutput((size_t)megabytes * 1024 * 1024);
+
+    DiagnosticSpans scalarSpans;
+    DiagnosticSpans bestSpans;
+
+    const DiagnosticScanner bestScanner = bestDiagnosticScanner();
+
+    const double scalarRate = measureThroughput(output, DiagnosticScanner::Scalar, iterations, scalarSpans);
+    const double bestRate = measureThroughput(output, bestScanner, iterations, bestSpans);
+
+    if(!equalSpans(scalarSpans, bestSpans))
+    {
+        std::cout << "the scanners found different spans" << std::endl;
+        return 1;
+    }
+
+    std::cout << output.size() << " bytes, " << scalarSpans.size() << " messages, " << scalarSpans.colonOffsets.size()
+              << " colons" << std::endl;
+    std::cout << "scanner  MB/s" << std::endl;
+    std::cout << "scalar\t " << scalarRate << std::endl;
+
+    if(bestScanner != DiagnosticScanner::Scalar)
+    {
+        std::cout << ((bestScanner == DiagnosticScanner::Sse2) ? "sse2" : "neon") << "\t " << bestRate << std::endl;
+        std::cout << "speedup  " << (bestRate / scalarRate) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <shadercompile/dxc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace shadercompile;
+
+// Measures DxcLibraryCompiler throughput with 1..N threads, each thread owning its own compiler. With per-thread DXC
+// instances the compiles/second should grow close to linearly with the thread count until the cores run out.
+//
+// usage: shadercompile_scaling_bench [compiles per thread] [max threads]
+
+constexpr std::string_view kVertexHlsl = R"(struct IAInput {
+    float3 position : POSITION;
+    float3 normal : NORMAL;
+    float2 texCoord: TEXCOORD0;
+};
+
+float4x4 gObjectToClip;
+
+struct VertexOutput {
+    float4 clipPosition : SV_POSITION;
+    float2 texCoord : TEXCOORD0;
+};
+
+VertexOutput main(IAInput input) {
+    VertexOutput output;
+    output.clipPosition = mul(gObjectToClip, float4(input.position, 1.0));
+    output.texCoord = input.texCoord;
+
+    return output;
+})";
+
+bool compileOnce(DxcLibraryCompiler& compiler)
+{
+    compiler.reset();
+    compiler.setTargetProfile(DxcTargetProfile::vs_6_7);
+    compiler.setEntryPoint("main");
+    compiler.enableArtifactWithMemorySink(DxcArtifactType::Object);
+
+    tl::expected<CompileSummary, std::errc> summary =
+        compiler.compileFromBuffer(std::as_bytes(std::span<const char>(kVertexHlsl)), std::string_view("vertex.hlsl"));
+
+    return summary && summary->errorCount == 0;
+}
+
+double measureCompilesPerSecond(int threadCount, int compilesPerThread)
+{
+    std::atomic<int> readyCount = 0;
+    std::atomic<bool> start = false;
+    std::atomic<int> failureCount = 0;
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    for(int threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                DxcLibraryCompiler compiler;
+
+                // the first compile creates this thread's DXC instances, keep it out of the timed region
+                if(!compileOnce(compiler)) { ++failureCount; }
+
+                ++readyCount;
+                while(!start.load()) { std::this_thread::yield(); }
+
+                for(int compileIndex = 0; compileIndex < compilesPerThread; ++compileIndex)
+                {
+                    if(!compileOnce(compiler)) { ++failureCount; }
+                }
+            });
+    }
+
+    while(readyCount.load() != threadCount) { std::this_thread::yield(); }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    start = true;
+
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    if(failureCount.load() != 0) { std::cout << "  " << failureCount.load() << " compiles failed" << std::endl; }
+
+    return (threadCount * compilesPerThread) / elapsed.count();
+}
+
+int main(int argc, char** argv)
+{
+    const int compilesPerThread = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 200;
+    const int maxThreads =
+        (argc > 2) ? std::max(1, std::atoi(argv[2])) : std::max(1, (int)std::thread::hardware_concurrency());
+
+    std::cout << "threads  compiles/s  speedup  efficiency" << std::endl;
+
+    double singleThreadRate = 0.0;
+
+    std::vector<int> threadCounts;
+
+    for(int threadCount = 1; threadCount < maxThreads; threadCount *= 2)
+    {
+        threadCounts.push_back(threadCount);
+    }
+
+    threadCounts.push_back(maxThreads);
+
+    for(const int threadCount : threadCounts)
+    {
+        const double rate = measureCompilesPerSecond(threadCount, compilesPerThread);
+
+        if(threadCount == 1) { singleThreadRate = rate; }
+
+        const double speedup = rate / singleThreadRate;
+
+        std::cout << threadCount << "\t " << rate << "\t     " << speedup << "\t      " << (speedup / threadCount)
+                  << std::endl;
+    }
+
+    return 0;
+}
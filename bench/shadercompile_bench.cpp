@@ -0,0 +1,478 @@
+#include "process.h"
+#include "utility.h"
+
+#include <benchmark/benchmark.h>
+#include <shadercompile/dxc.h>
+
+#ifndef _WIN32
+#include <stdlib.h>
+#endif
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace shadercompile;
+
+// Microbenchmarks of the hot paths that do not need a real DXC: message parsing, string conversion, argument building,
+// process round trips against a stub compiler and cache hits. The results are written as JSON unless another
+// --benchmark_format is given, so runs can be compared with Google Benchmark's compare.py.
+//
+// usage: shadercompile_bench [google benchmark flags]
+
+namespace
+{
+// exposes the message parser that compiles run on dxc's output
+struct MessageParser : DxcExternalCompiler
+{
+    using DxcExternalCompiler::DxcExternalCompiler;
+    using BaseDxcCompiler::parseCompilerMessages;
+};
+
+constexpr size_t kMaxMessageCount = 1024;
+
+constexpr std::string_view kVertexHlsl = R"(struct IAInput {
+    float3 position : POSITION;
+    float2 texCoord: TEXCOORD0;
+};
+
+float4x4 gObjectToClip;
+
+struct VertexOutput {
+    float4 clipPosition : SV_POSITION;
+    float2 texCoord : TEXCOORD0;
+};
+
+VertexOutput main(IAInput input) {
+    VertexOutput output;
+    output.clipPosition = mul(gObjectToClip, float4(input.position, 1.0));
+    output.texCoord = input.texCoord;
+
+    return output;
+})";
+
+enum class OutputKind
+{
+    Clean,
+    SingleError,
+    ManyWarnings,
+    CrLf,
+    Unparsed,
+};
+
+std::string makeCompilerOutput(OutputKind kind)
+{
+    std::string output;
+
+    switch(kind)
+    {
+    case OutputKind::Clean: break;
+    case OutputKind::SingleError:
+        output = "C:\\shaders\\vertex.hlsl:14:5: error: use of undeclared identifier 'outptu'\n"
+                 "    outptu.texCoord = input.texCoord;\n"
+                 "    ^\n";
+        break;
+    case OutputKind::ManyWarnings:
+        for(int messageIndex = 0; messageIndex < 200; ++messageIndex)
+        {
+            output += "C:\\shaders\\common.hlsli:" + std::to_string(10 + messageIndex) + ":" +
+                      std::to_string(1 + messageIndex % 80) +
+                      ": warning: implicit truncation of vector type [-Wconversion]\n"
+                      "    output.clipPosition = mul(gObjectToClip, float4(input.position, 1.0));\n"
+                      "                          ^\n";
+        }
+        break;
+    case OutputKind::CrLf:
+        for(int messageIndex = 0; messageIndex < 200; ++messageIndex)
+        {
+            output += "C:\\shaders\\pixel.hlsl:" + std::to_string(10 + messageIndex) +
+                      ": error: Not all elements of SV_Target were written.\r\n";
+        }
+        break;
+    case OutputKind::Unparsed:
+        for(int messageIndex = 0; messageIndex < 200; ++messageIndex)
+        {
+            output += "error: validation errors\n\nValidation failed.\n";
+        }
+        break;
+    }
+
+    return output;
+}
+
+void BM_ParseCompilerMessages(benchmark::State& state)
+{
+    const std::string output = makeCompilerOutput((OutputKind)state.range(0));
+
+    size_t messageCount = 0;
+
+    for(auto _ : state)
+    {
+        CompilerMessages messages = MessageParser::parseCompilerMessages(output, kMaxMessageCount);
+        messageCount = messages.size();
+        benchmark::DoNotOptimize(messages);
+    }
+
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)output.size());
+    state.counters["messages"] = (double)messageCount;
+}
+BENCHMARK(BM_ParseCompilerMessages)
+    ->ArgName("kind")
+    ->DenseRange((int64_t)OutputKind::Clean, (int64_t)OutputKind::Unparsed);
+
+std::wstring makeWideText(size_t characterCount, bool ascii)
+{
+    // Latin-1, Cyrillic and CJK characters take two and three UTF-8 bytes
+    constexpr std::wstring_view kAsciiText = L"C:\\shaders\\permutations\\vertex_skinned.hlsl ";
+    constexpr std::wstring_view kMixedText = L"C:\\shaders\\\u00e9clairage\\\u0442\u0435\u043d\u044c\\\u5f71.hlsl ";
+
+    const std::wstring_view pattern = ascii ? kAsciiText : kMixedText;
+
+    std::wstring text;
+    text.reserve(characterCount);
+
+    while(text.size() < characterCount)
+    {
+        text.append(pattern.substr(0, characterCount - text.size()));
+    }
+
+    return text;
+}
+
+void BM_Utf8Encode(benchmark::State& state)
+{
+    const std::wstring wideText = makeWideText((size_t)state.range(0), state.range(1) != 0);
+
+    std::string utf8Text;
+
+    for(auto _ : state)
+    {
+        utf8Encode(wideText, utf8Text);
+        benchmark::DoNotOptimize(utf8Text.data());
+    }
+
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)wideText.size());
+}
+BENCHMARK(BM_Utf8Encode)->ArgNames({"chars", "ascii"})->ArgsProduct({{16, 256, 4096}, {1, 0}});
+
+void BM_Utf8Decode(benchmark::State& state)
+{
+    const std::string utf8Text = utf8Encode(makeWideText((size_t)state.range(0), state.range(1) != 0));
+
+    std::wstring wideText;
+
+    for(auto _ : state)
+    {
+        utf8Decode(utf8Text, wideText);
+        benchmark::DoNotOptimize(wideText.data());
+    }
+
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)utf8Text.size());
+}
+BENCHMARK(BM_Utf8Decode)->ArgNames({"chars", "ascii"})->ArgsProduct({{16, 256, 4096}, {1, 0}});
+
+void BM_ParseTargetProfile(benchmark::State& state)
+{
+    // the first and last profiles, a mixed case one and one that does not exist
+    const std::vector<std::string_view> profiles = {"cs_6_0", "vs_6_7", "LIB_6_X", "ps_9_9"};
+
+    for(auto _ : state)
+    {
+        for(const std::string_view profile : profiles)
+        {
+            benchmark::DoNotOptimize(detail::parseTargetProfile(profile));
+        }
+    }
+
+    state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)profiles.size());
+}
+BENCHMARK(BM_ParseTargetProfile);
+
+void BM_DxcVersionToString(benchmark::State& state)
+{
+    const DxcVersion version{.major = 1, .minor = 7, .micro = 2308, .patch = state.range(0) != 0 ? 1 : 0};
+
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(version.toString());
+    }
+}
+BENCHMARK(BM_DxcVersionToString)->ArgName("patch")->Arg(0)->Arg(1);
+
+CompileRequest makeCompileRequest(size_t defineCount)
+{
+    CompileRequest request;
+    request.source = std::as_bytes(std::span<const char>(kVertexHlsl));
+    request.sourceName = L"vertex.hlsl";
+    request.targetProfile = DxcTargetProfile::vs_6_7;
+    request.entryPoint = L"main";
+    request.enableArtifactWithMemorySink(DxcArtifactType::Object);
+    request.enableArtifactWithMemorySink(DxcArtifactType::Reflection);
+
+    for(size_t defineIndex = 0; defineIndex < defineCount; ++defineIndex)
+    {
+        request.arguments.push_back(L"-DFEATURE_" + std::to_wstring(defineIndex) + L"=1");
+    }
+
+    return request;
+}
+
+void BM_ApplyCompileRequest(benchmark::State& state)
+{
+    const CompileRequest request = makeCompileRequest((size_t)state.range(0));
+
+    // the compiler only builds its command line, dxc is never started
+    DxcExternalCompiler compiler("dxc");
+
+    for(auto _ : state)
+    {
+        detail::applyCompileRequest(compiler, request);
+        benchmark::DoNotOptimize(compiler.arguments().data());
+    }
+}
+BENCHMARK(BM_ApplyCompileRequest)->ArgName("defines")->Arg(0)->Arg(8)->Arg(64);
+
+void BM_AppendDefineArguments(benchmark::State& state)
+{
+    DxcPermutationSet permutationSet;
+
+    for(int64_t axisIndex = 0; axisIndex < state.range(0); ++axisIndex)
+    {
+        (void)permutationSet.addBoolAxis(L"FEATURE_" + std::to_wstring(axisIndex));
+    }
+
+    const DxcPermutationKey lastKey = permutationSet.permutationCount() - 1;
+
+    std::vector<std::wstring> arguments;
+
+    for(auto _ : state)
+    {
+        arguments.clear();
+        permutationSet.appendDefineArguments(lastKey, arguments);
+        benchmark::DoNotOptimize(arguments.data());
+    }
+}
+BENCHMARK(BM_AppendDefineArguments)->ArgName("axes")->Arg(4)->Arg(16)->Arg(48);
+
+#ifndef _WIN32
+// A directory under the temp directory that only the current user can access, created by mkdtemp so that nobody else
+// can have made it first. It is removed with everything in it when the benchmarks exit.
+class PrivateDirectory
+{
+public:
+    PrivateDirectory()
+    {
+        std::string pathTemplate = (std::filesystem::temp_directory_path() / "shadercompile_bench-XXXXXX").string();
+
+        if(mkdtemp(pathTemplate.data()) != nullptr) { mPath = std::move(pathTemplate); }
+    }
+
+    ~PrivateDirectory()
+    {
+        if(mPath.empty()) { return; }
+
+        std::error_code errorCode;
+        std::filesystem::remove_all(mPath, errorCode);
+    }
+
+    PrivateDirectory(const PrivateDirectory&) = delete;
+    PrivateDirectory& operator=(const PrivateDirectory&) = delete;
+
+    // empty when the directory could not be created
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return mPath; }
+
+private:
+    std::filesystem::path mPath;
+};
+
+// A shell script that stands in for dxc. It writes a fake object to the -Fo path and reports one warning, which is
+// enough for the compilers to go through their whole output and artifact handling. The path is empty when the script
+// could not be created, the benchmarks that run it then fail.
+const std::filesystem::path& stubCompilerPath()
+{
+    static const PrivateDirectory directory;
+
+    static const std::filesystem::path path = []()
+    {
+        if(directory.path().empty()) { return std::filesystem::path(); }
+
+        const std::filesystem::path scriptPath = directory.path() / "dxc_stub.sh";
+
+        std::ofstream script(scriptPath, std::ios::trunc);
+        script << "#!/bin/sh\n"
+                  "prev=\"\"\n"
+                  "for arg; do\n"
+                  "  if [ \"$prev\" = \"-Fo\" ]; then printf 'DXIL' > \"$arg\"; fi\n"
+                  "  prev=$arg\n"
+                  "done\n"
+                  "printf '%s\\n' \"vertex.hlsl:1:1: warning: stub compiler\"\n";
+        script.close();
+
+        std::filesystem::permissions(scriptPath,
+                                     std::filesystem::perms::owner_all | std::filesystem::perms::group_read |
+                                         std::filesystem::perms::group_exec,
+                                     std::filesystem::perm_options::replace);
+
+        return scriptPath;
+    }();
+
+    return path;
+}
+
+void BM_ProcessRoundTrip(benchmark::State& state)
+{
+    for(auto _ : state)
+    {
+        Process process(stubCompilerPath());
+        process.addArgument(std::string_view("-T"));
+        process.addArgument(std::string_view("vs_6_7"));
+
+        tl::expected<int, std::errc> result = process.execute();
+
+        if(!result || *result != 0)
+        {
+            state.SkipWithError("the stub compiler failed");
+            break;
+        }
+
+        benchmark::DoNotOptimize(process.output().data());
+    }
+}
+BENCHMARK(BM_ProcessRoundTrip)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// the compiler keeps its arguments across compiles, so every compile starts over from the request
+tl::expected<CompileSummary, std::errc> compileRequest(DxcExternalCompiler& compiler, const CompileRequest& request)
+{
+    detail::applyCompileRequest(compiler, request);
+    return compiler.compileFromBuffer(request.source, request.sourceName);
+}
+
+void BM_ExternalCompileRoundTrip(benchmark::State& state)
+{
+    const CompileRequest request = makeCompileRequest(8);
+
+    DxcExternalCompiler compiler(stubCompilerPath());
+    compiler.setJobServer(nullptr);
+
+    for(auto _ : state)
+    {
+        tl::expected<CompileSummary, std::errc> summary = compileRequest(compiler, request);
+
+        if(!summary || summary->returnCode != 0)
+        {
+            state.SkipWithError("the stub compile failed");
+            break;
+        }
+
+        benchmark::DoNotOptimize(summary->messages.size());
+    }
+}
+BENCHMARK(BM_ExternalCompileRoundTrip)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// compiles once to fill the attached cache, so that every compile after it is a hit
+bool primeCache(DxcExternalCompiler& compiler, const CompileRequest& request)
+{
+    tl::expected<CompileSummary, std::errc> summary = compileRequest(compiler, request);
+    return summary && summary->returnCode == 0;
+}
+
+void BM_ArtifactCacheHit(benchmark::State& state)
+{
+    const CompileRequest request = makeCompileRequest(8);
+
+    auto artifactCache = std::make_shared<DxcArtifactCache>(64 * 1024 * 1024);
+
+    DxcExternalCompiler compiler(stubCompilerPath());
+    compiler.setJobServer(nullptr);
+    compiler.setCompilerVersion(DxcVersion{.major = 1, .minor = 7, .micro = 2308});
+    compiler.setArtifactCache(artifactCache);
+
+    if(!primeCache(compiler, request))
+    {
+        state.SkipWithError("the stub compile failed");
+        return;
+    }
+
+    artifactCache->resetStatistics();
+
+    for(auto _ : state)
+    {
+        tl::expected<CompileSummary, std::errc> summary = compileRequest(compiler, request);
+        benchmark::DoNotOptimize(summary);
+    }
+
+    const DxcArtifactCacheStatistics statistics = artifactCache->statistics();
+    state.counters["hitRate"] = statistics.hitRate();
+}
+BENCHMARK(BM_ArtifactCacheHit)->Unit(benchmark::kMicrosecond);
+
+void BM_CompileCacheHit(benchmark::State& state)
+{
+    const CompileRequest request = makeCompileRequest(8);
+
+    if(stubCompilerPath().empty())
+    {
+        state.SkipWithError("the stub compiler could not be created");
+        return;
+    }
+
+    const std::filesystem::path cacheDirectory = stubCompilerPath().parent_path() / "compile_cache";
+    std::filesystem::remove_all(cacheDirectory);
+
+    auto compileCache = std::make_shared<DxcCompileCache>(cacheDirectory);
+
+    DxcExternalCompiler compiler(stubCompilerPath());
+    compiler.setJobServer(nullptr);
+    compiler.setCompilerVersion(DxcVersion{.major = 1, .minor = 7, .micro = 2308});
+    compiler.setCompileCache(compileCache);
+
+    if(!primeCache(compiler, request))
+    {
+        state.SkipWithError("the stub compile failed");
+        return;
+    }
+
+    compileCache->resetStatistics();
+
+    for(auto _ : state)
+    {
+        tl::expected<CompileSummary, std::errc> summary = compileRequest(compiler, request);
+        benchmark::DoNotOptimize(summary);
+    }
+
+    const DxcCompileCacheStatistics statistics = compileCache->statistics();
+    const uint64_t lookupCount = statistics.hitCount + statistics.missCount;
+    state.counters["hitRate"] = (lookupCount == 0) ? 0.0 : (double)statistics.hitCount / (double)lookupCount;
+}
+BENCHMARK(BM_CompileCacheHit)->Unit(benchmark::kMicrosecond);
+#endif
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<char*> arguments(argv, argv + argc);
+
+    bool hasFormat = false;
+
+    for(const char* argument : arguments)
+    {
+        if(std::string_view(argument).starts_with("--benchmark_format")) { hasFormat = true; }
+    }
+
+    // JSON by default, so the results can be tracked across runs
+    char jsonFormat[] = "--benchmark_format=json";
+    if(!hasFormat) { arguments.push_back(jsonFormat); }
+
+    int argumentCount = (int)arguments.size();
+
+    benchmark::Initialize(&argumentCount, arguments.data());
+    if(benchmark::ReportUnrecognizedArguments(argumentCount, arguments.data())) { return 1; }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return 0;
+}
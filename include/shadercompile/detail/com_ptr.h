@@ -0,0 +1,126 @@
+#pragma once
+
+#ifdef _WIN32
+#include <wrl/client.h>
+#endif
+
+#include <cstddef>
+#include <utility>
+
+namespace shadercompile
+{
+#ifdef _WIN32
+template<class T>
+using ComPtr = Microsoft::WRL::ComPtr<T>;
+#else
+// The subset of Microsoft::WRL::ComPtr used with the dxcompiler interfaces. The address-of operator releases the held
+// object and returns T**, the same as DXC's own CComPtr, so `IID_PPV_ARGS(&ptr)` from WinAdapter.h and out parameters
+// such as `IDxcBlobEncoding**` both work.
+template<class T>
+class ComPtr
+{
+public:
+    ComPtr() noexcept = default;
+    ComPtr(std::nullptr_t) noexcept {}
+
+    ComPtr(T* ptr) noexcept
+        : mPtr(ptr)
+    {
+        addRef();
+    }
+
+    ComPtr(const ComPtr& other) noexcept
+        : mPtr(other.mPtr)
+    {
+        addRef();
+    }
+
+    ComPtr(ComPtr&& other) noexcept
+        : mPtr(std::exchange(other.mPtr, nullptr))
+    {}
+
+    ~ComPtr() noexcept { release(); }
+
+    ComPtr& operator=(const ComPtr& other) noexcept
+    {
+        ComPtr(other).Swap(*this);
+        return *this;
+    }
+
+    ComPtr& operator=(ComPtr&& other) noexcept
+    {
+        ComPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ComPtr& operator=(std::nullptr_t) noexcept
+    {
+        Reset();
+        return *this;
+    }
+
+    [[nodiscard]] T* Get() const noexcept { return mPtr; }
+
+    [[nodiscard]] T* const* GetAddressOf() const noexcept { return &mPtr; }
+
+    [[nodiscard]] T** GetAddressOf() noexcept { return &mPtr; }
+
+    [[nodiscard]] T** ReleaseAndGetAddressOf() noexcept
+    {
+        release();
+        return &mPtr;
+    }
+
+    [[nodiscard]] T* Detach() noexcept { return std::exchange(mPtr, nullptr); }
+
+    void Attach(T* ptr) noexcept
+    {
+        release();
+        mPtr = ptr;
+    }
+
+    unsigned long Reset() noexcept
+    {
+        if(mPtr == nullptr) { return 0; }
+
+        return (unsigned long)std::exchange(mPtr, nullptr)->Release();
+    }
+
+    void Swap(ComPtr& other) noexcept { std::swap(mPtr, other.mPtr); }
+
+    template<class U>
+    long As(ComPtr<U>* other) const noexcept
+    {
+        return mPtr->QueryInterface(other->ReleaseAndGetAddressOf());
+    }
+
+    [[nodiscard]] T& operator*() const noexcept { return *mPtr; }
+
+    [[nodiscard]] T* operator->() const noexcept { return mPtr; }
+
+    [[nodiscard]] T** operator&() noexcept { return ReleaseAndGetAddressOf(); }
+
+    explicit operator bool() const noexcept { return mPtr != nullptr; }
+
+    [[nodiscard]] friend bool operator==(const ComPtr& lhs, std::nullptr_t) noexcept { return lhs.mPtr == nullptr; }
+
+    [[nodiscard]] friend bool operator==(const ComPtr& lhs, const ComPtr& rhs) noexcept
+    {
+        return lhs.mPtr == rhs.mPtr;
+    }
+
+private:
+    void addRef() noexcept
+    {
+        if(mPtr != nullptr) { mPtr->AddRef(); }
+    }
+
+    void release() noexcept
+    {
+        if(mPtr != nullptr) { std::exchange(mPtr, nullptr)->Release(); }
+    }
+
+    T* mPtr = nullptr;
+};
+#endif
+} // namespace shadercompile
@@ -2,10 +2,19 @@
 
 #include <tl/expected.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace shadercompile
 {
@@ -16,7 +25,8 @@ enum class CompilerMessageType
     Info,
     Warning,
     Error,
-    Critical
+    Critical,
+    _count
 };
 
 [[nodiscard]] constexpr std::string_view toStringView(CompilerMessageType type) noexcept
@@ -33,9 +43,10 @@ enum class CompilerMessageType
     }
 }
 
+// A view of one diagnostic, valid as long as the CompilerMessages it came from
 struct CompilerMessage
 {
-    std::string fullMessage;
+    std::string_view fullMessage;
     int line = -1;
     int column = -1;
     int filePathOffset = -1;
@@ -52,22 +63,196 @@ struct CompilerMessage
 
     [[nodiscard]] bool hasMessage() const { return messageOffset >= 0; }
 
-    [[nodiscard]] std::string_view filePath() const
+    [[nodiscard]] std::string_view filePath() const { return fullMessage.substr(filePathOffset, filePathCount); }
+
+    [[nodiscard]] std::string_view message() const { return fullMessage.substr(messageOffset, messageCount); }
+};
+
+constexpr size_t kUnlimitedMessageCount = std::numeric_limits<size_t>::max();
+
+namespace detail
+{
+// the structure of arrays behind CompilerMessages, offsets and sizes index text
+struct CompilerMessagesStorage
+{
+    std::string text;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> sizes;
+    std::vector<int32_t> lines;
+    std::vector<int32_t> columns;
+    std::vector<CompilerMessageType> types;
+    // relative to the start of each message
+    std::vector<int32_t> filePathOffsets;
+    std::vector<int32_t> filePathCounts;
+    std::vector<int32_t> messageOffsets;
+    std::vector<int32_t> messageCounts;
+    // every message that was reported, retained or not
+    std::array<size_t, (size_t)CompilerMessageType::_count> typeCounts{};
+};
+} // namespace detail
+
+// The diagnostics of one compile. The compiler output is kept in a single buffer and the messages are stored as ranges
+// into it, one array per field, so a compile with thousands of warnings costs a handful of allocations instead of one
+// per message. Copies share the same immutable storage.
+//
+// A compiler may retain fewer messages than it reported. size() only counts the retained messages, totalCount() and
+// count() always count every message.
+class CompilerMessages
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CompilerMessage;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = CompilerMessage;
+
+        Iterator() = default;
+
+        [[nodiscard]] CompilerMessage operator*() const { return (*mMessages)[mIndex]; }
+
+        Iterator& operator++()
+        {
+            ++mIndex;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++mIndex;
+            return previous;
+        }
+
+        [[nodiscard]] bool operator==(const Iterator& other) const noexcept { return mIndex == other.mIndex; }
+
+    private:
+        friend class CompilerMessages;
+
+        Iterator(const CompilerMessages* messages, size_t index)
+            : mMessages(messages)
+            , mIndex(index)
+        {}
+
+        const CompilerMessages* mMessages = nullptr;
+        size_t mIndex = 0;
+    };
+
+    // Collects the messages parsed from text. Messages past maxMessageCount are only counted.
+    class Builder
     {
-        return std::string_view(fullMessage).substr(filePathOffset, filePathCount);
+    public:
+        explicit Builder(std::string text, size_t maxMessageCount = kUnlimitedMessageCount);
+
+        // the buffer the added messages have to view
+        [[nodiscard]] std::string_view text() const noexcept { return mStorage->text; }
+
+        void add(const CompilerMessage& message);
+
+        // counts messages that are not retained, for storage that only kept some of them
+        void addDropped(CompilerMessageType type, size_t count);
+
+        // shrinks the buffer to the retained messages
+        [[nodiscard]] CompilerMessages build() &&;
+
+    private:
+        std::shared_ptr<detail::CompilerMessagesStorage> mStorage;
+        size_t mMaxMessageCount = kUnlimitedMessageCount;
+    };
+
+    CompilerMessages() = default;
+
+    [[nodiscard]] size_t size() const noexcept { return mSize; }
+
+    [[nodiscard]] bool empty() const noexcept { return mSize == 0; }
+
+    [[nodiscard]] CompilerMessage operator[](size_t index) const
+    {
+        const detail::CompilerMessagesStorage& storage = *mStorage;
+
+        CompilerMessage message;
+        message.fullMessage = std::string_view(storage.text).substr(storage.offsets[index], storage.sizes[index]);
+        message.line = storage.lines[index];
+        message.column = storage.columns[index];
+        message.filePathOffset = storage.filePathOffsets[index];
+        message.filePathCount = storage.filePathCounts[index];
+        message.type = storage.types[index];
+        message.messageOffset = storage.messageOffsets[index];
+        message.messageCount = storage.messageCounts[index];
+
+        return message;
+    }
+
+    [[nodiscard]] Iterator begin() const noexcept { return Iterator(this, 0); }
+
+    [[nodiscard]] Iterator end() const noexcept { return Iterator(this, mSize); }
+
+    [[nodiscard]] size_t totalCount() const noexcept
+    {
+        if(mStorage == nullptr) { return 0; }
+
+        return std::accumulate(mStorage->typeCounts.begin(), mStorage->typeCounts.end(), size_t(0));
     }
 
-    [[nodiscard]] std::string_view message() const
+    [[nodiscard]] size_t count(CompilerMessageType type) const noexcept
+    {
+        return (mStorage != nullptr) ? mStorage->typeCounts[(size_t)type] : 0;
+    }
+
+    [[nodiscard]] bool truncated() const noexcept { return totalCount() > mSize; }
+
+    // the output buffer the messages view
+    [[nodiscard]] std::string_view text() const noexcept
     {
-        return std::string_view(fullMessage).substr(messageOffset, messageCount);
+        return (mStorage != nullptr) ? std::string_view(mStorage->text) : std::string_view();
     }
+
+    // the first maxMessageCount messages, sharing this storage and keeping its counts
+    [[nodiscard]] CompilerMessages first(size_t maxMessageCount) const
+    {
+        CompilerMessages messages = *this;
+        messages.mSize = std::min(mSize, maxMessageCount);
+
+        return messages;
+    }
+
+private:
+    std::shared_ptr<const detail::CompilerMessagesStorage> mStorage;
+    size_t mSize = 0;
 };
 
+// why the compiler stopped, the return code of a compiler that was stopped by a limit is meaningless
+enum class CompileTermination
+{
+    Exited,
+    TimedOut,
+    CpuTimeLimitExceeded,
+    MemoryLimitExceeded,
+    // killed on its first error, see DxcExternalCompiler::setAbortOnFirstError()
+    AbortedOnError
+};
+
+[[nodiscard]] constexpr std::string_view toStringView(CompileTermination termination) noexcept
+{
+    switch(termination)
+    {
+    case CompileTermination::Exited: return "Exited";
+    case CompileTermination::TimedOut: return "TimedOut";
+    case CompileTermination::CpuTimeLimitExceeded: return "CpuTimeLimitExceeded";
+    case CompileTermination::MemoryLimitExceeded: return "MemoryLimitExceeded";
+    case CompileTermination::AbortedOnError: return "AbortedOnError";
+    default: return "Unknown CompileTermination";
+    }
+}
+
 struct CompileSummary
 {
     int returnCode = 0;
+    CompileTermination termination = CompileTermination::Exited;
     std::span<const std::wstring> arguments;
-    std::span<const CompilerMessage> messages;
+    CompilerMessages messages;
     int errorCount = 0;
     int warningCount = 0;
 };
@@ -92,6 +277,6 @@ public:
     virtual tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
                                                                       std::wstring_view shaderSourceName) = 0;
 
-    [[nodiscard]] virtual std::span<const CompilerMessage> messages() const = 0;
+    [[nodiscard]] virtual const CompilerMessages& messages() const = 0;
 };
 } // namespace shadercompile
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <shadercompile/detail/com_ptr.h>
 #include <shadercompile/detail/compiler_common.h>
-#ifdef _WIN32
-#include <wrl/client.h>
-#endif
+#include <shadercompile/dxc_dependency_graph.h>
+#include <shadercompile/dxc_release_manager.h>
 
 #include <array>
+#include <memory>
+#include <optional>
+#include <stop_token>
 #include <string_view>
 #include <variant>
 
@@ -13,6 +16,11 @@ struct IDxcBlob;
 
 namespace shadercompile
 {
+class DxcArtifactCache;
+class DxcCompileCache;
+struct DxcCompileCacheEntry;
+class DxcSingleFlight;
+
 enum class DxcTargetProfile
 {
     // clang-format off
@@ -175,6 +183,8 @@ enum class DxcArtifactType
     Reflection,
     RootSignature,
     ShaderHash,
+    // only produced when compiling with -P
+    PreprocessedSource,
     _count,
     _first = 0,
     _last = _count - 1
@@ -196,7 +206,9 @@ public:
     explicit DxcArtifact(DxcSinkType sinkType) noexcept;
     explicit DxcArtifact(std::vector<std::byte> buffer) noexcept;
     explicit DxcArtifact(std::filesystem::path path) noexcept;
-    explicit DxcArtifact(Microsoft::WRL::ComPtr<IDxcBlob> buffer) noexcept;
+    explicit DxcArtifact(ComPtr<IDxcBlob> buffer) noexcept;
+    // an immutable buffer shared with other artifacts, such as a cached or single-flight result
+    explicit DxcArtifact(std::shared_ptr<const std::vector<std::byte>> buffer) noexcept;
     ~DxcArtifact() noexcept;
 
     DxcArtifact& operator=(const DxcArtifact&) = delete;
@@ -206,20 +218,72 @@ public:
 
     [[nodiscard]] constexpr const std::filesystem::path& path() const noexcept { return mPath; }
 
+    [[nodiscard]] std::span<const std::byte> data() const noexcept;
+
     void setPath(std::filesystem::path path) noexcept { mPath = std::move(path); }
 
 private:
     DxcSinkType mSinkType = DxcSinkType::None;
     std::filesystem::path mPath;
-    std::variant<std::vector<std::byte>, Microsoft::WRL::ComPtr<IDxcBlob>> mStorage;
+    std::variant<std::vector<std::byte>, ComPtr<IDxcBlob>, std::shared_ptr<const std::vector<std::byte>>> mStorage;
 };
 
 namespace detail
 {
+// DxcTargetProfile::Unknown for a name that is not a target profile, the case of the name does not matter
+[[nodiscard]] DxcTargetProfile parseTargetProfile(std::string_view targetProfileStr);
+[[nodiscard]] DxcTargetProfile parseTargetProfile(std::wstring_view targetProfileStr);
+
 class BaseDxcCompiler : public ICompiler
 {
 public:
-    ~BaseDxcCompiler() noexcept override = default;
+    ~BaseDxcCompiler() noexcept override;
+
+    tl::expected<CompileSummary, std::errc> compileFromFile(const std::filesystem::path& shaderFilePath) final;
+    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
+                                                              std::string_view shaderSourceName) final;
+    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
+                                                              std::wstring_view shaderSourceName) final;
+
+    [[nodiscard]] virtual std::span<const std::wstring> arguments() const = 0;
+
+    // The version of the DXC that this compiler runs. It is part of every cache key, the caches are not used until it
+    // is set.
+    void setCompilerVersion(DxcVersion compilerVersion) noexcept { mCompilerVersion = compilerVersion; }
+
+    [[nodiscard]] const DxcVersion& compilerVersion() const noexcept { return mCompilerVersion; }
+
+    // Compiles are looked up in the caches before the compiler runs, first in artifactCache and then in compileCache,
+    // and successful compiles are stored in both. The caches are kept across reset().
+    void setArtifactCache(std::shared_ptr<DxcArtifactCache> artifactCache) noexcept;
+    void setCompileCache(std::shared_ptr<DxcCompileCache> compileCache) noexcept;
+
+    [[nodiscard]] const std::shared_ptr<DxcArtifactCache>& artifactCache() const noexcept { return mArtifactCache; }
+    [[nodiscard]] const std::shared_ptr<DxcCompileCache>& compileCache() const noexcept { return mCompileCache; }
+
+    // When both caches miss, a compile identical to one that another compiler sharing singleFlight is running waits
+    // for that compile and takes its result. It is kept across reset().
+    void setSingleFlight(std::shared_ptr<DxcSingleFlight> singleFlight) noexcept;
+
+    [[nodiscard]] const std::shared_ptr<DxcSingleFlight>& singleFlight() const noexcept { return mSingleFlight; }
+
+    // Every successful compile, including cache hits, records the files it read in dependencyGraph. The graph is kept
+    // across reset().
+    void setDependencyGraph(std::shared_ptr<DxcDependencyGraph> dependencyGraph) noexcept;
+
+    [[nodiscard]] const std::shared_ptr<DxcDependencyGraph>& dependencyGraph() const noexcept
+    {
+        return mDependencyGraph;
+    }
+
+    // A compile started after cancellationToken is stopped fails with std::errc::operation_canceled. Backends that run
+    // dxc as a process also terminate the compile that is running. It is kept across reset().
+    void setCancellationToken(std::stop_token cancellationToken) noexcept
+    {
+        mCancellationToken = std::move(cancellationToken);
+    }
+
+    [[nodiscard]] const std::stop_token& cancellationToken() const noexcept { return mCancellationToken; }
 
     void setTargetProfile(std::string_view targetProfile) noexcept;
     void setTargetProfile(std::wstring_view targetProfile) noexcept;
@@ -235,23 +299,87 @@ public:
 
     [[nodiscard]] const DxcArtifact& getArtifact(DxcArtifactType type) const noexcept;
 
-    [[nodiscard]] std::span<const CompilerMessage> messages() const noexcept override { return mCompilerMessages; }
+    // moves the artifact out of the compiler, leaving it disabled
+    [[nodiscard]] DxcArtifact takeArtifact(DxcArtifactType type) noexcept;
+
+    [[nodiscard]] const CompilerMessages& messages() const noexcept override { return mCompilerMessages; }
+
+    // Only the first maxMessageCount messages of a compile are kept, the counts of CompileSummary and
+    // CompilerMessages still include the others. A cache hit keeps at most the messages of the compiler that stored
+    // it. It is kept across reset().
+    void setMaxMessageCount(size_t maxMessageCount) noexcept { mMaxMessageCount = maxMessageCount; }
+
+    [[nodiscard]] size_t maxMessageCount() const noexcept { return mMaxMessageCount; }
 
     virtual void reset() noexcept;
 
 protected:
+    virtual tl::expected<CompileSummary, std::errc>
+    compileFromFileImpl(const std::filesystem::path& shaderFilePath) = 0;
+    virtual tl::expected<CompileSummary, std::errc> compileFromBufferImpl(std::span<const std::byte> shaderSource,
+                                                                          std::wstring_view shaderSourceName) = 0;
+
     [[nodiscard]] DxcArtifact& accessArtifact(DxcArtifactType type) noexcept;
 
     [[nodiscard]] bool shouldOutputArtifact(DxcArtifactType type) const;
 
-    static void parseCompilerMessages(std::string_view compilerOutput, std::vector<CompilerMessage>& compilerMessages);
+    [[nodiscard]] static CompilerMessages parseCompilerMessages(std::string_view compilerOutput,
+                                                                size_t maxMessageCount);
 
     std::array<DxcArtifact, (size_t)DxcArtifactType::_count> mArtifacts;
 
     DxcTargetProfile mTargetProfile = DxcTargetProfile::Unknown;
     std::wstring mEntryPoint;
     std::filesystem::path mShaderFilePath;
-    std::vector<CompilerMessage> mCompilerMessages;
+    CompilerMessages mCompilerMessages;
+    size_t mMaxMessageCount = kUnlimitedMessageCount;
+
+    // backends that know which files the compiler loaded append them with the hash of the contents it loaded here and
+    // set mIncludedFilesRecorded, the #include directives are scanned otherwise
+    std::vector<DxcFileDependency> mIncludedFiles;
+    bool mIncludedFilesRecorded = false;
+
+private:
+    tl::expected<CompileSummary, std::errc> compileFileWithCaches(const std::filesystem::path& shaderFilePath);
+    tl::expected<CompileSummary, std::errc> compileBufferWithCaches(std::span<const std::byte> shaderSource,
+                                                                    std::wstring_view shaderSourceName);
+
+    [[nodiscard]] bool hasCache() const noexcept
+    {
+        return mArtifactCache != nullptr || mCompileCache != nullptr || mSingleFlight != nullptr;
+    }
+
+    template<class CompileF>
+    tl::expected<CompileSummary, std::errc> compileWithCaches(std::span<const std::byte> source,
+                                                              const std::filesystem::path& sourcePath,
+                                                              CompileF compile);
+
+    // memory sink artifacts share the entry's buffers
+    [[nodiscard]] bool restoreCacheEntry(const std::shared_ptr<const DxcCompileCacheEntry>& entry,
+                                         std::span<const DxcArtifactType> artifactTypes,
+                                         CompileSummary& summary);
+
+    [[nodiscard]] std::shared_ptr<const DxcCompileCacheEntry>
+    createCacheEntry(const CompileSummary& summary, std::span<const DxcArtifactType> artifactTypes) const;
+
+    // the files the #include directives of source could resolve to, std::nullopt when they are unknown
+    [[nodiscard]] std::optional<std::vector<DxcFileDependency>>
+    scanIncludeDependencies(std::span<const std::byte> source,
+                            const std::filesystem::path& sourcePath,
+                            std::span<const std::wstring> arguments);
+
+    // sourceFile is the source of a file compile, scannedDependencies what scanIncludeDependencies() returned for it
+    void recordDependencies(const std::filesystem::path& sourcePath,
+                            std::span<const std::wstring> arguments,
+                            const std::optional<DxcFileDependency>& sourceFile,
+                            const std::optional<std::vector<DxcFileDependency>>& scannedDependencies);
+
+    std::shared_ptr<DxcArtifactCache> mArtifactCache;
+    std::shared_ptr<DxcCompileCache> mCompileCache;
+    std::shared_ptr<DxcSingleFlight> mSingleFlight;
+    std::shared_ptr<DxcDependencyGraph> mDependencyGraph;
+    DxcVersion mCompilerVersion;
+    std::stop_token mCancellationToken;
 };
 } // namespace detail
 
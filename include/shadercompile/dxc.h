@@ -1,3 +1,16 @@
+#include <shadercompile/dxc_artifact_cache.h>
+#include <shadercompile/dxc_async_compiler.h>
+#include <shadercompile/dxc_batch_compiler.h>
+#include <shadercompile/dxc_compile_cache.h>
+#include <shadercompile/dxc_compile_scheduler.h>
+#include <shadercompile/dxc_dependency_graph.h>
+#include <shadercompile/dxc_diagnostic_aggregator.h>
 #include <shadercompile/dxc_external_compiler.h>
+#include <shadercompile/dxc_include_cache.h>
+#include <shadercompile/dxc_job_server.h>
 #include <shadercompile/dxc_library_compiler.h>
-#include <shadercompile/dxc_release_manager.h>
\ No newline at end of file
+#include <shadercompile/dxc_permutation_compiler.h>
+#include <shadercompile/dxc_release_manager.h>
+#include <shadercompile/dxc_server_compiler.h>
+#include <shadercompile/dxc_shader_watcher.h>
+#include <shadercompile/dxc_single_flight.h>
\ No newline at end of file
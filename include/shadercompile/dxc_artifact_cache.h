@@ -0,0 +1,108 @@
+#pragma once
+
+#include <shadercompile/dxc_compile_cache.h>
+#include <shadercompile/dxc_include_cache.h>
+#include <tl/expected.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+namespace shadercompile
+{
+struct DxcArtifactCacheStatistics
+{
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t insertCount = 0;
+    uint64_t evictionCount = 0;
+    // compiles whose #include dependencies could not be determined, they are never cached
+    uint64_t uncacheableCount = 0;
+    size_t entryCount = 0;
+    size_t residentByteCount = 0;
+    size_t byteBudget = 0;
+
+    [[nodiscard]] double hitRate() const noexcept
+    {
+        const uint64_t lookupCount = hitCount + missCount;
+        return (lookupCount == 0) ? 0.0 : (double)hitCount / (double)lookupCount;
+    }
+};
+
+// An in-memory compile cache for long running processes, shared by any number of compilers and threads. Entries are
+// keyed by the same fingerprint as DxcCompileCache and are immutable once inserted, so a hit hands out the cached
+// buffers themselves for memory sink artifacts. Like DxcCompileCache every entry keeps the inputs of its key, and a
+// lookup whose inputs differ misses. When the resident size exceeds the byte budget the least recently used entries
+// are evicted.
+//
+// Compilers use the cache once it is attached with BaseDxcCompiler::setArtifactCache() and their DXC version is set
+// with BaseDxcCompiler::setCompilerVersion(). It is looked up before an attached DxcCompileCache, and hits from the
+// DxcCompileCache are inserted into it.
+class DxcArtifactCache
+{
+public:
+    using Entry = std::shared_ptr<const DxcCompileCacheEntry>;
+
+    explicit DxcArtifactCache(size_t byteBudget);
+
+    [[nodiscard]] size_t byteBudget() const;
+
+    // evicts entries right away when the resident size exceeds the new budget
+    void setByteBudget(size_t byteBudget);
+
+    [[nodiscard]] tl::expected<DxcCompileKey, std::errc> computeKey(std::span<const std::byte> source,
+                                                                    const std::filesystem::path& sourcePath,
+                                                                    std::span<const std::wstring> arguments,
+                                                                    const DxcVersion& compilerVersion,
+                                                                    std::span<const DxcArtifactType> artifactTypes);
+
+    // returns nullptr on a miss
+    [[nodiscard]] Entry find(const DxcCompileKey& key);
+
+    // replaces an existing entry with the same key hash, an entry larger than the whole budget is not inserted
+    void insert(const DxcCompileKey& key, Entry entry);
+
+    void clear();
+
+    [[nodiscard]] DxcArtifactCacheStatistics statistics() const;
+
+    void resetStatistics() noexcept;
+
+private:
+    struct Node
+    {
+        uint64_t key = 0;
+        // compared on every hit, the key alone can collide
+        std::string inputs;
+        Entry entry;
+        size_t byteCount = 0;
+    };
+
+    // moves the least recently used nodes into releasedNodes, so that they can be destroyed after the lock is released
+    void evictToBudget(std::list<Node>& releasedNodes);
+
+    mutable std::mutex mMutex;
+    // the most recently used entry is at the front
+    std::list<Node> mNodes;
+    std::unordered_map<uint64_t, std::list<Node>::iterator> mNodesByKey;
+    size_t mByteBudget = 0;
+    size_t mResidentByteCount = 0;
+
+    // headers are only reread when they change on disk
+    DxcIncludeCache mIncludeCache;
+
+    std::atomic<uint64_t> mHitCount = 0;
+    std::atomic<uint64_t> mMissCount = 0;
+    std::atomic<uint64_t> mInsertCount = 0;
+    std::atomic<uint64_t> mEvictionCount = 0;
+    std::atomic<uint64_t> mUncacheableCount = 0;
+};
+} // namespace shadercompile
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <shadercompile/dxc_batch_compiler.h>
+#include <shadercompile/dxc_external_compiler.h>
+#include <tl/expected.hpp>
+
+#include <coroutine>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace shadercompile
+{
+// Compiles with an external dxc executable without blocking the caller. The children are supervised by a single event
+// loop thread that drains their output and reaps them as they exit, so hundreds of compiles can be in flight without a
+// thread for each:
+//
+//   DxcAsyncCompiler asyncCompiler(dxcPath);
+//   std::future<DxcAsyncCompiler::Result> result = asyncCompiler.compileAsync(request);
+//
+//   // or from a coroutine
+//   DxcAsyncCompiler::Result result = co_await asyncCompiler.compileAwaitable(request);
+//
+// Completions run on the executor, or on the event loop's thread when there is none, in which case they must not
+// block. The source of a buffer request is copied before compile() returns. Every request runs dxc, the caches and
+// dependency graphs of BaseDxcCompiler are not used, and no DxcJobServer tokens are taken, the caller bounds how many
+// compiles it starts. Only POSIX systems are supported, elsewhere every compile fails with std::errc::not_supported.
+class DxcAsyncCompiler
+{
+public:
+    using Result = tl::expected<CompileResult, std::errc>;
+    using CompletionCallback = std::function<void(Result result)>;
+    using Executor = std::function<void(std::function<void()> completion)>;
+
+    class CompileAwaitable
+    {
+    public:
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> continuation);
+
+        [[nodiscard]] Result await_resume() { return std::move(mResult); }
+
+    private:
+        friend class DxcAsyncCompiler;
+
+        CompileAwaitable(DxcAsyncCompiler& compiler, CompileRequest request)
+            : mCompiler(compiler)
+            , mRequest(std::move(request))
+        {}
+
+        DxcAsyncCompiler& mCompiler;
+        CompileRequest mRequest;
+        Result mResult;
+    };
+
+    explicit DxcAsyncCompiler(std::filesystem::path compilerPath, Executor executor = {});
+
+    // kills the compiles in flight, they complete with std::errc::operation_canceled
+    ~DxcAsyncCompiler();
+
+    DxcAsyncCompiler(const DxcAsyncCompiler&) = delete;
+    DxcAsyncCompiler& operator=(const DxcAsyncCompiler&) = delete;
+
+    void compile(CompileRequest request, CompletionCallback completion);
+
+    [[nodiscard]] std::future<Result> compileAsync(CompileRequest request);
+
+    [[nodiscard]] CompileAwaitable compileAwaitable(CompileRequest request)
+    {
+        return CompileAwaitable(*this, std::move(request));
+    }
+
+    // applies to the compiles started from now on, the event loop enforces the timeout
+    void setProcessLimits(const DxcProcessLimits& limits);
+
+    [[nodiscard]] DxcProcessLimits processLimits() const;
+
+    // applies to the compiles started from now on, see DxcExternalCompiler::setAbortOnFirstError()
+    void setAbortOnFirstError(bool abort);
+
+    [[nodiscard]] bool abortOnFirstError() const;
+
+    [[nodiscard]] size_t inFlightCount() const;
+
+private:
+    struct InFlightCompile;
+
+    void eventLoopMain();
+
+    void wakeEventLoop() noexcept;
+
+    void complete(CompletionCallback completion, Result result);
+
+    std::filesystem::path mCompilerPath;
+    Executor mExecutor;
+
+    mutable std::mutex mMutex;
+    // started compiles that the event loop has not taken over yet
+    std::vector<std::unique_ptr<InFlightCompile>> mStartedCompiles;
+    size_t mInFlightCount = 0;
+    DxcProcessLimits mProcessLimits;
+    bool mAbortOnFirstError = false;
+    bool mStopping = false;
+
+#ifndef _WIN32
+    int mWakeReadDescriptor = -1;
+    int mWakeWriteDescriptor = -1;
+#endif
+
+    std::thread mEventLoopThread;
+};
+} // namespace shadercompile
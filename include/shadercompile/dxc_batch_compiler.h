@@ -0,0 +1,140 @@
+#pragma once
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+#include <tl/expected.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+class WorkStealingPool;
+
+// Everything needed to compile one shader. The shader is compiled from sourcePath when source is empty, otherwise from
+// source under the name sourceName. source is not copied and must stay alive until the batch has finished.
+struct CompileRequest
+{
+    std::filesystem::path sourcePath;
+    std::span<const std::byte> source;
+    std::wstring sourceName;
+
+    DxcTargetProfile targetProfile = DxcTargetProfile::Unknown;
+    std::wstring entryPoint;
+    std::vector<std::wstring> arguments;
+
+    std::array<DxcSinkType, (size_t)DxcArtifactType::_count> artifactSinks{};
+    std::array<std::filesystem::path, (size_t)DxcArtifactType::_count> artifactPaths;
+
+    void enableArtifactWithFileSink(DxcArtifactType type, std::filesystem::path path)
+    {
+        artifactSinks[(size_t)type] = DxcSinkType::File;
+        artifactPaths[(size_t)type] = std::move(path);
+    }
+
+    void enableArtifactWithMemorySink(DxcArtifactType type) { artifactSinks[(size_t)type] = DxcSinkType::MemoryBuffer; }
+};
+
+// The outcome of one CompileRequest. Unlike CompileSummary it owns all of its data, so it stays valid after the
+// compiler that produced it has moved on to other requests.
+struct CompileResult
+{
+    int returnCode = 0;
+    CompileTermination termination = CompileTermination::Exited;
+    std::vector<std::wstring> arguments;
+    CompilerMessages messages;
+    int errorCount = 0;
+    int warningCount = 0;
+    std::array<DxcArtifact, (size_t)DxcArtifactType::_count> artifacts;
+
+    [[nodiscard]] bool succeeded() const noexcept { return returnCode == 0 && errorCount == 0; }
+
+    [[nodiscard]] const DxcArtifact& artifact(DxcArtifactType type) const noexcept { return artifacts[(size_t)type]; }
+};
+
+namespace detail
+{
+// resets compiler and sets it up to compile request
+void applyCompileRequest(BaseDxcCompiler& compiler, const CompileRequest& request);
+
+// moves the artifacts of the compile that produced summary out of compiler
+[[nodiscard]] CompileResult takeCompileResult(BaseDxcCompiler& compiler, const CompileSummary& summary);
+} // namespace detail
+
+struct DxcBatchCompilerStatistics
+{
+    // requests that ran through the backend's code generation
+    uint64_t compileCount = 0;
+    // requests that shared the artifacts of an earlier request with the same preprocessed source
+    uint64_t deduplicatedCount = 0;
+    // requests that could not be preprocessed and were compiled without deduplication
+    uint64_t preprocessFailureCount = 0;
+};
+
+// Compiles batches of independent shaders on a work-stealing thread pool. Every worker thread owns one compiler made
+// by the factory, created on the worker's first request and reused for the lifetime of the batch compiler, so any
+// BaseDxcCompiler works as a backend:
+//
+//   DxcBatchCompiler batchCompiler([]() { return std::make_unique<DxcLibraryCompiler>(); });
+//   DxcBatchCompiler batchCompiler([&]() { return std::make_unique<DxcExternalCompiler>(dxcPath); });
+//
+// With preprocess deduplication enabled every request is first preprocessed with -P. Requests whose preprocessed
+// source, code generation arguments, target profile, entry point and requested artifacts all match are compiled once
+// and share the result. This pays off for permutations that differ only in defines their entry point never reads. The
+// shared result keeps the messages, arguments and debug information of the request that was compiled.
+class DxcBatchCompiler
+{
+public:
+    using CompilerFactory = std::function<std::unique_ptr<detail::BaseDxcCompiler>()>;
+
+    // threadCount defaults to the number of hardware threads
+    explicit DxcBatchCompiler(CompilerFactory compilerFactory, size_t threadCount = 0);
+    ~DxcBatchCompiler();
+
+    DxcBatchCompiler(const DxcBatchCompiler&) = delete;
+    DxcBatchCompiler& operator=(const DxcBatchCompiler&) = delete;
+
+    [[nodiscard]] size_t threadCount() const noexcept;
+
+    void setPreprocessDeduplication(bool enable) noexcept { mPreprocessDeduplication = enable; }
+
+    [[nodiscard]] bool preprocessDeduplication() const noexcept { return mPreprocessDeduplication; }
+
+    [[nodiscard]] DxcBatchCompilerStatistics statistics() const noexcept;
+
+    void resetStatistics() noexcept;
+
+    // Returns one result per request, in request order. A request fails with an error only when its compiler could not
+    // run at all; shaders with compile errors produce a CompileResult with errorCount and returnCode set.
+    [[nodiscard]] std::vector<tl::expected<CompileResult, std::errc>>
+    compileBatch(std::span<const CompileRequest> requests);
+
+    // Compiles a single request on the calling thread with the given compiler.
+    [[nodiscard]] static tl::expected<CompileResult, std::errc> compile(detail::BaseDxcCompiler& compiler,
+                                                                        const CompileRequest& request);
+
+private:
+    // runs task for every index on the pool, compiler is nullptr when the worker's compiler could not be created
+    void run(size_t count, const std::function<void(size_t index, detail::BaseDxcCompiler* compiler)>& task);
+
+    [[nodiscard]] std::vector<tl::expected<CompileResult, std::errc>>
+    compileDeduplicated(std::span<const CompileRequest> requests);
+
+    CompilerFactory mCompilerFactory;
+    std::vector<std::unique_ptr<detail::BaseDxcCompiler>> mCompilers;
+    std::unique_ptr<WorkStealingPool> mPool;
+    bool mPreprocessDeduplication = false;
+
+    std::atomic<uint64_t> mCompileCount = 0;
+    std::atomic<uint64_t> mDeduplicatedCount = 0;
+    std::atomic<uint64_t> mPreprocessFailureCount = 0;
+};
+} // namespace shadercompile
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+#include <shadercompile/dxc_include_cache.h>
+#include <shadercompile/dxc_release_manager.h>
+#include <tl/expected.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+struct DxcCompileCacheEntry
+{
+    int returnCode = 0;
+    CompilerMessages messages;
+    std::array<std::optional<std::vector<std::byte>>, (size_t)DxcArtifactType::_count> artifacts;
+};
+
+// The key of a compile. The hash picks the entry, the inputs are the normalized inputs it was derived from: the
+// arguments, the DXC version, the requested artifacts, the source and the path and contents of every file the source
+// may include. The hash is not collision resistant, so an entry is only used when its inputs match as well.
+struct DxcCompileKey
+{
+    uint64_t hash = 0;
+    std::string inputs;
+};
+
+struct DxcCompileCacheStatistics
+{
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t storeCount = 0;
+    // compiles whose #include dependencies could not be determined, they are never cached
+    uint64_t uncacheableCount = 0;
+};
+
+// A persistent compile cache in a directory that any number of threads and processes can share. Entries are keyed by
+// a fingerprint of the source, the contents of every file it may include, the normalized arguments, the requested
+// artifacts and the DXC version. Every entry stores the inputs of its key, and an entry whose inputs differ from the
+// ones looked up is a miss, so two compiles whose fingerprints collide never share a result. Entries are written to a
+// temporary file and renamed into place, so a reader only ever sees complete entries.
+//
+// Compilers use the cache once it is attached with BaseDxcCompiler::setCompileCache() and their DXC version is set with
+// BaseDxcCompiler::setCompilerVersion().
+class DxcCompileCache
+{
+public:
+    explicit DxcCompileCache(std::filesystem::path directory);
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return mDirectory; }
+
+    [[nodiscard]] tl::expected<DxcCompileKey, std::errc> computeKey(std::span<const std::byte> source,
+                                                                    const std::filesystem::path& sourcePath,
+                                                                    std::span<const std::wstring> arguments,
+                                                                    const DxcVersion& compilerVersion,
+                                                                    std::span<const DxcArtifactType> artifactTypes);
+
+    [[nodiscard]] std::optional<DxcCompileCacheEntry> load(const DxcCompileKey& key);
+
+    tl::expected<void, std::errc> store(const DxcCompileKey& key, const DxcCompileCacheEntry& entry);
+
+    [[nodiscard]] DxcCompileCacheStatistics statistics() const noexcept;
+
+    void resetStatistics() noexcept;
+
+private:
+    [[nodiscard]] std::filesystem::path entryPath(uint64_t hash) const;
+
+    std::filesystem::path mDirectory;
+
+    // headers are only reread when they change on disk
+    DxcIncludeCache mIncludeCache;
+
+    std::atomic<uint64_t> mHitCount = 0;
+    std::atomic<uint64_t> mMissCount = 0;
+    std::atomic<uint64_t> mStoreCount = 0;
+    std::atomic<uint64_t> mUncacheableCount = 0;
+};
+} // namespace shadercompile
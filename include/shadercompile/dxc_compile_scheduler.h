@@ -0,0 +1,119 @@
+#pragma once
+
+#include <shadercompile/dxc_batch_compiler.h>
+#include <tl/expected.hpp>
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+enum class CompilePriority
+{
+    // a shader someone is waiting to see
+    Interactive,
+    Normal,
+    // variants compiled ahead of time
+    Background,
+    _count
+};
+
+struct DxcCompileSchedulerStatistics
+{
+    std::array<size_t, (size_t)CompilePriority::_count> queuedCounts{};
+    size_t runningCount = 0;
+    uint64_t completedCount = 0;
+    // jobs that were cancelled while queued or running
+    uint64_t cancelledCount = 0;
+};
+
+// Runs compile jobs of different priorities on a fixed set of worker threads, each with its own compiler made by the
+// factory:
+//
+//   DxcCompileScheduler scheduler([]() { return std::make_unique<DxcExternalCompiler>(dxcPath); });
+//   std::stop_source cancellation;
+//   DxcCompileScheduler::Job job = scheduler.submit(request, CompilePriority::Interactive, cancellation.get_token());
+//   tl::expected<CompileResult, std::errc> result = job.result.get();
+//
+// Whenever a worker finishes a job it takes the oldest job of the highest priority that is queued, so a job submitted
+// with a higher priority only waits for the jobs that are already running, never for the queue. Running jobs are not
+// interrupted. The priority of a job can be changed while it is queued.
+//
+// Stopping the cancellation token of a queued job removes it from the queue, and its result fails with
+// std::errc::operation_canceled right away. A running job is cancelled through its compiler, see
+// BaseDxcCompiler::setCancellationToken().
+class DxcCompileScheduler
+{
+public:
+    using CompilerFactory = DxcBatchCompiler::CompilerFactory;
+    using JobId = uint64_t;
+    using Result = tl::expected<CompileResult, std::errc>;
+
+    struct Job
+    {
+        JobId id = 0;
+        std::future<Result> result;
+    };
+
+    // threadCount defaults to the number of hardware threads
+    explicit DxcCompileScheduler(CompilerFactory compilerFactory, size_t threadCount = 0);
+
+    // running jobs finish, the results of queued jobs fail with std::errc::operation_canceled
+    ~DxcCompileScheduler();
+
+    DxcCompileScheduler(const DxcCompileScheduler&) = delete;
+    DxcCompileScheduler& operator=(const DxcCompileScheduler&) = delete;
+
+    [[nodiscard]] size_t threadCount() const noexcept { return mThreads.size(); }
+
+    // the source of a buffer request must stay alive until the job's result is ready
+    [[nodiscard]] Job submit(CompileRequest request, CompilePriority priority, std::stop_token cancellationToken = {});
+
+    // Moves a queued job behind the jobs of the new priority that were submitted before it. Returns false when the job
+    // is no longer queued.
+    bool setPriority(JobId jobId, CompilePriority priority);
+
+    [[nodiscard]] DxcCompileSchedulerStatistics statistics() const;
+
+private:
+    struct QueuedJob;
+
+    using JobQueue = std::map<JobId, std::unique_ptr<QueuedJob>>;
+
+    void workerMain();
+
+    // called by the job's cancellation token
+    void cancelQueuedJob(JobId jobId);
+
+    [[nodiscard]] std::unique_ptr<QueuedJob> popJob();
+
+    CompilerFactory mCompilerFactory;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    // job ids increase with submission, so each queue is ordered oldest first
+    std::array<JobQueue, (size_t)CompilePriority::_count> mQueues;
+    std::unordered_map<JobId, CompilePriority> mQueuedPriorities;
+    // Jobs cancelled from their cancellation callback, which cannot destroy the job that owns it. A worker destroys
+    // them.
+    std::vector<std::unique_ptr<QueuedJob>> mCancelledJobs;
+    JobId mNextJobId = 1;
+    size_t mRunningCount = 0;
+    uint64_t mCompletedCount = 0;
+    uint64_t mCancelledCount = 0;
+    bool mStopping = false;
+
+    std::vector<std::thread> mThreads;
+};
+} // namespace shadercompile
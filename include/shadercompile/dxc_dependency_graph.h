@@ -0,0 +1,139 @@
+#pragma once
+
+#include <shadercompile/dxc_include_cache.h>
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+// A compile as it was recorded: the source file, or the source name of a buffer compile, and the arguments it was
+// given before the compiler added its own.
+struct DxcRecordedCompile
+{
+    std::filesystem::path sourcePath;
+    std::vector<std::wstring> arguments;
+};
+
+// A file a compile read and the hash of the contents it read, see DxcDependencyGraph::hashContents(). The file may have
+// changed on disk since.
+struct DxcFileDependency
+{
+    std::filesystem::path path;
+    uint64_t contentHash = 0;
+};
+
+struct DxcDependencyGraphStatistics
+{
+    size_t compileCount = 0;
+    size_t fileCount = 0;
+    size_t dependencyCount = 0;
+};
+
+// Records which files every compile read, together with a hash of their contents at the time, so that after files
+// change only the compiles that read one of them have to run again. Touching a file without changing its contents
+// does not make anything stale. The modification time and size of every file are kept as well and a file is only
+// rehashed when one of them differs.
+//
+// Compilers record into the graph once it is attached with BaseDxcCompiler::setDependencyGraph(). DxcLibraryCompiler
+// records the files its include handler loads; the other backends scan the include directives of the source before the
+// compile instead, which conservatively records every existing file an #include could resolve to. A compile whose
+// includes cannot be determined is not recorded at all, so a compile the graph does not contain has to be treated as
+// stale. The graph is thread-safe and can be saved and loaded to survive between runs.
+class DxcDependencyGraph
+{
+public:
+    // Replaces the recorded dependencies of the compile of sourcePath with arguments. Each dependency keeps the hash
+    // of the contents the compile read, so a file that changed while the compile ran leaves the compile stale.
+    void recordCompile(const std::filesystem::path& sourcePath,
+                       std::span<const std::wstring> arguments,
+                       std::span<const DxcFileDependency> dependencies);
+
+    void removeCompile(const std::filesystem::path& sourcePath, std::span<const std::wstring> arguments);
+
+    [[nodiscard]] bool contains(const std::filesystem::path& sourcePath,
+                                std::span<const std::wstring> arguments) const;
+
+    // Returns every recorded compile that read a file whose contents changed or that no longer exists. A stale compile
+    // stays stale until it is recorded again.
+    [[nodiscard]] std::vector<DxcRecordedCompile> findStaleCompiles();
+
+    // The same, but only changedFiles are checked on disk, e.g. the files reported by a file watcher.
+    [[nodiscard]] std::vector<DxcRecordedCompile>
+    findStaleCompiles(std::span<const std::filesystem::path> changedFiles);
+
+    [[nodiscard]] std::vector<std::filesystem::path> dependencies(const std::filesystem::path& sourcePath,
+                                                                  std::span<const std::wstring> arguments) const;
+
+    // every file a recorded compile read, e.g. to know which directories to watch
+    [[nodiscard]] std::vector<std::filesystem::path> files() const;
+
+    tl::expected<void, std::errc> save(const std::filesystem::path& path) const;
+
+    // Replaces the contents of the graph with the graph saved at path. Fails with std::errc::bad_message when the file
+    // is not a saved graph.
+    tl::expected<void, std::errc> load(const std::filesystem::path& path);
+
+    void clear();
+
+    [[nodiscard]] DxcDependencyGraphStatistics statistics() const;
+
+    // backs the include scanning of compilers that cannot report their includes
+    [[nodiscard]] DxcIncludeCache& includeCache() noexcept { return mIncludeCache; }
+
+    // the hash the graph keeps of a file's contents, the same hash DxcIncludeCache computes
+    [[nodiscard]] static uint64_t hashContents(std::span<const std::byte> contents) noexcept;
+
+private:
+    struct FileState
+    {
+        std::filesystem::file_time_type lastWriteTime;
+        uintmax_t size = 0;
+        uint64_t contentHash = 0;
+    };
+
+    struct FileNode
+    {
+        std::filesystem::path path;
+        FileState state;
+    };
+
+    struct Dependency
+    {
+        uint32_t fileIndex = 0;
+        // the contents the compile read
+        uint64_t contentHash = 0;
+    };
+
+    struct CompileNode
+    {
+        DxcRecordedCompile compile;
+        std::vector<Dependency> dependencies;
+    };
+
+    [[nodiscard]] static uint64_t makeCompileKey(const std::filesystem::path& sourcePath,
+                                                 std::span<const std::wstring> arguments);
+
+    // reads the state of a file from disk, known is the last state seen and is reused when the file did not change
+    [[nodiscard]] FileState readFileState(const std::filesystem::path& path, const FileState* known);
+
+    [[nodiscard]] uint32_t findOrAddFile(const std::filesystem::path& absolutePath);
+
+    [[nodiscard]] std::vector<DxcRecordedCompile> refreshFiles(std::vector<uint32_t> fileIndices);
+
+    mutable std::mutex mMutex;
+    std::vector<FileNode> mFiles;
+    std::unordered_map<std::filesystem::path::string_type, uint32_t> mFileIndices;
+    std::unordered_map<uint64_t, CompileNode> mCompiles;
+
+    DxcIncludeCache mIncludeCache;
+};
+} // namespace shadercompile
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <shadercompile/dxc_permutation_compiler.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+// identifies the compile a message came from, e.g. the DxcPermutationKey of a permutation
+using DxcVariantId = uint64_t;
+
+// the variants first to last, both included
+struct DxcVariantRange
+{
+    DxcVariantId first = 0;
+    DxcVariantId last = 0;
+};
+
+// One unique diagnostic. The views are valid until the aggregator changes.
+struct DxcAggregatedDiagnostic
+{
+    // empty for a message without a file path
+    std::string_view filePath;
+    int line = -1;
+    int column = -1;
+    CompilerMessageType type = CompilerMessageType::Unknown;
+    // the text after the type, or the whole message when it could not be parsed
+    std::string_view text;
+    // the number of variants that reported it
+    uint64_t variantCount = 0;
+    // in the order the variants were added, consecutive ids share a range
+    std::span<const DxcVariantRange> variants;
+};
+
+// Interns the messages of many variants of one source. A diagnostic that thousands of variants report, e.g. a warning
+// in a shared header, is stored once together with the ranges of variants that reported it, so memory and the time to
+// walk the diagnostics grow with the number of unique diagnostics instead of the number of variants:
+//
+//   DxcPermutationResults results = permutationCompiler.compile(permutations, baseRequest);
+//
+//   DxcDiagnosticAggregator aggregator;
+//   aggregator.add(results);
+//
+//   for(const uint32_t diagnosticIndex : aggregator.diagnosticsInFile("common.hlsli")) { ... }
+//
+// Two messages are the same diagnostic when their file path, line, column, type and text are equal. Diagnostics keep
+// the order in which they were first reported. Not thread safe.
+class DxcDiagnosticAggregator
+{
+public:
+    void add(DxcVariantId variant, const CompilerMessage& message);
+    void add(DxcVariantId variant, const CompilerMessages& messages);
+
+    // adds the messages of every permutation that compiled, in ascending key order
+    void add(const DxcPermutationResults& results);
+
+    [[nodiscard]] size_t size() const noexcept { return mDiagnostics.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return mDiagnostics.empty(); }
+
+    [[nodiscard]] DxcAggregatedDiagnostic operator[](size_t index) const;
+
+    // the unique diagnostics of type
+    [[nodiscard]] size_t count(CompilerMessageType type) const noexcept { return mTypeCounts[(size_t)type]; }
+
+    // every message that was added, including the ones that repeat a diagnostic
+    [[nodiscard]] uint64_t messageCount() const noexcept { return mMessageCount; }
+
+    // the indices of the diagnostics reported in filePath, in the order they were first reported
+    [[nodiscard]] std::span<const uint32_t> diagnosticsInFile(std::string_view filePath) const;
+
+    // the file paths of all diagnostics, in the order they were first reported
+    [[nodiscard]] std::vector<std::string_view> filePaths() const;
+
+    void clear();
+
+private:
+    static constexpr uint32_t kNoFilePath = UINT32_MAX;
+    static constexpr uint32_t kNoDiagnostic = UINT32_MAX;
+
+    struct Diagnostic
+    {
+        uint32_t filePathIndex = kNoFilePath;
+        int32_t line = -1;
+        int32_t column = -1;
+        CompilerMessageType type = CompilerMessageType::Unknown;
+        // into mText
+        size_t textOffset = 0;
+        size_t textSize = 0;
+        // the next diagnostic whose hash is the same
+        uint32_t nextWithSameHash = kNoDiagnostic;
+        uint64_t variantCount = 0;
+        std::vector<DxcVariantRange> variants;
+    };
+
+    struct FilePath
+    {
+        std::string path;
+        std::vector<uint32_t> diagnosticIndices;
+    };
+
+    // lets the file path map be searched with a std::string_view
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] size_t operator()(std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    [[nodiscard]] uint32_t findOrAddFilePath(std::string_view filePath);
+
+    [[nodiscard]] bool matches(const Diagnostic& diagnostic,
+                               std::string_view filePath,
+                               const CompilerMessage& message,
+                               std::string_view text) const;
+
+    static void addVariant(Diagnostic& diagnostic, DxcVariantId variant);
+
+    // the text of every diagnostic, back to back
+    std::string mText;
+    std::vector<Diagnostic> mDiagnostics;
+    // the first diagnostic of each hash, the others are chained through nextWithSameHash
+    std::unordered_map<uint64_t, uint32_t> mDiagnosticsByHash;
+    std::vector<FilePath> mFilePaths;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> mFilePathIndices;
+    std::array<size_t, (size_t)CompilerMessageType::_count> mTypeCounts{};
+    uint64_t mMessageCount = 0;
+};
+} // namespace shadercompile
@@ -1,15 +1,34 @@
 #pragma once
 
 #include <shadercompile/detail/dxc_compiler_common.h>
+#include <shadercompile/dxc_job_server.h>
 #include <tl/expected.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string_view>
 
 namespace shadercompile
 {
 class Process;
+class ScratchFile;
+
+// Limits of zero are not applied. A compile that exceeds a limit is killed together with the processes it started, its
+// CompileSummary::termination tells which limit it hit.
+struct DxcProcessLimits
+{
+    std::chrono::milliseconds wallClockTimeout{0};
+    // only supported on Linux, compiles fail with std::errc::not_supported elsewhere
+    std::chrono::seconds cpuTimeLimit{0};
+    // Only supported on Linux. dxc that runs out of address space crashes, which is reported as
+    // CompileTermination::MemoryLimitExceeded.
+    size_t addressSpaceByteLimit = 0;
+};
 
 class DxcExternalCompiler : public detail::BaseDxcCompiler
 {
@@ -24,23 +43,66 @@ public:
     void addArguments(std::span<const std::wstring> args) override;
     void addArguments(std::span<std::wstring_view> args) override;
 
-    [[nodiscard]] std::span<const std::wstring> arguments() const;
+    [[nodiscard]] std::span<const std::wstring> arguments() const override;
     [[nodiscard]] std::wstring_view command() const;
 
-    tl::expected<CompileSummary, std::errc> compileFromFile(const std::filesystem::path& shaderFilePath) override;
-    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                              std::string_view shaderSourceName = {}) override;
-    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                              std::wstring_view shaderSourceName = {}) override;
+    // kept across reset()
+    void setProcessLimits(const DxcProcessLimits& limits);
+
+    [[nodiscard]] DxcProcessLimits processLimits() const;
+
+    // Bounds how many dxc processes run at once across compilers, defaults to DxcJobServer::shared(). nullptr runs
+    // every compile right away. Kept across reset().
+    void setJobServer(std::shared_ptr<DxcJobServer> jobServer);
+
+    [[nodiscard]] const std::shared_ptr<DxcJobServer>& jobServer() const noexcept;
+
+    using MessageCallback = std::function<void(const CompilerMessage& message)>;
+
+    // Called with every message as soon as dxc finished writing it, while dxc still runs, on the thread that runs the
+    // compile. The message and its views only live for the call. Compiles served from a cache do not call it. Kept
+    // across reset().
+    void setMessageCallback(MessageCallback callback) { mMessageCallback = std::move(callback); }
+
+    // Kills dxc as soon as it reports an error, instead of waiting for it to finish a compile that already failed. The
+    // compile then ends with CompileTermination::AbortedOnError and has the messages dxc finished writing by then,
+    // which include the error. Kept across reset().
+    void setAbortOnFirstError(bool abort) noexcept { mAbortOnFirstError = abort; }
+
+    [[nodiscard]] bool abortOnFirstError() const noexcept { return mAbortOnFirstError; }
 
     void reset() noexcept override;
 
+protected:
+    tl::expected<CompileSummary, std::errc> compileFromFileImpl(const std::filesystem::path& shaderFilePath) override;
+    tl::expected<CompileSummary, std::errc> compileFromBufferImpl(std::span<const std::byte> shaderSource,
+                                                                  std::wstring_view shaderSourceName) override;
+
 private:
-    tl::expected<CompileSummary, std::errc> compileFromFile(const std::filesystem::path& shaderFilePath,
-                                                            std::string_view shaderSourceName);
+    friend class DxcAsyncCompiler;
+
+    struct PendingCompile;
+
+    // The compile impls in two halves around running dxc, so that DxcAsyncCompiler can run the process from its event
+    // loop. Every successful prepare must be followed by completeCompile().
+    tl::expected<void, std::errc> prepareCompileFromFile(const std::filesystem::path& shaderFilePath);
+    tl::expected<void, std::errc> prepareCompileFromBuffer(std::span<const std::byte> shaderSource,
+                                                           std::wstring_view shaderSourceName);
+    tl::expected<CompileSummary, std::errc> completeCompile(tl::expected<int, std::errc> executeResult);
 
-    void addArtifactArguments(DxcArtifactType artifactType);
+    void discardPendingCompile() noexcept;
+
+    // parses the output of the running dxc, outputEnded parses the last message once dxc exited
+    void streamCompilerOutput(std::string_view chunk, bool outputEnded);
+
+    [[nodiscard]] Process& process() noexcept { return *mProcess; }
+
+    void addArtifactArguments(DxcArtifactType artifactType, std::optional<ScratchFile>& scratchFile);
 
     std::unique_ptr<Process> mProcess;
+    std::unique_ptr<PendingCompile> mPendingCompile;
+
+    MessageCallback mMessageCallback;
+    bool mAbortOnFirstError = false;
 };
 } // namespace shadercompile
\ No newline at end of file
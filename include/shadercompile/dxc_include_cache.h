@@ -0,0 +1,72 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+struct DxcIncludeCacheStatistics
+{
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    // misses caused by a cached file whose modification time or size changed on disk
+    uint64_t invalidationCount = 0;
+    size_t fileCount = 0;
+    size_t contentCount = 0;
+    size_t contentByteCount = 0;
+};
+
+// A thread-safe cache of #include file contents, shared by any number of DxcLibraryCompiler objects through
+// DxcLibraryCompiler::setIncludeCache(). Each load costs one stat of the file; the file is only read again when its
+// modification time or size has changed. Contents are stored by hash, so identical files reached through different
+// paths share one buffer.
+class DxcIncludeCache
+{
+public:
+    using Contents = std::shared_ptr<const std::vector<std::byte>>;
+
+    struct File
+    {
+        Contents contents;
+        uint64_t contentHash = 0;
+    };
+
+    [[nodiscard]] tl::expected<Contents, std::errc> load(const std::filesystem::path& path);
+
+    // the same as load() but also returns the hash of the contents, which is computed only when the file is read
+    [[nodiscard]] tl::expected<File, std::errc> loadFile(const std::filesystem::path& path);
+
+    void clear();
+
+    [[nodiscard]] DxcIncludeCacheStatistics statistics() const;
+
+    void resetStatistics() noexcept;
+
+private:
+    struct FileEntry
+    {
+        std::filesystem::file_time_type lastWriteTime;
+        uintmax_t size = 0;
+        File file;
+    };
+
+    [[nodiscard]] Contents internContents(uint64_t hash, std::vector<std::byte> contents);
+
+    mutable std::shared_mutex mMutex;
+    std::unordered_map<std::filesystem::path::string_type, FileEntry> mFiles;
+    std::unordered_map<uint64_t, std::weak_ptr<const std::vector<std::byte>>> mContents;
+
+    std::atomic<uint64_t> mHitCount = 0;
+    std::atomic<uint64_t> mMissCount = 0;
+    std::atomic<uint64_t> mInvalidationCount = 0;
+};
+} // namespace shadercompile
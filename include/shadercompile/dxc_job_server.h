@@ -0,0 +1,117 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <system_error>
+
+namespace shadercompile
+{
+struct DxcJobServerStatistics
+{
+    uint64_t acquiredCount = 0;
+    // acquisitions that had to wait for a token
+    uint64_t waitCount = 0;
+    size_t heldCount = 0;
+};
+
+// Limits how many external dxc processes run at once. Every Process::execute() of a DxcExternalCompiler holds a token
+// while its child runs.
+//
+// Inside a build driven by GNU make, the tokens come from make's jobserver, which MAKEFLAGS names either as a fifo
+// (--jobserver-auth=fifo:PATH) or as a pair of inherited pipe descriptors (--jobserver-auth=R,W). That keeps the
+// compiles within the -j budget of the whole build. This process already holds one implicit token, it is used first,
+// and the others are read from the jobserver and written back when the child exits. The make rule has to be marked
+// with + for make to pass the pipe descriptors on.
+//
+// Without a jobserver the tokens come from a local semaphore. On Windows the local semaphore is always used.
+class DxcJobServer : public std::enable_shared_from_this<DxcJobServer>
+{
+public:
+    enum class Kind
+    {
+        Fifo,
+        Pipe,
+        Local
+    };
+
+    // returns its token to the jobserver when it is destroyed
+    class Token
+    {
+    public:
+        Token() = default;
+        Token(const Token&) = delete;
+        Token(Token&& other) noexcept;
+        ~Token();
+
+        Token& operator=(const Token&) = delete;
+        Token& operator=(Token&& other) noexcept;
+
+        void release() noexcept;
+
+    private:
+        friend class DxcJobServer;
+
+        Token(std::shared_ptr<DxcJobServer> jobServer, bool implicit, char value)
+            : mJobServer(std::move(jobServer))
+            , mImplicit(implicit)
+            , mValue(value)
+        {}
+
+        std::shared_ptr<DxcJobServer> mJobServer;
+        bool mImplicit = false;
+        // the byte read from the jobserver, make expects the same byte back
+        char mValue = 0;
+    };
+
+    // The jobserver named by MAKEFLAGS, or a local semaphore of localTokenCount tokens when there is none or it cannot
+    // be opened. localTokenCount defaults to the number of hardware threads.
+    [[nodiscard]] static std::shared_ptr<DxcJobServer> fromEnvironment(size_t localTokenCount = 0);
+
+    [[nodiscard]] static std::shared_ptr<DxcJobServer> createLocal(size_t tokenCount);
+
+    // created from the environment on first use, the default of every DxcExternalCompiler
+    [[nodiscard]] static const std::shared_ptr<DxcJobServer>& shared();
+
+    ~DxcJobServer();
+
+    DxcJobServer(const DxcJobServer&) = delete;
+    DxcJobServer& operator=(const DxcJobServer&) = delete;
+
+    [[nodiscard]] Kind kind() const noexcept { return mKind; }
+
+    // Blocks until a token is available. Stopping cancellationToken makes it fail with std::errc::operation_canceled,
+    // a jobserver that make closed fails with std::errc::broken_pipe.
+    [[nodiscard]] tl::expected<Token, std::errc> acquire(std::stop_token cancellationToken = {});
+
+    [[nodiscard]] DxcJobServerStatistics statistics() const;
+
+private:
+    DxcJobServer(Kind kind, size_t localTokenCount);
+
+    void releaseToken(bool implicit, char value) noexcept;
+
+    // reads a token from make's jobserver without blocking, std::nullopt when there is none
+    [[nodiscard]] tl::expected<std::optional<char>, std::errc> tryReadToken() noexcept;
+
+    Kind mKind = Kind::Local;
+
+    mutable std::mutex mMutex;
+    std::condition_variable_any mTokenReleased;
+    bool mImplicitTokenHeld = false;
+    size_t mAvailableLocalTokens = 0;
+    DxcJobServerStatistics mStatistics;
+
+    // the same descriptor for a fifo
+    int mReadDescriptor = -1;
+    int mWriteDescriptor = -1;
+    // whether the read descriptor was opened here, the descriptors inherited from make stay open
+    bool mOwnsReadDescriptor = false;
+};
+} // namespace shadercompile
@@ -4,21 +4,36 @@
 #include <tl/expected.hpp>
 
 #include <filesystem>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
 struct DxcBuffer;
-struct IDxcUtils;
 
 namespace shadercompile
 {
+class DxcIncludeCache;
+
+// Compiles in-process through dxcompiler. Instances are cheap: the DXC compiler, utils and include handler objects are
+// cached per thread rather than per instance, so each worker thread can own its own DxcLibraryCompiler and compile in
+// parallel without sharing any mutable state.
+//
+// On Windows dxcompiler is linked through its import library. Elsewhere libdxcompiler.so is loaded with dlopen on the
+// first compile, so programs that never use this backend do not pay for loading it.
 class DxcLibraryCompiler : public detail::BaseDxcCompiler
 {
 public:
     ~DxcLibraryCompiler() override = default;
 
+#ifndef _WIN32
+    // Sets the libdxcompiler.so loaded by the first compile, for example the lib/libdxcompiler.so of an extracted DXC
+    // release. A bare file name is resolved through the dynamic linker's search path, which is what happens with the
+    // default of "libdxcompiler.so". Returns false once the library has been loaded.
+    static bool setLibraryPath(std::filesystem::path libraryPath);
+#endif
+
     void addArgument(std::string_view arg) override;
     void addArguments(std::span<const std::string> args) override;
     void addArguments(std::span<std::string_view> args) override;
@@ -26,21 +41,34 @@ public:
     void addArguments(std::span<const std::wstring> args) override;
     void addArguments(std::span<std::wstring_view> args) override;
 
-    [[nodiscard]] std::span<const std::wstring> arguments() const { return mArguments; }
+    [[nodiscard]] std::span<const std::wstring> arguments() const override { return mArguments; }
+
+    // Serves #include files from a cache that can be shared with other compilers on any thread. Without a cache every
+    // compile reads its includes from disk. The cache is kept across reset().
+    void setIncludeCache(std::shared_ptr<DxcIncludeCache> includeCache) noexcept
+    {
+        mIncludeCache = std::move(includeCache);
+    }
+
+    [[nodiscard]] const std::shared_ptr<DxcIncludeCache>& includeCache() const noexcept { return mIncludeCache; }
 
     void reset() noexcept override;
 
-    tl::expected<CompileSummary, std::errc> compileFromFile(const std::filesystem::path& shaderFilePath) override;
-    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                              std::string_view shaderSourceName) override;
-    tl::expected<CompileSummary, std::errc> compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                              std::wstring_view shaderSourceName) override;
+protected:
+    tl::expected<CompileSummary, std::errc> compileFromFileImpl(const std::filesystem::path& shaderFilePath) override;
+    tl::expected<CompileSummary, std::errc> compileFromBufferImpl(std::span<const std::byte> shaderSource,
+                                                                  std::wstring_view shaderSourceName) override;
 
 private:
+    struct DxcThreadInstances;
+
+    [[nodiscard]] static DxcThreadInstances* getDxcThreadInstances();
+
     tl::expected<CompileSummary, std::errc>
-    compileFromBuffer(DxcBuffer source, std::wstring_view shaderSourceName, Microsoft::WRL::ComPtr<IDxcUtils> utils);
+    compileDxcBuffer(DxcBuffer source, std::wstring_view shaderSourceName, DxcThreadInstances& instances);
 
     std::vector<std::wstring> mArguments;
     std::vector<const std::wstring::value_type*> mArgumentsBuffer;
+    std::shared_ptr<DxcIncludeCache> mIncludeCache;
 };
 } // namespace shadercompile
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <shadercompile/dxc_batch_compiler.h>
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace shadercompile
+{
+// Identifies one permutation of a DxcPermutationSet. It is a mixed-radix number whose digits are the value index
+// chosen on each axis, with the first axis as the least significant digit.
+using DxcPermutationKey = uint64_t;
+
+struct DxcPermutationAxis
+{
+    std::wstring define;
+    std::vector<std::wstring> values;
+};
+
+// The variants of one shader, described as axes of preprocessor defines. Every permutation picks one value per axis;
+// exclusion rules remove the combinations that are never used.
+class DxcPermutationSet
+{
+public:
+    using ExclusionPredicate = std::function<bool(const DxcPermutationSet& permutationSet, DxcPermutationKey key)>;
+
+    // Returns the index of the new axis. Fails with std::errc::invalid_argument for an axis without values or for a
+    // define that already has an axis, and with std::errc::value_too_large when the number of permutations would no
+    // longer fit in a DxcPermutationKey.
+    tl::expected<size_t, std::errc> addAxis(std::wstring define, std::vector<std::wstring> values);
+    tl::expected<size_t, std::errc> addAxis(std::string_view define, std::span<const std::string_view> values);
+
+    // an axis with the values 0 and 1
+    tl::expected<size_t, std::errc> addBoolAxis(std::wstring define);
+    tl::expected<size_t, std::errc> addBoolAxis(std::string_view define);
+
+    // Excludes every permutation in which each of the defines has the paired value. Fails with
+    // std::errc::invalid_argument when a define has no axis or the value is not on its axis.
+    tl::expected<void, std::errc>
+    exclude(std::span<const std::pair<std::wstring_view, std::wstring_view>> conditions);
+
+    // excludes every permutation for which predicate returns true
+    void excludeIf(ExclusionPredicate predicate);
+
+    [[nodiscard]] std::span<const DxcPermutationAxis> axes() const noexcept { return mAxes; }
+
+    [[nodiscard]] std::optional<size_t> findAxis(std::wstring_view define) const noexcept;
+
+    // the size of the cartesian product of all axes, including the excluded permutations
+    [[nodiscard]] DxcPermutationKey permutationCount() const noexcept { return mPermutationCount; }
+
+    [[nodiscard]] size_t valueIndex(DxcPermutationKey key, size_t axisIndex) const noexcept;
+
+    [[nodiscard]] const std::wstring& value(DxcPermutationKey key, size_t axisIndex) const noexcept;
+
+    // returns std::nullopt when there is not exactly one index per axis or an index is out of range
+    [[nodiscard]] std::optional<DxcPermutationKey> makeKey(std::span<const size_t> valueIndices) const noexcept;
+
+    [[nodiscard]] bool isExcluded(DxcPermutationKey key) const;
+
+    // every permutation that is not excluded, in ascending key order
+    [[nodiscard]] std::vector<DxcPermutationKey> enumerate() const;
+
+    // appends `-D<define>=<value>` for every axis
+    void appendDefineArguments(DxcPermutationKey key, std::vector<std::wstring>& arguments) const;
+
+private:
+    struct Condition
+    {
+        size_t axisIndex = 0;
+        size_t valueIndex = 0;
+    };
+
+    std::vector<DxcPermutationAxis> mAxes;
+    std::vector<DxcPermutationKey> mStrides;
+    DxcPermutationKey mPermutationCount = 1;
+
+    std::vector<std::vector<Condition>> mExclusions;
+    std::vector<ExclusionPredicate> mExclusionPredicates;
+};
+
+using DxcPermutationResults = std::unordered_map<DxcPermutationKey, tl::expected<CompileResult, std::errc>>;
+
+// Compiles the permutations of a DxcPermutationSet in parallel on a DxcBatchCompiler:
+//
+//   DxcPermutationSet permutations;
+//   permutations.addBoolAxis("USE_NORMAL_MAP");
+//   permutations.addAxis("LIGHT_COUNT", std::array{"1"sv, "2"sv, "4"sv});
+//
+//   DxcPermutationCompiler compiler([]() { return std::make_unique<DxcLibraryCompiler>(); });
+//   DxcPermutationResults results = compiler.compile(permutations, baseRequest);
+class DxcPermutationCompiler
+{
+public:
+    // called for every permutation after the defines were added, e.g. to give file sinks a path per permutation
+    using RequestCustomizer =
+        std::function<void(const DxcPermutationSet& permutationSet, DxcPermutationKey key, CompileRequest& request)>;
+
+    // threadCount defaults to the number of hardware threads
+    explicit DxcPermutationCompiler(DxcBatchCompiler::CompilerFactory compilerFactory, size_t threadCount = 0);
+
+    [[nodiscard]] size_t threadCount() const noexcept { return mBatchCompiler.threadCount(); }
+
+    // e.g. to enable preprocess deduplication, which skips permutations that preprocess to an already compiled source
+    [[nodiscard]] DxcBatchCompiler& batchCompiler() noexcept { return mBatchCompiler; }
+
+    // Compiles every permutation that is not excluded. Each request is a copy of baseRequest with the defines of the
+    // permutation appended to its arguments.
+    [[nodiscard]] DxcPermutationResults compile(const DxcPermutationSet& permutationSet,
+                                                const CompileRequest& baseRequest,
+                                                const RequestCustomizer& customizeRequest = {});
+
+    // compiles only the given permutations, whether they are excluded or not
+    [[nodiscard]] DxcPermutationResults compile(const DxcPermutationSet& permutationSet,
+                                                std::span<const DxcPermutationKey> keys,
+                                                const CompileRequest& baseRequest,
+                                                const RequestCustomizer& customizeRequest = {});
+
+private:
+    DxcBatchCompiler mBatchCompiler;
+};
+} // namespace shadercompile
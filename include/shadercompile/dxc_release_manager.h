@@ -5,6 +5,7 @@
 #include <charconv>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <vector>
@@ -58,6 +59,9 @@ struct DxcVersion
     }
 };
 
+#ifdef _WIN32
+// Releases are downloaded from GitHub through WinHTTP, so the release manager is only available on Windows. Elsewhere
+// DXC comes from the system or from a release extracted by other means.
 struct DxcRelease
 {
     DxcVersion version;
@@ -102,4 +106,5 @@ private:
     std::vector<DxcRelease> mReleases;
     std::unique_ptr<HttpRequest> mGitHubRequest;
 };
+#endif
 } // namespace shadercompile
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+#include <tl/expected.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace shadercompile
+{
+class CompileServerConnection;
+
+namespace detail
+{
+struct CompileServerRequest;
+}
+
+// Compiles through a resident shadercompile_server child process. The server keeps a DxcLibraryCompiler loaded between
+// requests, so compiles cost about the same as the library backend while a compiler crash only takes down the server.
+// A crashed server is restarted on the next compile.
+class DxcServerCompiler : public detail::BaseDxcCompiler
+{
+public:
+    explicit DxcServerCompiler(std::filesystem::path serverPath);
+    ~DxcServerCompiler() override;
+
+    void addArgument(std::string_view arg) override;
+    void addArguments(std::span<const std::string> args) override;
+    void addArguments(std::span<std::string_view> args) override;
+    void addArgument(std::wstring_view arg) override;
+    void addArguments(std::span<const std::wstring> args) override;
+    void addArguments(std::span<std::wstring_view> args) override;
+
+    [[nodiscard]] std::span<const std::wstring> arguments() const override { return mArguments; }
+
+    void reset() noexcept override;
+
+protected:
+    explicit DxcServerCompiler(std::unique_ptr<CompileServerConnection> connection);
+
+    tl::expected<CompileSummary, std::errc> compileFromFileImpl(const std::filesystem::path& shaderFilePath) override;
+    tl::expected<CompileSummary, std::errc> compileFromBufferImpl(std::span<const std::byte> shaderSource,
+                                                                  std::wstring_view shaderSourceName) override;
+
+private:
+    [[nodiscard]] bool connectsToDaemon() const noexcept;
+
+    tl::expected<CompileSummary, std::errc> compile(detail::CompileServerRequest& request);
+
+    std::unique_ptr<CompileServerConnection> mConnection;
+    std::vector<std::wstring> mArguments;
+    std::vector<std::byte> mFrameBuffer;
+};
+
+// Compiles through a `shadercompile_server --daemon` shared by every process on the machine, so build processes
+// share the daemon's compilers, its in-memory result cache and compiles of identical requests that are in flight at
+// the same time. Switching from another backend only changes how the compiler is constructed:
+//
+//   std::unique_ptr<detail::BaseDxcCompiler> compiler = std::make_unique<DxcDaemonCompiler>();
+//
+// The daemon is not started on demand; without one every compile fails with the error of the connection attempt.
+// Relative source, include directory and output paths are resolved against this process's working directory before
+// they are sent. Daemons are not supported on Windows.
+class DxcDaemonCompiler final : public DxcServerCompiler
+{
+public:
+    explicit DxcDaemonCompiler(std::filesystem::path socketPath = defaultSocketPath());
+
+    // $XDG_RUNTIME_DIR/shadercompile.sock, or a per-user socket in the temporary directory without XDG_RUNTIME_DIR
+    [[nodiscard]] static std::filesystem::path defaultSocketPath();
+};
+} // namespace shadercompile
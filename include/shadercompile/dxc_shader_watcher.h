@@ -0,0 +1,112 @@
+#pragma once
+
+#include <shadercompile/dxc_batch_compiler.h>
+#include <shadercompile/dxc_dependency_graph.h>
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace shadercompile
+{
+// Recompiles shaders when their sources or #include files change, for editors that reload shaders on save:
+//
+//   DxcShaderWatcher watcher([]() { return std::make_unique<DxcLibraryCompiler>(); },
+//                            [&](DxcShaderWatcher::RequestId id, const CompileRequest& request,
+//                                tl::expected<CompileResult, std::errc> result) { reloadShader(id, result); });
+//   watcher.watch(request);
+//   watcher.start();
+//
+// Every watched request is compiled once when the watcher starts, or when it is watched later. The files each compile
+// read are recorded in a DxcDependencyGraph and the directories holding them are watched, so a change only recompiles
+// the requests that read a changed file. Changes are collected until no new change arrives for the debounce interval,
+// so saving several files at once compiles each affected request once. Requests whose last compile failed are
+// compiled again on every change, since the files they read may not be known.
+//
+// Requests compile on a DxcBatchCompiler and the callback runs on the watcher's thread. Only Linux is supported, where
+// the files are watched with inotify; elsewhere start() fails with std::errc::not_supported.
+class DxcShaderWatcher
+{
+public:
+    using RequestId = uint64_t;
+    using ResultCallback = std::function<void(
+        RequestId requestId, const CompileRequest& request, tl::expected<CompileResult, std::errc> result)>;
+
+    static constexpr std::chrono::milliseconds kDefaultDebounceInterval{50};
+
+    // threadCount defaults to the number of hardware threads
+    DxcShaderWatcher(DxcBatchCompiler::CompilerFactory compilerFactory,
+                     ResultCallback resultCallback,
+                     size_t threadCount = 0);
+    ~DxcShaderWatcher();
+
+    DxcShaderWatcher(const DxcShaderWatcher&) = delete;
+    DxcShaderWatcher& operator=(const DxcShaderWatcher&) = delete;
+
+    void setDebounceInterval(std::chrono::milliseconds debounceInterval);
+
+    // The source of a buffer request must stay alive until the request is no longer watched. Requests that compile
+    // the same source share its recorded dependencies.
+    RequestId watch(CompileRequest request);
+
+    // a compile of the request that is already running finishes, but its result is not delivered
+    void unwatch(RequestId requestId);
+
+    tl::expected<void, std::errc> start();
+
+    // must not be called from the result callback
+    void stop();
+
+    [[nodiscard]] bool running() const noexcept { return mThread.joinable(); }
+
+    [[nodiscard]] const std::shared_ptr<DxcDependencyGraph>& dependencyGraph() const noexcept
+    {
+        return mDependencyGraph;
+    }
+
+private:
+    enum class RequestState
+    {
+        NotCompiled,
+        // the last compile succeeded and its dependencies are in the graph
+        UpToDate,
+        Failed
+    };
+
+    struct WatchedRequest
+    {
+        CompileRequest request;
+        RequestState state = RequestState::NotCompiled;
+    };
+
+    struct FileWatcherState;
+
+    void watcherMain();
+
+    // Compiles the requests that were never compiled, those whose source is in staleCompiles and did not fail and, when
+    // filesChanged is set, those whose last compile failed. Returns whether any request was compiled.
+    bool compileRequests(const std::vector<DxcRecordedCompile>& staleCompiles, bool filesChanged);
+
+    void watchDependencyDirectories();
+
+    std::shared_ptr<DxcDependencyGraph> mDependencyGraph;
+    DxcBatchCompiler mBatchCompiler;
+    ResultCallback mResultCallback;
+
+    std::mutex mMutex;
+    std::unordered_map<RequestId, WatchedRequest> mRequests;
+    RequestId mNextRequestId = 1;
+    std::chrono::milliseconds mDebounceInterval = kDefaultDebounceInterval;
+    bool mStopping = false;
+
+    std::unique_ptr<FileWatcherState> mFileWatcherState;
+    std::thread mThread;
+};
+} // namespace shadercompile
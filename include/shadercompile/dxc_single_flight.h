@@ -0,0 +1,90 @@
+#pragma once
+
+#include <shadercompile/dxc_compile_cache.h>
+#include <shadercompile/dxc_include_cache.h>
+#include <tl/expected.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+namespace shadercompile
+{
+struct DxcSingleFlightStatistics
+{
+    // compiles that ran because no identical compile was in flight
+    uint64_t leaderCount = 0;
+    // compiles that waited for an identical compile in flight and took its result
+    uint64_t followerCount = 0;
+    // compiles whose #include dependencies could not be determined, they always run on their own
+    uint64_t uncacheableCount = 0;
+    size_t inFlightCount = 0;
+};
+
+// Lets compilers on different threads that are asked for the same compile at the same time run it once. The first
+// compiler to ask becomes the leader and compiles, the others wait for its result and restore it as if it came from a
+// cache. Compiles are keyed by the same fingerprint as DxcCompileCache, and the leader's result is shared as one
+// immutable entry, so the memory sink artifacts of every waiting compiler point at the same buffers. Only compiles
+// whose key inputs are equal share a flight, a compile whose hash collides with a flight of other inputs runs on its
+// own.
+//
+// Unlike the caches, the result of a compile that reported errors is shared as well, it is only ever handed to the
+// compiles in flight with it. When the leader fails without a result the waiting compilers compile on their own.
+//
+// Compilers use it once it is attached with BaseDxcCompiler::setSingleFlight() and their DXC version is set with
+// BaseDxcCompiler::setCompilerVersion(). It is joined after the attached caches missed.
+class DxcSingleFlight
+{
+public:
+    using Entry = std::shared_ptr<const DxcCompileCacheEntry>;
+
+    struct Ticket
+    {
+        // a leader has to call complete() with the key, even when its compile fails
+        bool leader = false;
+        // the leader's entry, nullptr when this compile has to run on its own
+        std::shared_future<Entry> result;
+    };
+
+    [[nodiscard]] tl::expected<DxcCompileKey, std::errc> computeKey(std::span<const std::byte> source,
+                                                                    const std::filesystem::path& sourcePath,
+                                                                    std::span<const std::wstring> arguments,
+                                                                    const DxcVersion& compilerVersion,
+                                                                    std::span<const DxcArtifactType> artifactTypes);
+
+    [[nodiscard]] Ticket join(const DxcCompileKey& key);
+
+    // publishes the leader's result to the compiles waiting on key, nullptr makes them compile on their own
+    void complete(const DxcCompileKey& key, Entry entry);
+
+    [[nodiscard]] DxcSingleFlightStatistics statistics() const;
+
+    void resetStatistics() noexcept;
+
+private:
+    struct Flight
+    {
+        std::string inputs;
+        std::promise<Entry> promise;
+        std::shared_future<Entry> result;
+    };
+
+    mutable std::mutex mMutex;
+    std::unordered_map<uint64_t, Flight> mFlights;
+
+    // headers are only reread when they change on disk
+    DxcIncludeCache mIncludeCache;
+
+    std::atomic<uint64_t> mLeaderCount = 0;
+    std::atomic<uint64_t> mFollowerCount = 0;
+    std::atomic<uint64_t> mUncacheableCount = 0;
+};
+} // namespace shadercompile
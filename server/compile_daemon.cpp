@@ -0,0 +1,406 @@
+#include "compile_daemon.h"
+
+#include "compile_request_handler.h"
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#include <shadercompile/dxc_artifact_cache.h>
+#include <shadercompile/dxc_external_compiler.h>
+#include <shadercompile/dxc_library_compiler.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+#ifdef _WIN32
+int runCompileDaemon(const CompileDaemonOptions& /*options*/)
+{
+    std::fprintf(stderr, "shadercompile_server: --daemon is not supported on Windows\n");
+    return 1;
+}
+#else
+namespace
+{
+// The daemon runs a single DXC for its whole lifetime and its cache only lives in memory, so cache keys do not need the
+// real version to tell compilers apart.
+constexpr DxcVersion kDaemonCompilerVersion{.major = 0, .minor = 0, .micro = 0, .patch = 0};
+
+// unlinked by the signal handler, which may only call async-signal-safe functions
+std::array<char, sizeof(sockaddr_un::sun_path)> gSocketPath{};
+
+extern "C" void handleTerminationSignal(int /*signal*/)
+{
+    unlink(gSocketPath.data());
+    _exit(0);
+}
+
+bool receiveAll(int socket, std::span<std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        const ssize_t bytesRead = recv(socket, bytes.data(), bytes.size(), 0);
+
+        if(bytesRead < 0 && errno == EINTR) { continue; }
+
+        if(bytesRead <= 0) { return false; }
+
+        bytes = bytes.subspan(bytesRead);
+    }
+
+    return true;
+}
+
+bool sendAll(int socket, std::span<const std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        // a client that went away must not raise SIGPIPE in the daemon
+        const ssize_t bytesWritten = send(socket, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+
+        if(bytesWritten < 0 && errno == EINTR) { continue; }
+
+        if(bytesWritten <= 0) { return false; }
+
+        bytes = bytes.subspan(bytesWritten);
+    }
+
+    return true;
+}
+
+class CompileDaemon
+{
+public:
+    explicit CompileDaemon(const CompileDaemonOptions& options)
+        : mOptions(options)
+        , mArtifactCache(std::make_shared<DxcArtifactCache>(options.cacheByteBudget))
+    {
+        mCompilerCount = (options.compilerCount != 0) ? options.compilerCount
+                                                      : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        // releasing a compiler then cannot allocate, it also runs while an exception unwinds
+        mIdleCompilers.reserve(mCompilerCount);
+    }
+
+    void serveClient(int clientSocket);
+
+private:
+    using Frame = std::shared_ptr<const std::vector<std::byte>>;
+
+    struct InFlightRequest
+    {
+        std::vector<std::byte> payload;
+        std::shared_future<Frame> response;
+    };
+
+    [[nodiscard]] Frame compile(std::span<const std::byte> payload);
+    [[nodiscard]] Frame compileDeduplicated(std::span<const std::byte> payload);
+    [[nodiscard]] static Frame encodeError(std::errc error);
+
+    [[nodiscard]] std::unique_ptr<detail::BaseDxcCompiler> acquireCompiler();
+    void releaseCompiler(std::unique_ptr<detail::BaseDxcCompiler> compiler);
+
+    CompileDaemonOptions mOptions;
+    std::shared_ptr<DxcArtifactCache> mArtifactCache;
+
+    std::mutex mCompilerMutex;
+    std::condition_variable mCompilerReleased;
+    std::vector<std::unique_ptr<detail::BaseDxcCompiler>> mIdleCompilers;
+    size_t mCompilerCount = 0;
+    size_t mCreatedCompilerCount = 0;
+
+    std::mutex mInFlightMutex;
+    std::unordered_map<uint64_t, std::shared_ptr<InFlightRequest>> mInFlightRequests;
+};
+
+// Runs on a detached thread, so nothing may escape it. A request that throws is answered with an error, anything else
+// that throws drops the client.
+void CompileDaemon::serveClient(int clientSocket)
+{
+    auto closeClientSocket = finally([&]() { close(clientSocket); });
+
+    try
+    {
+        std::vector<std::byte> payload;
+
+        for(;;)
+        {
+            std::array<std::byte, 4> header;
+
+            // the client disconnected
+            if(!receiveAll(clientSocket, header)) { return; }
+
+            const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(header);
+
+            if(!payloadSize) { return; }
+
+            payload.resize(payloadSize.value());
+
+            if(!receiveAll(clientSocket, payload)) { return; }
+
+            Frame response;
+
+            try
+            {
+                response = compileDeduplicated(payload);
+            }
+            catch(const std::exception& exception)
+            {
+                std::fprintf(stderr, "shadercompile_server: request failed: %s\n", exception.what());
+                response = encodeError(std::errc::state_not_recoverable);
+            }
+            catch(...)
+            {
+                std::fprintf(stderr, "shadercompile_server: request failed\n");
+                response = encodeError(std::errc::state_not_recoverable);
+            }
+
+            if(!sendAll(clientSocket, *response)) { return; }
+        }
+    }
+    catch(...)
+    {
+        std::fprintf(stderr, "shadercompile_server: dropping a client after an error\n");
+    }
+}
+
+CompileDaemon::Frame CompileDaemon::compileDeduplicated(std::span<const std::byte> payload)
+{
+    // Requests are identical when their payloads are: paths arrive absolute, and a file source compiled twice at the
+    // same time reads the same contents.
+    Fnv1aHash hash;
+    hash.update(payload);
+    const uint64_t key = hash.value();
+
+    std::promise<Frame> responsePromise;
+    std::shared_future<Frame> inFlightResponse;
+    bool hashCollision = false;
+
+    {
+        std::lock_guard lock(mInFlightMutex);
+
+        auto itr = mInFlightRequests.find(key);
+
+        if(itr == mInFlightRequests.end())
+        {
+            auto inFlightRequest = std::make_shared<InFlightRequest>();
+            inFlightRequest->payload.assign(payload.begin(), payload.end());
+            inFlightRequest->response = responsePromise.get_future().share();
+
+            mInFlightRequests.emplace(key, std::move(inFlightRequest));
+        }
+        else if(std::ranges::equal(itr->second->payload, payload)) { inFlightResponse = itr->second->response; }
+        else { hashCollision = true; }
+    }
+
+    if(inFlightResponse.valid()) { return inFlightResponse.get(); }
+
+    // a request whose key is taken by a different one is compiled on its own
+    if(hashCollision) { return compile(payload); }
+
+    // the waiting requests are released and the entry is erased however the compile ends
+    auto eraseInFlightRequest = finally(
+        [&]()
+        {
+            std::lock_guard lock(mInFlightMutex);
+            mInFlightRequests.erase(key);
+        });
+
+    Frame response;
+
+    try
+    {
+        response = compile(payload);
+    }
+    catch(...)
+    {
+        responsePromise.set_exception(std::current_exception());
+        throw;
+    }
+
+    responsePromise.set_value(response);
+
+    return response;
+}
+
+CompileDaemon::Frame CompileDaemon::compile(std::span<const std::byte> payload)
+{
+    tl::expected<detail::CompileServerRequest, std::errc> request = detail::decodeCompileServerRequest(payload);
+
+    if(!request) { return encodeError(request.error()); }
+
+    std::unique_ptr<detail::BaseDxcCompiler> compiler = acquireCompiler();
+    auto releaseAcquiredCompiler = finally([&]() { releaseCompiler(std::move(compiler)); });
+
+    const detail::CompileServerResponse response = handleCompileRequest(*compiler, request.value());
+
+    auto frame = std::make_shared<std::vector<std::byte>>();
+    detail::encodeCompileServerResponse(response, *frame);
+
+    return frame;
+}
+
+CompileDaemon::Frame CompileDaemon::encodeError(std::errc error)
+{
+    detail::CompileServerResponse response;
+    response.error = error;
+
+    auto frame = std::make_shared<std::vector<std::byte>>();
+    detail::encodeCompileServerResponse(response, *frame);
+
+    return frame;
+}
+
+std::unique_ptr<detail::BaseDxcCompiler> CompileDaemon::acquireCompiler()
+{
+    std::unique_lock lock(mCompilerMutex);
+
+    mCompilerReleased.wait(lock, [&]() { return !mIdleCompilers.empty() || mCreatedCompilerCount < mCompilerCount; });
+
+    if(!mIdleCompilers.empty())
+    {
+        std::unique_ptr<detail::BaseDxcCompiler> compiler = std::move(mIdleCompilers.back());
+        mIdleCompilers.pop_back();
+        return compiler;
+    }
+
+    ++mCreatedCompilerCount;
+    lock.unlock();
+
+    std::unique_ptr<detail::BaseDxcCompiler> compiler;
+
+    try
+    {
+        if(mOptions.dxcPath.empty()) { compiler = std::make_unique<DxcLibraryCompiler>(); }
+        else { compiler = std::make_unique<DxcExternalCompiler>(mOptions.dxcPath); }
+    }
+    catch(...)
+    {
+        // the compiler was never created, another request may try again
+        lock.lock();
+        --mCreatedCompilerCount;
+        lock.unlock();
+
+        mCompilerReleased.notify_one();
+        throw;
+    }
+
+    compiler->setCompilerVersion(kDaemonCompilerVersion);
+    compiler->setArtifactCache(mArtifactCache);
+
+    return compiler;
+}
+
+void CompileDaemon::releaseCompiler(std::unique_ptr<detail::BaseDxcCompiler> compiler)
+{
+    {
+        std::lock_guard lock(mCompilerMutex);
+        mIdleCompilers.push_back(std::move(compiler));
+    }
+
+    mCompilerReleased.notify_one();
+}
+} // namespace
+
+int runCompileDaemon(const CompileDaemonOptions& options)
+{
+    const std::string socketPath = options.socketPath.string();
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if(socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::fprintf(stderr, "shadercompile_server: invalid socket path '%s'\n", socketPath.c_str());
+        return 1;
+    }
+
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    const int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(listenSocket == -1) { return 1; }
+
+    // a socket file that nobody accepts on is left over from a daemon that was killed, it is replaced
+    if(connect(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+    {
+        std::fprintf(stderr, "shadercompile_server: a daemon is already listening on '%s'\n", socketPath.c_str());
+        return 1;
+    }
+
+    close(listenSocket);
+
+    const int serverSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(serverSocket == -1) { return 1; }
+
+    unlink(socketPath.c_str());
+
+    // only the user running the daemon may connect, the socket is created without any permissions for others
+    const mode_t previousMask = umask(0077);
+    const int bindResult = bind(serverSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    umask(previousMask);
+
+    if(bindResult != 0 || listen(serverSocket, SOMAXCONN) != 0)
+    {
+        std::fprintf(stderr, "shadercompile_server: cannot listen on '%s': %s\n", socketPath.c_str(), strerror(errno));
+        close(serverSocket);
+        return 1;
+    }
+
+    std::memcpy(gSocketPath.data(), socketPath.c_str(), socketPath.size() + 1);
+    signal(SIGINT, handleTerminationSignal);
+    signal(SIGTERM, handleTerminationSignal);
+    signal(SIGHUP, handleTerminationSignal);
+
+    std::fprintf(stderr, "shadercompile_server: listening on '%s'\n", socketPath.c_str());
+
+    CompileDaemon daemon(options);
+
+    for(;;)
+    {
+        const int clientSocket = accept4(serverSocket, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if(clientSocket == -1)
+        {
+            if(errno == EINTR || errno == ECONNABORTED) { continue; }
+
+            // out of descriptors, the clients being served have to finish first
+            if(errno == EMFILE || errno == ENFILE)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+
+            std::fprintf(stderr, "shadercompile_server: accept failed: %s\n", strerror(errno));
+
+            // the detached client threads still use daemon, so it must not be destroyed by returning
+            unlink(socketPath.c_str());
+            _exit(1);
+        }
+
+        std::thread(&CompileDaemon::serveClient, &daemon, clientSocket).detach();
+    }
+}
+#endif
+} // namespace shadercompile
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace shadercompile
+{
+struct CompileDaemonOptions
+{
+    std::filesystem::path socketPath;
+    // defaults to the number of hardware threads
+    size_t compilerCount = 0;
+    size_t cacheByteBudget = 256 * 1024 * 1024;
+    // compiles in-process through dxcompiler when empty, otherwise by running this dxc executable
+    std::filesystem::path dxcPath;
+};
+
+// Serves compile requests from any number of local clients on a Unix domain socket until the process is terminated.
+// Every client connection gets its own thread, the compiles themselves run on a fixed set of compilers that share one
+// in-memory result cache. Identical requests that are in flight at the same time, from the same or different clients,
+// are compiled once. Returns the process exit code.
+int runCompileDaemon(const CompileDaemonOptions& options);
+} // namespace shadercompile
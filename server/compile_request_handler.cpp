@@ -0,0 +1,50 @@
+#include "compile_request_handler.h"
+
+#include "utility.h"
+
+namespace shadercompile
+{
+detail::CompileServerResponse handleCompileRequest(detail::BaseDxcCompiler& compiler,
+                                                   const detail::CompileServerRequest& request)
+{
+    detail::CompileServerResponse response;
+
+    compiler.reset();
+    compiler.setMaxMessageCount((size_t)request.maxMessageCount);
+    compiler.addArguments(std::span<const std::string>(request.arguments));
+
+    forEachEnum<DxcArtifactType>(
+        [&](DxcArtifactType type)
+        {
+            const detail::CompileServerArtifactSink& sink = request.artifacts[(size_t)type];
+
+            if(sink.sinkType == DxcSinkType::File) { compiler.enableArtifactWithFileSink(type, utf8Decode(sink.path)); }
+            else if(sink.sinkType == DxcSinkType::MemoryBuffer) { compiler.enableArtifactWithMemorySink(type); }
+        });
+
+    tl::expected<CompileSummary, std::errc> summary =
+        (request.sourceKind == detail::CompileServerSourceKind::File)
+            ? compiler.compileFromFile(utf8Decode(request.sourceName))
+            : compiler.compileFromBuffer(request.source, std::string_view(request.sourceName));
+
+    if(!summary)
+    {
+        response.error = summary.error();
+        return response;
+    }
+
+    response.returnCode = summary->returnCode;
+    response.messages = summary->messages;
+
+    forEachEnum<DxcArtifactType>(
+        [&](DxcArtifactType type)
+        {
+            if(request.artifacts[(size_t)type].sinkType != DxcSinkType::MemoryBuffer) { return; }
+
+            const std::span<const std::byte> data = compiler.getArtifact(type).data();
+            response.artifacts[(size_t)type].emplace(data.begin(), data.end());
+        });
+
+    return response;
+}
+} // namespace shadercompile
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "compile_server_protocol.h"
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+
+namespace shadercompile
+{
+// Runs one decoded compile request on compiler and builds the response sent back to the client.
+[[nodiscard]] detail::CompileServerResponse handleCompileRequest(detail::BaseDxcCompiler& compiler,
+                                                                 const detail::CompileServerRequest& request);
+} // namespace shadercompile
@@ -0,0 +1,178 @@
+#include "compile_daemon.h"
+#include "compile_request_handler.h"
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#include <shadercompile/dxc_library_compiler.h>
+#include <shadercompile/dxc_server_compiler.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+
+using namespace shadercompile;
+
+// shadercompile_server reads framed compile requests from stdin and answers each with a framed response on stdout. It
+// exits when stdin is closed. See compile_server_protocol.h for the frame layout.
+//
+// With --daemon it instead serves any number of local clients on a Unix domain socket until it is terminated:
+//
+//   shadercompile_server --daemon [--socket <path>] [--compilers <count>] [--cache-bytes <bytes>] [--dxc <path>]
+
+namespace
+{
+#ifdef _WIN32
+int readSome(int fd, std::byte* data, size_t size)
+{
+    return _read(fd, data, (unsigned int)size);
+}
+
+int writeSome(int fd, const std::byte* data, size_t size)
+{
+    return _write(fd, data, (unsigned int)size);
+}
+#else
+ssize_t readSome(int fd, std::byte* data, size_t size)
+{
+    return read(fd, data, size);
+}
+
+ssize_t writeSome(int fd, const std::byte* data, size_t size)
+{
+    return write(fd, data, size);
+}
+#endif
+
+bool readAll(int fd, std::span<std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        const auto bytesRead = readSome(fd, bytes.data(), bytes.size());
+
+        if(bytesRead < 0 && errno == EINTR) { continue; }
+
+        if(bytesRead <= 0) { return false; }
+
+        bytes = bytes.subspan(bytesRead);
+    }
+
+    return true;
+}
+
+bool writeAll(int fd, std::span<const std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        const auto bytesWritten = writeSome(fd, bytes.data(), bytes.size());
+
+        if(bytesWritten < 0 && errno == EINTR) { continue; }
+
+        if(bytesWritten <= 0) { return false; }
+
+        bytes = bytes.subspan(bytesWritten);
+    }
+
+    return true;
+}
+
+bool parseSize(std::string_view text, size_t& value)
+{
+    const std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+}
+
+int runDaemon(int argc, char** argv)
+{
+    CompileDaemonOptions options;
+    options.socketPath = DxcDaemonCompiler::defaultSocketPath();
+
+    for(int index = 2; index < argc; ++index)
+    {
+        const std::string_view option = argv[index];
+
+        if(index + 1 == argc)
+        {
+            std::fprintf(stderr, "shadercompile_server: %s needs a value\n", argv[index]);
+            return 1;
+        }
+
+        const std::string_view value = argv[++index];
+        bool valid = true;
+
+        if(option == "--socket") { options.socketPath = value; }
+        else if(option == "--compilers") { valid = parseSize(value, options.compilerCount); }
+        else if(option == "--cache-bytes") { valid = parseSize(value, options.cacheByteBudget); }
+        else if(option == "--dxc") { options.dxcPath = value; }
+        else { valid = false; }
+
+        if(!valid)
+        {
+            std::fprintf(stderr, "shadercompile_server: invalid option %s %s\n", argv[index - 1], argv[index]);
+            return 1;
+        }
+    }
+
+    return runCompileDaemon(options);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc > 1 && std::string_view(argv[1]) == "--daemon") { return runDaemon(argc, argv); }
+
+    // Keep the protocol channel private and point stdout at stderr, so anything the compiler prints cannot corrupt the
+    // response stream.
+#ifdef _WIN32
+    _setmode(0, _O_BINARY);
+    _setmode(1, _O_BINARY);
+    const int inputFd = 0;
+    const int outputFd = _dup(1);
+    _dup2(2, 1);
+#else
+    const int inputFd = STDIN_FILENO;
+    const int outputFd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+
+    if(outputFd < 0) { return 1; }
+
+    DxcLibraryCompiler compiler;
+    std::vector<std::byte> payload;
+    std::vector<std::byte> frame;
+
+    for(;;)
+    {
+        std::array<std::byte, 4> header;
+
+        // end of input means the client is done with us
+        if(!readAll(inputFd, header)) { return 0; }
+
+        const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(header);
+
+        if(!payloadSize) { return 1; }
+
+        payload.resize(payloadSize.value());
+
+        if(!readAll(inputFd, payload)) { return 1; }
+
+        tl::expected<detail::CompileServerRequest, std::errc> request = detail::decodeCompileServerRequest(payload);
+
+        detail::CompileServerResponse response;
+
+        if(request) { response = handleCompileRequest(compiler, request.value()); }
+        else { response.error = request.error(); }
+
+        detail::encodeCompileServerResponse(response, frame);
+
+        if(!writeAll(outputFd, frame)) { return 1; }
+    }
+}
@@ -0,0 +1,151 @@
+#include "compile_fingerprint.h"
+
+#include "include_scanner.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+namespace shadercompile::detail
+{
+namespace
+{
+// bumped whenever the derivation changes, so entries stored under an old fingerprint are simply never found
+constexpr std::string_view kFingerprintFormat = "shadercompile-cache-4"sv;
+
+// options whose value may be passed as the following argument, e.g. `-T ps_6_0`
+constexpr std::array<std::wstring_view, 14> kOptionsWithValue = {L"Fre"sv,
+                                                                  L"Frs"sv,
+                                                                  L"Fsh"sv,
+                                                                  L"Fo"sv,
+                                                                  L"Fd"sv,
+                                                                  L"Fc"sv,
+                                                                  L"Fe"sv,
+                                                                  L"Fi"sv,
+                                                                  L"HV"sv,
+                                                                  L"Vn"sv,
+                                                                  L"T"sv,
+                                                                  L"E"sv,
+                                                                  L"D"sv,
+                                                                  L"I"sv};
+
+// output paths do not change what is compiled, the requested artifacts are part of the fingerprint instead
+constexpr std::array<std::wstring_view, 8> kOutputOptions = {
+    L"Fre"sv, L"Frs"sv, L"Fsh"sv, L"Fo"sv, L"Fd"sv, L"Fc"sv, L"Fe"sv, L"Fi"sv};
+
+template<class T>
+void appendLittleEndian(std::string& str, T value)
+{
+    for(size_t index = 0; index < sizeof(T); ++index)
+    {
+        str.push_back((char)((value >> (index * 8)) & 0xFF));
+    }
+}
+} // namespace
+
+void normalizeCompileArguments(std::span<const std::wstring> arguments,
+                               std::vector<std::wstring>& normalizedArguments,
+                               std::vector<std::filesystem::path>& includeDirectories)
+{
+    for(size_t index = 0; index < arguments.size(); ++index)
+    {
+        const std::wstring_view argument = arguments[index];
+
+        if(argument.size() < 2 || (argument[0] != L'-' && argument[0] != L'/'))
+        {
+            normalizedArguments.emplace_back(argument);
+            continue;
+        }
+
+        const std::wstring_view option = argument.substr(1);
+
+        auto optionItr = std::find_if(kOptionsWithValue.begin(),
+                                      kOptionsWithValue.end(),
+                                      [&](std::wstring_view name) { return option.starts_with(name); });
+
+        if(optionItr == kOptionsWithValue.end())
+        {
+            normalizedArguments.push_back(L"-" + std::wstring(option));
+            continue;
+        }
+
+        const std::wstring_view name = *optionItr;
+        std::wstring_view value = option.substr(name.size());
+
+        if(value.empty() && index + 1 < arguments.size()) { value = arguments[++index]; }
+
+        if(std::find(kOutputOptions.begin(), kOutputOptions.end(), name) != kOutputOptions.end()) { continue; }
+
+        if(name == L"I"sv) { includeDirectories.emplace_back(value); }
+
+        std::wstring normalizedArgument = L"-";
+        normalizedArgument.append(name);
+        normalizedArgument.append(value);
+
+        normalizedArguments.push_back(std::move(normalizedArgument));
+    }
+}
+
+tl::expected<DxcCompileKey, std::errc> computeCompileFingerprint(std::span<const std::byte> source,
+                                                                 const std::filesystem::path& sourcePath,
+                                                                 std::span<const std::wstring> arguments,
+                                                                 const DxcVersion& compilerVersion,
+                                                                 std::span<const DxcArtifactType> artifactTypes,
+                                                                 DxcIncludeCache& includeCache)
+{
+    if(!compilerVersion.isValid()) { return tl::make_unexpected(std::errc::invalid_argument); }
+
+    std::vector<std::wstring> normalizedArguments;
+    std::vector<std::filesystem::path> includeDirectories;
+    normalizeCompileArguments(arguments, normalizedArguments, includeDirectories);
+
+    // Strings are terminated and lists and the source are prefixed with their size, so that adjacent fields cannot run
+    // into each other and equal inputs always mean equal compiles.
+    constexpr std::string_view kTerminator("\0", 1);
+
+    DxcCompileKey key;
+    std::string& inputs = key.inputs;
+    inputs.reserve(source.size() + 256);
+
+    inputs.append(kFingerprintFormat);
+    inputs.append(kTerminator);
+    inputs.append(compilerVersion.toString());
+    inputs.append(kTerminator);
+
+    appendLittleEndian(inputs, (uint32_t)normalizedArguments.size());
+
+    for(const std::wstring& argument : normalizedArguments)
+    {
+        inputs.append(utf8Encode(argument));
+        inputs.append(kTerminator);
+    }
+
+    inputs.push_back((char)artifactTypes.size());
+
+    for(const DxcArtifactType artifactType : artifactTypes)
+    {
+        inputs.push_back((char)artifactType);
+    }
+
+    // the source path shows up in the diagnostics, so it is part of the fingerprint as well
+    inputs.append(utf8Encode(sourcePath.wstring()));
+    inputs.append(kTerminator);
+    appendLittleEndian(inputs, (uint64_t)source.size());
+    inputs.append(reinterpret_cast<const char*>(source.data()), source.size());
+
+    tl::expected<void, std::errc> includeResult =
+        appendIncludeDependencyInputs(source, sourcePath, includeDirectories, includeCache, inputs);
+
+    if(!includeResult) { return tl::make_unexpected(includeResult.error()); }
+
+    Fnv1aHash hash;
+    hash.update(inputs);
+    key.hash = hash.value();
+
+    return key;
+}
+} // namespace shadercompile::detail
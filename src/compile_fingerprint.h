@@ -0,0 +1,42 @@
+#pragma once
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+#include <shadercompile/dxc_compile_cache.h>
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+class DxcIncludeCache;
+
+namespace detail
+{
+// Joins options with their values, spells every option with a '-' prefix and drops the output paths, so that
+// `/T ps_6_0 /Fo a.bin` and `-Tps_6_0` are normalized to the same arguments. The include directories are collected
+// along the way.
+void normalizeCompileArguments(std::span<const std::wstring> arguments,
+                               std::vector<std::wstring>& normalizedArguments,
+                               std::vector<std::filesystem::path>& includeDirectories);
+
+// Fingerprints everything that decides the outcome of a compile: the source, the contents of every file it may include,
+// the normalized arguments, the requested artifacts and the DXC version. Arguments are normalized so that
+// `/T ps_6_0 /Fo a.bin` and `-Tps_6_0` produce the same fingerprint, output paths are left out. The key's inputs hold
+// all of it in an unambiguous encoding, and its hash is the hash of the inputs.
+// Fails with std::errc::invalid_argument for an invalid version and with the errors of appendIncludeDependencyInputs()
+// when the #include dependencies cannot be determined.
+[[nodiscard]] tl::expected<DxcCompileKey, std::errc>
+computeCompileFingerprint(std::span<const std::byte> source,
+                          const std::filesystem::path& sourcePath,
+                          std::span<const std::wstring> arguments,
+                          const DxcVersion& compilerVersion,
+                          std::span<const DxcArtifactType> artifactTypes,
+                          DxcIncludeCache& includeCache);
+} // namespace detail
+} // namespace shadercompile
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+// Owns a resident compile server child process and the channel used to exchange frames with it. On Windows the channel
+// is a pair of anonymous pipes, elsewhere it is a Unix domain socket pair connected to the server's stdin and stdout.
+//
+// A connection to a daemon instead connects to a server that is already listening on a Unix domain socket, with
+// serverPath as the socket's path. Daemons are not supported on Windows.
+class CompileServerConnection
+{
+public:
+    enum class Endpoint
+    {
+        ChildProcess,
+        Daemon
+    };
+
+    // how long stop() waits for the server to exit before it is killed
+    static constexpr std::chrono::milliseconds kExitTimeout = std::chrono::seconds(5);
+
+    explicit CompileServerConnection(std::filesystem::path serverPath, Endpoint endpoint = Endpoint::ChildProcess);
+    CompileServerConnection(const CompileServerConnection&) = delete;
+    ~CompileServerConnection();
+
+    CompileServerConnection& operator=(const CompileServerConnection&) = delete;
+
+    [[nodiscard]] bool isRunning() const noexcept;
+
+    [[nodiscard]] const std::filesystem::path& serverPath() const noexcept { return mServerPath; }
+
+    [[nodiscard]] Endpoint endpoint() const noexcept { return mEndpoint; }
+
+    tl::expected<void, std::errc> start();
+
+    // Closes the server's input so it exits cleanly, then reaps it. A server that is still running after kExitTimeout,
+    // for example because it is stuck in a compile, is killed. A daemon is only disconnected from.
+    void stop() noexcept;
+
+    tl::expected<void, std::errc> writeFrame(std::span<const std::byte> frame);
+
+    // reads one frame and stores its payload (without the size prefix)
+    tl::expected<void, std::errc> readFrame(std::vector<std::byte>& payload);
+
+private:
+    tl::expected<void, std::errc> writeAll(std::span<const std::byte> bytes);
+    tl::expected<void, std::errc> readAll(std::span<std::byte> bytes);
+
+    std::filesystem::path mServerPath;
+    Endpoint mEndpoint = Endpoint::ChildProcess;
+
+#ifdef _WIN32
+    void* mServerStdInWrite = nullptr;
+    void* mServerStdOutRead = nullptr;
+    void* mProcessHandle = nullptr;
+#else
+    tl::expected<void, std::errc> connectToDaemon();
+
+    int mSocket = -1;
+    int mProcessId = -1;
+#endif
+};
+} // namespace shadercompile
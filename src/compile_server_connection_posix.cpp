@@ -0,0 +1,239 @@
+#include "compile_server_connection.h"
+
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+extern char** environ;
+
+namespace shadercompile
+{
+namespace
+{
+constexpr std::chrono::milliseconds kExitPollInterval(10);
+
+// returns false when the process is still running at the deadline
+[[nodiscard]] bool reapBefore(pid_t processId, std::chrono::steady_clock::time_point deadline)
+{
+    while(true)
+    {
+        int status;
+        const pid_t result = waitpid(processId, &status, WNOHANG);
+
+        if(result == processId || (result == -1 && errno != EINTR)) { return true; }
+
+        if(std::chrono::steady_clock::now() >= deadline) { return false; }
+
+        if(result == 0) { std::this_thread::sleep_for(kExitPollInterval); }
+    }
+}
+
+[[nodiscard]] bool isPeerCurrentUser(int socket)
+{
+#ifdef __linux__
+    ucred credentials = {};
+    socklen_t credentialsSize = sizeof(credentials);
+
+    if(getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials, &credentialsSize) != 0) { return false; }
+
+    return credentials.uid == getuid();
+#else
+    uid_t userId;
+    gid_t groupId;
+
+    if(getpeereid(socket, &userId, &groupId) != 0) { return false; }
+
+    return userId == getuid();
+#endif
+}
+} // namespace
+
+CompileServerConnection::CompileServerConnection(std::filesystem::path serverPath, Endpoint endpoint)
+    : mServerPath(std::move(serverPath))
+    , mEndpoint(endpoint)
+{}
+
+CompileServerConnection::~CompileServerConnection()
+{
+    stop();
+}
+
+bool CompileServerConnection::isRunning() const noexcept
+{
+    return mSocket != -1;
+}
+
+tl::expected<void, std::errc> CompileServerConnection::start()
+{
+    if(isRunning()) { return {}; }
+
+    if(mEndpoint == Endpoint::Daemon) { return connectToDaemon(); }
+
+    std::array<int, 2> sockets;
+
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets.data()) != 0)
+    {
+        return tl::make_unexpected(std::errc::broken_pipe);
+    }
+
+    auto closeServerSocket = finally([&]() { close(sockets[1]); });
+
+    posix_spawn_file_actions_t fileActions;
+    if(posix_spawn_file_actions_init(&fileActions) != 0)
+    {
+        close(sockets[0]);
+        return tl::make_unexpected(std::errc::not_enough_memory);
+    }
+
+    auto destroyFileActions = finally([&]() { posix_spawn_file_actions_destroy(&fileActions); });
+
+    posix_spawn_file_actions_adddup2(&fileActions, sockets[1], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, sockets[1], STDOUT_FILENO);
+
+    const std::string command = mServerPath.string();
+    std::array<char*, 2> argv = {const_cast<char*>(command.c_str()), nullptr};
+
+    pid_t processId;
+    if(posix_spawn(&processId, command.c_str(), &fileActions, nullptr, argv.data(), environ) != 0)
+    {
+        close(sockets[0]);
+        return tl::make_unexpected(std::errc::no_such_file_or_directory);
+    }
+
+    mSocket = sockets[0];
+    mProcessId = processId;
+
+    return {};
+}
+
+tl::expected<void, std::errc> CompileServerConnection::connectToDaemon()
+{
+    const std::string socketPath = mServerPath.string();
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+
+    if(socketPath.size() >= sizeof(address.sun_path)) { return tl::make_unexpected(std::errc::filename_too_long); }
+
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    const int daemonSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(daemonSocket == -1) { return tl::make_unexpected(std::errc(errno)); }
+
+    while(connect(daemonSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        if(errno == EINTR) { continue; }
+
+        // ENOENT or ECONNREFUSED when no daemon is running
+        const std::errc error = std::errc(errno);
+        close(daemonSocket);
+        return tl::make_unexpected(error);
+    }
+
+    // The socket may live in a directory other users can write to, so a daemon started by someone else could be
+    // listening on it. Sources and artifacts are only exchanged with a daemon run by the same user.
+    if(!isPeerCurrentUser(daemonSocket))
+    {
+        close(daemonSocket);
+        return tl::make_unexpected(std::errc::permission_denied);
+    }
+
+    mSocket = daemonSocket;
+
+    return {};
+}
+
+void CompileServerConnection::stop() noexcept
+{
+    if(mSocket != -1)
+    {
+        close(mSocket);
+        mSocket = -1;
+    }
+
+    if(mProcessId > 0)
+    {
+        if(!reapBefore(mProcessId, std::chrono::steady_clock::now() + kExitTimeout))
+        {
+            kill(mProcessId, SIGKILL);
+
+            int status;
+            while(waitpid(mProcessId, &status, 0) == -1 && errno == EINTR) {}
+        }
+
+        mProcessId = -1;
+    }
+}
+
+tl::expected<void, std::errc> CompileServerConnection::writeFrame(std::span<const std::byte> frame)
+{
+    return writeAll(frame);
+}
+
+tl::expected<void, std::errc> CompileServerConnection::readFrame(std::vector<std::byte>& payload)
+{
+    std::array<std::byte, 4> header;
+    tl::expected<void, std::errc> readResult = readAll(header);
+
+    if(!readResult) { return readResult; }
+
+    const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(header);
+
+    if(!payloadSize) { return tl::make_unexpected(std::errc::bad_message); }
+
+    payload.resize(payloadSize.value());
+    return readAll(payload);
+}
+
+tl::expected<void, std::errc> CompileServerConnection::writeAll(std::span<const std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        // MSG_NOSIGNAL keeps a crashed server from raising SIGPIPE in the client
+        const ssize_t bytesWritten = send(mSocket, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+
+        if(bytesWritten < 0)
+        {
+            if(errno == EINTR) { continue; }
+            return tl::make_unexpected(std::errc::broken_pipe);
+        }
+
+        bytes = bytes.subspan(bytesWritten);
+    }
+
+    return {};
+}
+
+tl::expected<void, std::errc> CompileServerConnection::readAll(std::span<std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        const ssize_t bytesRead = recv(mSocket, bytes.data(), bytes.size(), 0);
+
+        if(bytesRead == 0) { return tl::make_unexpected(std::errc::broken_pipe); }
+
+        if(bytesRead < 0)
+        {
+            if(errno == EINTR) { continue; }
+            return tl::make_unexpected(std::errc::broken_pipe);
+        }
+
+        bytes = bytes.subspan(bytesRead);
+    }
+
+    return {};
+}
+} // namespace shadercompile
@@ -0,0 +1,174 @@
+#include "compile_server_connection.h"
+
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#include <Windows.h>
+
+#include <array>
+
+namespace shadercompile
+{
+CompileServerConnection::CompileServerConnection(std::filesystem::path serverPath, Endpoint endpoint)
+    : mServerPath(std::move(serverPath))
+    , mEndpoint(endpoint)
+{}
+
+CompileServerConnection::~CompileServerConnection()
+{
+    stop();
+}
+
+bool CompileServerConnection::isRunning() const noexcept
+{
+    return mProcessHandle != nullptr;
+}
+
+tl::expected<void, std::errc> CompileServerConnection::start()
+{
+    if(isRunning()) { return {}; }
+
+    if(mEndpoint == Endpoint::Daemon) { return tl::make_unexpected(std::errc::not_supported); }
+
+    SECURITY_ATTRIBUTES securityAttributes;
+    securityAttributes.nLength = sizeof(SECURITY_ATTRIBUTES);
+    securityAttributes.bInheritHandle = TRUE;
+    securityAttributes.lpSecurityDescriptor = nullptr;
+
+    HANDLE serverStdInRead = nullptr;
+    HANDLE serverStdOutWrite = nullptr;
+
+    auto closeServerHandles = finally(
+        [&]()
+        {
+            if(serverStdInRead != nullptr) { CloseHandle(serverStdInRead); }
+
+            if(serverStdOutWrite != nullptr) { CloseHandle(serverStdOutWrite); }
+        });
+
+    if(!CreatePipe(&serverStdInRead, &mServerStdInWrite, &securityAttributes, 0) ||
+       !SetHandleInformation(mServerStdInWrite, HANDLE_FLAG_INHERIT, 0) ||
+       !CreatePipe(&mServerStdOutRead, &serverStdOutWrite, &securityAttributes, 0) ||
+       !SetHandleInformation(mServerStdOutRead, HANDLE_FLAG_INHERIT, 0))
+    {
+        stop();
+        return tl::make_unexpected(std::errc::broken_pipe);
+    }
+
+    STARTUPINFO startupInfo;
+    ZeroMemory(&startupInfo, sizeof(startupInfo));
+
+    startupInfo.cb = sizeof(STARTUPINFO);
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    startupInfo.hStdOutput = serverStdOutWrite;
+    startupInfo.hStdInput = serverStdInRead;
+    startupInfo.dwFlags |= STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    startupInfo.wShowWindow = SW_HIDE;
+
+    PROCESS_INFORMATION processInfo;
+    ZeroMemory(&processInfo, sizeof(processInfo));
+
+    const BOOL success = CreateProcess(mServerPath.c_str(),
+                                       nullptr,
+                                       nullptr,
+                                       nullptr,
+                                       TRUE,
+                                       0,
+                                       nullptr,
+                                       nullptr,
+                                       &startupInfo,
+                                       &processInfo);
+
+    if(!success)
+    {
+        stop();
+        return tl::make_unexpected(std::errc::no_such_file_or_directory);
+    }
+
+    CloseHandle(processInfo.hThread);
+    mProcessHandle = processInfo.hProcess;
+
+    return {};
+}
+
+void CompileServerConnection::stop() noexcept
+{
+    if(mServerStdInWrite != nullptr)
+    {
+        CloseHandle(mServerStdInWrite);
+        mServerStdInWrite = nullptr;
+    }
+
+    if(mServerStdOutRead != nullptr)
+    {
+        CloseHandle(mServerStdOutRead);
+        mServerStdOutRead = nullptr;
+    }
+
+    if(mProcessHandle != nullptr)
+    {
+        if(WaitForSingleObject(mProcessHandle, (DWORD)kExitTimeout.count()) == WAIT_TIMEOUT)
+        {
+            TerminateProcess(mProcessHandle, 1);
+            WaitForSingleObject(mProcessHandle, INFINITE);
+        }
+
+        CloseHandle(mProcessHandle);
+        mProcessHandle = nullptr;
+    }
+}
+
+tl::expected<void, std::errc> CompileServerConnection::writeFrame(std::span<const std::byte> frame)
+{
+    return writeAll(frame);
+}
+
+tl::expected<void, std::errc> CompileServerConnection::readFrame(std::vector<std::byte>& payload)
+{
+    std::array<std::byte, 4> header;
+    tl::expected<void, std::errc> readResult = readAll(header);
+
+    if(!readResult) { return readResult; }
+
+    const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(header);
+
+    if(!payloadSize) { return tl::make_unexpected(std::errc::bad_message); }
+
+    payload.resize(payloadSize.value());
+    return readAll(payload);
+}
+
+tl::expected<void, std::errc> CompileServerConnection::writeAll(std::span<const std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        DWORD bytesWritten = 0;
+
+        if(!WriteFile(mServerStdInWrite, bytes.data(), (DWORD)bytes.size(), &bytesWritten, nullptr))
+        {
+            return tl::make_unexpected(std::errc::broken_pipe);
+        }
+
+        bytes = bytes.subspan(bytesWritten);
+    }
+
+    return {};
+}
+
+tl::expected<void, std::errc> CompileServerConnection::readAll(std::span<std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        DWORD bytesRead = 0;
+
+        if(!ReadFile(mServerStdOutRead, bytes.data(), (DWORD)bytes.size(), &bytesRead, nullptr) || bytesRead == 0)
+        {
+            return tl::make_unexpected(std::errc::broken_pipe);
+        }
+
+        bytes = bytes.subspan(bytesRead);
+    }
+
+    return {};
+}
+} // namespace shadercompile
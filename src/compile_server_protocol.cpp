@@ -0,0 +1,348 @@
+#include "compile_server_protocol.h"
+
+#include <cstring>
+#include <utility>
+
+namespace shadercompile::detail
+{
+namespace
+{
+// the smallest encoding of a string or byte array, its size prefix
+constexpr size_t kMinEncodedStringSize = sizeof(uint32_t);
+
+// offset, size, line, column, file path range, type and message range
+constexpr size_t kEncodedMessageSize = 8 * sizeof(uint32_t) + sizeof(uint8_t);
+
+// A range of a field inside a message of messageSize bytes. An offset of -1 marks a field the message does not have,
+// any other range has to lie within the message so that CompilerMessage::filePath() and message() cannot throw.
+[[nodiscard]] bool isValidFieldRange(int32_t offset, int32_t count, uint32_t messageSize) noexcept
+{
+    if(offset == -1) { return true; }
+
+    return offset >= 0 && count >= 0 && (uint64_t)offset + (uint64_t)count <= messageSize;
+}
+} // namespace
+
+FrameWriter::FrameWriter(std::vector<std::byte>& frame)
+    : mFrame(frame)
+{
+    mFrame.clear();
+    writeU32(0);
+}
+
+void FrameWriter::writeU8(uint8_t value)
+{
+    mFrame.push_back(std::byte{value});
+}
+
+void FrameWriter::writeU32(uint32_t value)
+{
+    for(int shift = 0; shift < 32; shift += 8)
+    {
+        mFrame.push_back(std::byte((value >> shift) & 0xFF));
+    }
+}
+
+void FrameWriter::writeI32(int32_t value)
+{
+    writeU32(static_cast<uint32_t>(value));
+}
+
+void FrameWriter::writeU64(uint64_t value)
+{
+    writeU32((uint32_t)value);
+    writeU32((uint32_t)(value >> 32));
+}
+
+void FrameWriter::writeString(std::string_view str)
+{
+    writeBytes(std::as_bytes(std::span<const char>(str)));
+}
+
+void FrameWriter::writeBytes(std::span<const std::byte> bytes)
+{
+    writeU32((uint32_t)bytes.size());
+    mFrame.insert(mFrame.end(), bytes.begin(), bytes.end());
+}
+
+void FrameWriter::finish()
+{
+    const uint32_t payloadSize = (uint32_t)(mFrame.size() - sizeof(uint32_t));
+
+    for(int index = 0; index < 4; ++index)
+    {
+        mFrame[index] = std::byte((payloadSize >> (index * 8)) & 0xFF);
+    }
+}
+
+bool FrameReader::read(void* dst, size_t size)
+{
+    if(mPayload.size() - mOffset < size) { return false; }
+
+    std::memcpy(dst, mPayload.data() + mOffset, size);
+    mOffset += size;
+    return true;
+}
+
+bool FrameReader::readU8(uint8_t& value)
+{
+    return read(&value, sizeof(value));
+}
+
+bool FrameReader::readU32(uint32_t& value)
+{
+    std::array<uint8_t, 4> bytes;
+    if(!read(bytes.data(), bytes.size())) { return false; }
+
+    value = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+    return true;
+}
+
+bool FrameReader::readI32(int32_t& value)
+{
+    uint32_t unsignedValue;
+    if(!readU32(unsignedValue)) { return false; }
+
+    value = static_cast<int32_t>(unsignedValue);
+    return true;
+}
+
+bool FrameReader::readU64(uint64_t& value)
+{
+    uint32_t low;
+    uint32_t high;
+    if(!readU32(low) || !readU32(high)) { return false; }
+
+    value = uint64_t(low) | (uint64_t(high) << 32);
+    return true;
+}
+
+bool FrameReader::readString(std::string& str)
+{
+    uint32_t size;
+    if(!readU32(size)) { return false; }
+
+    if(mPayload.size() - mOffset < size) { return false; }
+
+    str.assign(reinterpret_cast<const char*>(mPayload.data() + mOffset), size);
+    mOffset += size;
+    return true;
+}
+
+bool FrameReader::readBytes(std::vector<std::byte>& bytes)
+{
+    uint32_t size;
+    if(!readU32(size)) { return false; }
+
+    if(mPayload.size() - mOffset < size) { return false; }
+
+    bytes.assign(mPayload.begin() + mOffset, mPayload.begin() + mOffset + size);
+    mOffset += size;
+    return true;
+}
+
+std::optional<uint32_t> decodeFrameSize(std::span<const std::byte, 4> header) noexcept
+{
+    uint32_t size = 0;
+
+    for(int index = 0; index < 4; ++index)
+    {
+        size |= uint32_t(header[index]) << (index * 8);
+    }
+
+    if(size > kMaxCompileServerFrameSize) { return std::nullopt; }
+
+    return size;
+}
+
+void encodeCompileServerRequest(const CompileServerRequest& request, std::vector<std::byte>& frame)
+{
+    FrameWriter writer(frame);
+
+    writer.writeU8((uint8_t)request.sourceKind);
+
+    writer.writeU32((uint32_t)request.arguments.size());
+    for(const std::string& argument : request.arguments)
+    {
+        writer.writeString(argument);
+    }
+
+    for(const CompileServerArtifactSink& artifact : request.artifacts)
+    {
+        writer.writeU8((uint8_t)artifact.sinkType);
+        writer.writeString(artifact.path);
+    }
+
+    writer.writeString(request.sourceName);
+    writer.writeBytes(request.source);
+    writer.writeU64(request.maxMessageCount);
+    writer.finish();
+}
+
+tl::expected<CompileServerRequest, std::errc> decodeCompileServerRequest(std::span<const std::byte> payload)
+{
+    FrameReader reader(payload);
+    CompileServerRequest request;
+
+    uint8_t sourceKind;
+    if(!reader.readU8(sourceKind) || sourceKind > (uint8_t)CompileServerSourceKind::File)
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    request.sourceKind = (CompileServerSourceKind)sourceKind;
+
+    uint32_t argumentCount;
+    if(!reader.readU32(argumentCount) || !reader.canHold(argumentCount, kMinEncodedStringSize))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    request.arguments.resize(argumentCount);
+    for(std::string& argument : request.arguments)
+    {
+        if(!reader.readString(argument)) { return tl::make_unexpected(std::errc::bad_message); }
+    }
+
+    for(CompileServerArtifactSink& artifact : request.artifacts)
+    {
+        uint8_t sinkType;
+        if(!reader.readU8(sinkType) || sinkType > (uint8_t)DxcSinkType::MemoryBuffer)
+        {
+            return tl::make_unexpected(std::errc::bad_message);
+        }
+
+        artifact.sinkType = (DxcSinkType)sinkType;
+
+        if(!reader.readString(artifact.path)) { return tl::make_unexpected(std::errc::bad_message); }
+    }
+
+    if(!reader.readString(request.sourceName) || !reader.readBytes(request.source) ||
+       !reader.readU64(request.maxMessageCount) || !reader.atEnd())
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    return request;
+}
+
+void encodeCompileServerResponse(const CompileServerResponse& response, std::vector<std::byte>& frame)
+{
+    FrameWriter writer(frame);
+
+    writer.writeI32((int32_t)response.error);
+    writer.writeI32(response.returnCode);
+
+    // the messages are sent as the output buffer they view and their ranges in it
+    const std::string_view messagesText = response.messages.text();
+    writer.writeString(messagesText);
+
+    writer.writeU32((uint32_t)response.messages.size());
+    for(const CompilerMessage& message : response.messages)
+    {
+        writer.writeU32((uint32_t)(message.fullMessage.data() - messagesText.data()));
+        writer.writeU32((uint32_t)message.fullMessage.size());
+        writer.writeI32(message.line);
+        writer.writeI32(message.column);
+        writer.writeI32(message.filePathOffset);
+        writer.writeI32(message.filePathCount);
+        writer.writeU8((uint8_t)message.type);
+        writer.writeI32(message.messageOffset);
+        writer.writeI32(message.messageCount);
+    }
+
+    // the messages that were not retained are only counted
+    std::array<size_t, (size_t)CompilerMessageType::_count> retainedCounts{};
+
+    for(const CompilerMessage& message : response.messages)
+    {
+        ++retainedCounts[(size_t)message.type];
+    }
+
+    for(size_t typeIndex = 0; typeIndex < retainedCounts.size(); ++typeIndex)
+    {
+        writer.writeU64(response.messages.count((CompilerMessageType)typeIndex) - retainedCounts[typeIndex]);
+    }
+
+    for(const std::optional<std::vector<std::byte>>& artifact : response.artifacts)
+    {
+        writer.writeU8(artifact.has_value() ? 1 : 0);
+
+        if(artifact.has_value()) { writer.writeBytes(artifact.value()); }
+    }
+
+    writer.finish();
+}
+
+tl::expected<CompileServerResponse, std::errc> decodeCompileServerResponse(std::span<const std::byte> payload)
+{
+    FrameReader reader(payload);
+    CompileServerResponse response;
+
+    int32_t error;
+    if(!reader.readI32(error) || !reader.readI32(response.returnCode))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    response.error = (std::errc)error;
+
+    std::string messagesText;
+    uint32_t messageCount;
+    if(!reader.readString(messagesText) || !reader.readU32(messageCount) ||
+       !reader.canHold(messageCount, kEncodedMessageSize))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    CompilerMessages::Builder messagesBuilder(std::move(messagesText));
+
+    for(uint32_t messageIndex = 0; messageIndex < messageCount; ++messageIndex)
+    {
+        CompilerMessage message;
+        uint32_t offset;
+        uint32_t size;
+        uint8_t type;
+        const bool success = reader.readU32(offset) && reader.readU32(size) && reader.readI32(message.line) &&
+                             reader.readI32(message.column) && reader.readI32(message.filePathOffset) &&
+                             reader.readI32(message.filePathCount) && reader.readU8(type) &&
+                             reader.readI32(message.messageOffset) && reader.readI32(message.messageCount);
+
+        if(!success || type >= (uint8_t)CompilerMessageType::_count || offset > messagesBuilder.text().size() ||
+           size > messagesBuilder.text().size() - offset ||
+           !isValidFieldRange(message.filePathOffset, message.filePathCount, size) ||
+           !isValidFieldRange(message.messageOffset, message.messageCount, size))
+        {
+            return tl::make_unexpected(std::errc::bad_message);
+        }
+
+        message.fullMessage = messagesBuilder.text().substr(offset, size);
+        message.type = (CompilerMessageType)type;
+        messagesBuilder.add(message);
+    }
+
+    for(size_t typeIndex = 0; typeIndex < (size_t)CompilerMessageType::_count; ++typeIndex)
+    {
+        uint64_t droppedCount;
+        if(!reader.readU64(droppedCount)) { return tl::make_unexpected(std::errc::bad_message); }
+
+        messagesBuilder.addDropped((CompilerMessageType)typeIndex, (size_t)droppedCount);
+    }
+
+    response.messages = std::move(messagesBuilder).build();
+
+    for(std::optional<std::vector<std::byte>>& artifact : response.artifacts)
+    {
+        uint8_t hasArtifact;
+        if(!reader.readU8(hasArtifact)) { return tl::make_unexpected(std::errc::bad_message); }
+
+        if(hasArtifact == 0) { continue; }
+
+        if(!reader.readBytes(artifact.emplace())) { return tl::make_unexpected(std::errc::bad_message); }
+    }
+
+    if(!reader.atEnd()) { return tl::make_unexpected(std::errc::bad_message); }
+
+    return response;
+}
+} // namespace shadercompile::detail
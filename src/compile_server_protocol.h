@@ -0,0 +1,111 @@
+#pragma once
+
+#include <shadercompile/detail/dxc_compiler_common.h>
+#include <tl/expected.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile::detail
+{
+// Every message exchanged with the compile server is a frame: a 32-bit little endian payload size followed by the
+// payload. Strings are sent as UTF-8 so both ends agree regardless of the platform's wchar_t width.
+constexpr uint32_t kMaxCompileServerFrameSize = 1u << 30;
+
+enum class CompileServerSourceKind : uint8_t
+{
+    Buffer,
+    File
+};
+
+struct CompileServerArtifactSink
+{
+    DxcSinkType sinkType = DxcSinkType::None;
+    std::string path;
+};
+
+struct CompileServerRequest
+{
+    CompileServerSourceKind sourceKind = CompileServerSourceKind::Buffer;
+    std::vector<std::string> arguments;
+    std::array<CompileServerArtifactSink, (size_t)DxcArtifactType::_count> artifacts;
+    std::string sourceName;
+    std::vector<std::byte> source;
+    uint64_t maxMessageCount = kUnlimitedMessageCount;
+};
+
+struct CompileServerResponse
+{
+    std::errc error = std::errc{};
+    int returnCode = 0;
+    CompilerMessages messages;
+    std::array<std::optional<std::vector<std::byte>>, (size_t)DxcArtifactType::_count> artifacts;
+};
+
+class FrameWriter
+{
+public:
+    explicit FrameWriter(std::vector<std::byte>& frame);
+
+    void writeU8(uint8_t value);
+    void writeU32(uint32_t value);
+    void writeI32(int32_t value);
+    void writeU64(uint64_t value);
+    void writeString(std::string_view str);
+    void writeBytes(std::span<const std::byte> bytes);
+
+    // patches the size prefix once the whole payload has been written
+    void finish();
+
+private:
+    std::vector<std::byte>& mFrame;
+};
+
+class FrameReader
+{
+public:
+    explicit FrameReader(std::span<const std::byte> payload) noexcept
+        : mPayload(payload)
+    {}
+
+    [[nodiscard]] bool readU8(uint8_t& value);
+    [[nodiscard]] bool readU32(uint32_t& value);
+    [[nodiscard]] bool readI32(int32_t& value);
+    [[nodiscard]] bool readU64(uint64_t& value);
+    [[nodiscard]] bool readString(std::string& str);
+    [[nodiscard]] bool readBytes(std::vector<std::byte>& bytes);
+
+    [[nodiscard]] bool atEnd() const noexcept { return mOffset == mPayload.size(); }
+
+    // Whether count entries of at least minEntrySize bytes each fit in what is left of the payload. Counts read from
+    // the payload are checked with it before anything is allocated for them, so a corrupt frame cannot ask for more
+    // memory than its own size.
+    [[nodiscard]] bool canHold(uint64_t count, size_t minEntrySize) const noexcept
+    {
+        return count <= (mPayload.size() - mOffset) / minEntrySize;
+    }
+
+private:
+    [[nodiscard]] bool read(void* dst, size_t size);
+
+    std::span<const std::byte> mPayload;
+    size_t mOffset = 0;
+};
+
+[[nodiscard]] std::optional<uint32_t> decodeFrameSize(std::span<const std::byte, 4> header) noexcept;
+
+void encodeCompileServerRequest(const CompileServerRequest& request, std::vector<std::byte>& frame);
+[[nodiscard]] tl::expected<CompileServerRequest, std::errc>
+decodeCompileServerRequest(std::span<const std::byte> payload);
+
+void encodeCompileServerResponse(const CompileServerResponse& response, std::vector<std::byte>& frame);
+[[nodiscard]] tl::expected<CompileServerResponse, std::errc>
+decodeCompileServerResponse(std::span<const std::byte> payload);
+} // namespace shadercompile::detail
@@ -0,0 +1,63 @@
+#include "shadercompile/detail/compiler_common.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace shadercompile
+{
+CompilerMessages::Builder::Builder(std::string text, size_t maxMessageCount)
+    : mStorage(std::make_shared<detail::CompilerMessagesStorage>())
+    , mMaxMessageCount(maxMessageCount)
+{
+    mStorage->text = std::move(text);
+}
+
+void CompilerMessages::Builder::add(const CompilerMessage& message)
+{
+    detail::CompilerMessagesStorage& storage = *mStorage;
+
+    ++storage.typeCounts[(size_t)message.type];
+
+    if(storage.offsets.size() >= mMaxMessageCount) { return; }
+
+    storage.offsets.push_back((uint32_t)(message.fullMessage.data() - storage.text.data()));
+    storage.sizes.push_back((uint32_t)message.fullMessage.size());
+    storage.lines.push_back(message.line);
+    storage.columns.push_back(message.column);
+    storage.types.push_back(message.type);
+    storage.filePathOffsets.push_back(message.filePathOffset);
+    storage.filePathCounts.push_back(message.filePathCount);
+    storage.messageOffsets.push_back(message.messageOffset);
+    storage.messageCounts.push_back(message.messageCount);
+}
+
+void CompilerMessages::Builder::addDropped(CompilerMessageType type, size_t count)
+{
+    mStorage->typeCounts[(size_t)type] += count;
+}
+
+CompilerMessages CompilerMessages::Builder::build() &&
+{
+    detail::CompilerMessagesStorage& storage = *mStorage;
+
+    // the output past the last retained message is only needed while parsing
+    size_t textSize = 0;
+
+    for(size_t index = 0; index < storage.offsets.size(); ++index)
+    {
+        textSize = std::max(textSize, (size_t)storage.offsets[index] + storage.sizes[index]);
+    }
+
+    if(textSize < storage.text.size())
+    {
+        storage.text.resize(textSize);
+        storage.text.shrink_to_fit();
+    }
+
+    CompilerMessages messages;
+    messages.mSize = storage.offsets.size();
+    messages.mStorage = std::move(mStorage);
+
+    return messages;
+}
+} // namespace shadercompile
@@ -0,0 +1,197 @@
+#include "diagnostic_parser.h"
+
+#include "utility.h"
+
+#include <cctype>
+#include <charconv>
+#include <optional>
+
+namespace shadercompile::detail
+{
+namespace
+{
+[[nodiscard]] bool isNewline(char c) { return c == '\n' || c == '\r'; }
+
+// colonIndex of the first colon at or after colonIndex that is followed by a space, a section break
+[[nodiscard]] std::optional<size_t> findSectionBreak(std::string_view fullMessage,
+                                                     std::span<const uint32_t> colonOffsets,
+                                                     size_t colonIndex)
+{
+    for(; colonIndex < colonOffsets.size(); ++colonIndex)
+    {
+        const size_t offset = colonOffsets[colonIndex];
+
+        if(offset + 1 < fullMessage.size() && fullMessage[offset + 1] == ' ') { return colonIndex; }
+    }
+
+    return std::nullopt;
+}
+} // namespace
+
+CompilerMessage parseCompilerMessage(std::string_view fullMessage, std::span<const uint32_t> colonOffsets)
+{
+    CompilerMessage compilerMessage;
+    compilerMessage.fullMessage = fullMessage;
+
+    // check
+    const std::optional<size_t> sectionBreakIndex = findSectionBreak(fullMessage, colonOffsets, 0);
+
+    if(!sectionBreakIndex) { return compilerMessage; }
+
+    const size_t sectionBreakOffset = colonOffsets[sectionBreakIndex.value()];
+    size_t messageTypeOffset = 0;
+    size_t typeSectionBreakIndex = sectionBreakIndex.value();
+
+    if(sectionBreakOffset > 0 && std::isdigit(fullMessage[sectionBreakOffset - 1]))
+    {
+        // If there is a digit to left of the first section break, then this message is one of two forms
+        // A: <path>:<line>:<column>: <type>: <message>
+        // or
+        // B: <path>:<line>: <type>: <message>
+
+        if(sectionBreakIndex.value() == 0)
+        {
+            // This is an unknown message format. Expecting there to be at least one colon preceding the
+            // section break.
+            return compilerMessage;
+        }
+
+        const size_t lineOrColumnNumberOffset = colonOffsets[sectionBreakIndex.value() - 1];
+
+        messageTypeOffset = sectionBreakOffset + 2;
+
+        const std::optional<size_t> typeSectionBreakResult =
+            findSectionBreak(fullMessage, colonOffsets, sectionBreakIndex.value() + 1);
+
+        if(!typeSectionBreakResult) { typeSectionBreakIndex = colonOffsets.size(); }
+        else { typeSectionBreakIndex = typeSectionBreakResult.value(); }
+
+        int lineOrColumn;
+
+        std::string_view lineOrColumnStr =
+            fullMessage.substr(lineOrColumnNumberOffset + 1, sectionBreakOffset - lineOrColumnNumberOffset - 1);
+
+        const std::from_chars_result lineOrColumnParseResult =
+            std::from_chars(lineOrColumnStr.data(), lineOrColumnStr.data() + lineOrColumnStr.size(), lineOrColumn);
+
+        if(lineOrColumnParseResult.ec != std::errc{})
+        {
+            // expected a number
+            return compilerMessage;
+        }
+
+        if(lineOrColumnNumberOffset > 0 && std::isdigit(fullMessage[lineOrColumnNumberOffset - 1]))
+        {
+            // message contains line and column numbers
+            compilerMessage.column = lineOrColumn;
+
+            if(sectionBreakIndex.value() < 2)
+            {
+                // expected another colon
+                return compilerMessage;
+            }
+
+            const size_t lineNumberOffset = colonOffsets[sectionBreakIndex.value() - 2];
+
+            std::string_view lineStr =
+                fullMessage.substr(lineNumberOffset + 1, lineOrColumnNumberOffset - lineNumberOffset - 1);
+
+            const std::from_chars_result lineParseResult =
+                std::from_chars(lineStr.data(), lineStr.data() + lineStr.size(), compilerMessage.line);
+
+            if(lineParseResult.ec != std::errc{})
+            {
+                // expected a number
+                return compilerMessage;
+            }
+
+            compilerMessage.filePathOffset = 0;
+            compilerMessage.filePathCount = (int)lineNumberOffset;
+        }
+        else
+        {
+            // message contains just a line number
+            compilerMessage.line = lineOrColumn;
+            compilerMessage.filePathOffset = 0;
+            compilerMessage.filePathCount = (int)lineOrColumnNumberOffset;
+        }
+    }
+
+    // parse message type
+    if(typeSectionBreakIndex == colonOffsets.size()) { return compilerMessage; }
+
+    const size_t typeSectionBreakOffset = colonOffsets[typeSectionBreakIndex];
+
+    std::string_view messageTypeStr = fullMessage.substr(messageTypeOffset, typeSectionBreakOffset - messageTypeOffset);
+
+    if(caseInsensitiveEqual(messageTypeStr, "warning")) { compilerMessage.type = CompilerMessageType::Warning; }
+    else if(caseInsensitiveEqual(messageTypeStr, "error")) { compilerMessage.type = CompilerMessageType::Error; }
+
+    if(typeSectionBreakOffset + 2 >= fullMessage.size())
+    {
+        // there is not enough room for a message
+        return compilerMessage;
+    }
+
+    compilerMessage.messageOffset = (int)(typeSectionBreakOffset + 2);
+    compilerMessage.messageCount = int(fullMessage.size() - compilerMessage.messageOffset);
+
+    return compilerMessage;
+}
+
+void IncrementalDiagnosticParser::feed(std::string_view chunk, const MessageCallback& onMessage)
+{
+    if(chunk.empty()) { return; }
+
+    mPending.append(chunk);
+
+    // A new line that is not indented starts the next message, which completes every message before it. Whether a
+    // newline at the end of the chunk starts one depends on the byte after it.
+    for(size_t offset = mPending.size() - 1; offset > mSearchOffset; --offset)
+    {
+        const char previous = mPending[offset - 1];
+        const char current = mPending[offset];
+
+        if(!isNewline(previous) || current == ' ' || current == '\t') { continue; }
+
+        // the \n of a \r\n is part of the line ending
+        if(previous == '\r' && current == '\n') { continue; }
+
+        parseCompleted(offset, onMessage);
+        break;
+    }
+
+    mSearchOffset = mPending.size() - 1;
+}
+
+void IncrementalDiagnosticParser::finish(const MessageCallback& onMessage)
+{
+    parseCompleted(mPending.size(), onMessage);
+    mSearchOffset = 0;
+}
+
+void IncrementalDiagnosticParser::reset()
+{
+    mPending.clear();
+    mSearchOffset = 0;
+    mCompletedSize = 0;
+}
+
+void IncrementalDiagnosticParser::parseCompleted(size_t size, const MessageCallback& onMessage)
+{
+    const std::string_view completed = std::string_view(mPending).substr(0, size);
+
+    scanDiagnostics(completed, mSpans);
+
+    for(size_t messageIndex = 0; messageIndex < mSpans.size(); ++messageIndex)
+    {
+        const std::string_view fullMessage =
+            completed.substr(mSpans.messageOffsets[messageIndex], mSpans.messageSizes[messageIndex]);
+
+        onMessage(parseCompilerMessage(fullMessage, mSpans.colons(messageIndex)));
+    }
+
+    mPending.erase(0, size);
+    mCompletedSize += size;
+}
+} // namespace shadercompile::detail
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "diagnostic_scanner.h"
+
+#include <shadercompile/detail/compiler_common.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace shadercompile::detail
+{
+// Parses the fields of a single message. colonOffsets are the offsets of every colon in fullMessage, as found by
+// scanDiagnostics.
+[[nodiscard]] CompilerMessage parseCompilerMessage(std::string_view fullMessage,
+                                                   std::span<const uint32_t> colonOffsets);
+
+// Parses compiler output that arrives in chunks while the compiler still runs. A message is complete once the line
+// after it starts, since until then more indented lines may follow, or once the output ends. The messages are the same
+// ones BaseDxcCompiler::parseCompilerMessages() finds in the whole output.
+class IncrementalDiagnosticParser
+{
+public:
+    // the message and its views only live for the call
+    using MessageCallback = std::function<void(const CompilerMessage& message)>;
+
+    // calls onMessage with every message that chunk completes
+    void feed(std::string_view chunk, const MessageCallback& onMessage);
+
+    // the output ended, calls onMessage with the last message
+    void finish(const MessageCallback& onMessage);
+
+    void reset();
+
+    // the size of the output up to the end of the last completed message
+    [[nodiscard]] size_t completedSize() const noexcept { return mCompletedSize; }
+
+private:
+    void parseCompleted(size_t size, const MessageCallback& onMessage);
+
+    // the output after the last completed message
+    std::string mPending;
+    // offset into mPending from which the next message boundary is searched for, everything before it was searched
+    size_t mSearchOffset = 0;
+    size_t mCompletedSize = 0;
+    DiagnosticSpans mSpans;
+};
+} // namespace shadercompile::detail
@@ -0,0 +1,207 @@
+#include "diagnostic_scanner.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHADERCOMPILE_SCAN_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#define SHADERCOMPILE_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#include <bit>
+
+namespace shadercompile::detail
+{
+namespace
+{
+// Turns the newlines and colons found by a scanner, in the order they appear, into messages
+class DiagnosticSpanBuilder
+{
+public:
+    DiagnosticSpanBuilder(std::string_view output, DiagnosticSpans& spans)
+        : mOutput(output)
+        , mSpans(spans)
+    {
+        mSpans.clear();
+    }
+
+    void addColon(size_t offset) { mSpans.colonOffsets.push_back((uint32_t)(offset - mMessageOffset)); }
+
+    void addNewline(size_t offset)
+    {
+        // a \r\n ends the line at its \n
+        if(mOutput[offset] == '\r' && offset + 1 < mOutput.size() && mOutput[offset + 1] == '\n') { return; }
+
+        const size_t nextLineOffset = offset + 1;
+
+        // indented lines continue the message above them
+        if(nextLineOffset < mOutput.size() && mOutput[nextLineOffset] != ' ' && mOutput[nextLineOffset] != '\t')
+        {
+            endMessage(nextLineOffset);
+            mMessageOffset = nextLineOffset;
+        }
+    }
+
+    void finish()
+    {
+        endMessage(mOutput.size());
+        mSpans.colonStarts.push_back((uint32_t)mSpans.colonOffsets.size());
+    }
+
+private:
+    void endMessage(size_t endOffset)
+    {
+        while(endOffset > mMessageOffset && (mOutput[endOffset - 1] == '\n' || mOutput[endOffset - 1] == '\r'))
+        {
+            --endOffset;
+        }
+
+        // blank lines are not messages, and have no colons
+        if(endOffset == mMessageOffset) { return; }
+
+        mSpans.messageOffsets.push_back((uint32_t)mMessageOffset);
+        mSpans.messageSizes.push_back((uint32_t)(endOffset - mMessageOffset));
+        mSpans.colonStarts.push_back(mColonStart);
+
+        mColonStart = (uint32_t)mSpans.colonOffsets.size();
+    }
+
+    std::string_view mOutput;
+    DiagnosticSpans& mSpans;
+    size_t mMessageOffset = 0;
+    uint32_t mColonStart = 0;
+};
+
+void scanScalar(std::string_view output, size_t offset, DiagnosticSpanBuilder& builder)
+{
+    for(; offset < output.size(); ++offset)
+    {
+        const char byte = output[offset];
+
+        if(byte == ':') { builder.addColon(offset); }
+        else if(byte == '\n' || byte == '\r') { builder.addNewline(offset); }
+    }
+}
+
+// visits the set bits of both masks in order, bit i is the byte at blockOffset + i
+void visitBlock(size_t blockOffset, uint64_t newlineMask, uint64_t colonMask, DiagnosticSpanBuilder& builder)
+{
+    uint64_t mask = newlineMask | colonMask;
+
+    while(mask != 0)
+    {
+        const int bit = std::countr_zero(mask);
+
+        if((colonMask >> bit) & 1) { builder.addColon(blockOffset + bit); }
+        else { builder.addNewline(blockOffset + bit); }
+
+        mask &= mask - 1;
+    }
+}
+
+#ifdef SHADERCOMPILE_SCAN_SSE2
+void scanSse2(std::string_view output, DiagnosticSpanBuilder& builder)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    const __m128i colon = _mm_set1_epi8(':');
+
+    size_t offset = 0;
+
+    for(; offset + 64 <= output.size(); offset += 64)
+    {
+        uint64_t newlineMask = 0;
+        uint64_t colonMask = 0;
+
+        for(int chunkIndex = 0; chunkIndex < 4; ++chunkIndex)
+        {
+            const __m128i bytes =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(output.data() + offset + chunkIndex * 16));
+
+            const __m128i newlines =
+                _mm_or_si128(_mm_cmpeq_epi8(bytes, newline), _mm_cmpeq_epi8(bytes, carriageReturn));
+
+            newlineMask |= uint64_t((uint32_t)_mm_movemask_epi8(newlines)) << (chunkIndex * 16);
+            colonMask |= uint64_t((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, colon))) << (chunkIndex * 16);
+        }
+
+        // most of a block is message text
+        if((newlineMask | colonMask) != 0) { visitBlock(offset, newlineMask, colonMask, builder); }
+    }
+
+    scanScalar(output, offset, builder);
+}
+#endif
+
+#ifdef SHADERCOMPILE_SCAN_NEON
+// one bit per byte of a comparison result, NEON has no movemask
+[[nodiscard]] uint64_t toBitMask(uint8x16_t comparison)
+{
+    static constexpr uint8_t kBitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+    const uint8x16_t weighted = vandq_u8(comparison, vld1q_u8(kBitWeights));
+
+    return uint64_t(vaddv_u8(vget_low_u8(weighted))) | (uint64_t(vaddv_u8(vget_high_u8(weighted))) << 8);
+}
+
+void scanNeon(std::string_view output, DiagnosticSpanBuilder& builder)
+{
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t carriageReturn = vdupq_n_u8('\r');
+    const uint8x16_t colon = vdupq_n_u8(':');
+
+    size_t offset = 0;
+
+    for(; offset + 64 <= output.size(); offset += 64)
+    {
+        uint64_t newlineMask = 0;
+        uint64_t colonMask = 0;
+
+        for(int chunkIndex = 0; chunkIndex < 4; ++chunkIndex)
+        {
+            const uint8x16_t bytes =
+                vld1q_u8(reinterpret_cast<const uint8_t*>(output.data() + offset + chunkIndex * 16));
+
+            const uint8x16_t newlines = vorrq_u8(vceqq_u8(bytes, newline), vceqq_u8(bytes, carriageReturn));
+
+            newlineMask |= toBitMask(newlines) << (chunkIndex * 16);
+            colonMask |= toBitMask(vceqq_u8(bytes, colon)) << (chunkIndex * 16);
+        }
+
+        if((newlineMask | colonMask) != 0) { visitBlock(offset, newlineMask, colonMask, builder); }
+    }
+
+    scanScalar(output, offset, builder);
+}
+#endif
+} // namespace
+
+DiagnosticScanner bestDiagnosticScanner() noexcept
+{
+#if defined(SHADERCOMPILE_SCAN_SSE2)
+    return DiagnosticScanner::Sse2;
+#elif defined(SHADERCOMPILE_SCAN_NEON)
+    return DiagnosticScanner::Neon;
+#else
+    return DiagnosticScanner::Scalar;
+#endif
+}
+
+void scanDiagnostics(std::string_view output, DiagnosticSpans& spans, DiagnosticScanner scanner)
+{
+    DiagnosticSpanBuilder builder(output, spans);
+
+    switch(scanner)
+    {
+#ifdef SHADERCOMPILE_SCAN_SSE2
+    case DiagnosticScanner::Sse2: scanSse2(output, builder); break;
+#endif
+#ifdef SHADERCOMPILE_SCAN_NEON
+    case DiagnosticScanner::Neon: scanNeon(output, builder); break;
+#endif
+    default: scanScalar(output, 0, builder); break;
+    }
+
+    builder.finish();
+}
+} // namespace shadercompile::detail
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace shadercompile::detail
+{
+// The messages of a compiler's output and the colons inside them, which separate all of a message's fields. A message
+// is a line and the indented lines below it, without its trailing newlines. Offsets are 32 bits, the output of a
+// compile is far smaller than that.
+struct DiagnosticSpans
+{
+    std::vector<uint32_t> messageOffsets;
+    std::vector<uint32_t> messageSizes;
+    // The colons of message i are colonOffsets[colonStarts[i]] up to colonOffsets[colonStarts[i + 1]], relative to the
+    // start of the message. There is one more start than there are messages.
+    std::vector<uint32_t> colonStarts;
+    std::vector<uint32_t> colonOffsets;
+
+    [[nodiscard]] size_t size() const noexcept { return messageOffsets.size(); }
+
+    [[nodiscard]] std::span<const uint32_t> colons(size_t messageIndex) const noexcept
+    {
+        return std::span<const uint32_t>(colonOffsets)
+            .subspan(colonStarts[messageIndex], colonStarts[messageIndex + 1] - colonStarts[messageIndex]);
+    }
+
+    void clear() noexcept
+    {
+        messageOffsets.clear();
+        messageSizes.clear();
+        colonStarts.clear();
+        colonOffsets.clear();
+    }
+};
+
+enum class DiagnosticScanner
+{
+    Scalar,
+    Sse2,
+    Neon
+};
+
+// the fastest scanner this build supports
+[[nodiscard]] DiagnosticScanner bestDiagnosticScanner() noexcept;
+
+// Finds every newline and colon of output in a single pass, 64 bytes at a time where the build supports SIMD. A scanner
+// the build does not support falls back to the scalar one.
+void scanDiagnostics(std::string_view output,
+                     DiagnosticSpans& spans,
+                     DiagnosticScanner scanner = bestDiagnosticScanner());
+} // namespace shadercompile::detail
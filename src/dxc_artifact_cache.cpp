@@ -0,0 +1,167 @@
+#include "shadercompile/dxc_artifact_cache.h"
+
+#include "compile_fingerprint.h"
+
+#include <iterator>
+
+namespace shadercompile
+{
+namespace
+{
+// an estimate of the heap memory an entry keeps alive, used to charge it against the budget
+[[nodiscard]] size_t estimateByteCount(const DxcCompileCacheEntry& entry)
+{
+    size_t byteCount = sizeof(DxcCompileCacheEntry);
+
+    // nine 32-bit fields per retained message, one in each array of the storage
+    byteCount += entry.messages.text().size() + entry.messages.size() * 9 * sizeof(int32_t);
+
+    for(const std::optional<std::vector<std::byte>>& artifact : entry.artifacts)
+    {
+        if(artifact) { byteCount += artifact->capacity(); }
+    }
+
+    return byteCount;
+}
+} // namespace
+
+DxcArtifactCache::DxcArtifactCache(size_t byteBudget)
+    : mByteBudget(byteBudget)
+{}
+
+size_t DxcArtifactCache::byteBudget() const
+{
+    std::lock_guard lock(mMutex);
+    return mByteBudget;
+}
+
+void DxcArtifactCache::setByteBudget(size_t byteBudget)
+{
+    std::list<Node> releasedNodes;
+
+    std::lock_guard lock(mMutex);
+
+    mByteBudget = byteBudget;
+    evictToBudget(releasedNodes);
+}
+
+tl::expected<DxcCompileKey, std::errc> DxcArtifactCache::computeKey(std::span<const std::byte> source,
+                                                                    const std::filesystem::path& sourcePath,
+                                                                    std::span<const std::wstring> arguments,
+                                                                    const DxcVersion& compilerVersion,
+                                                                    std::span<const DxcArtifactType> artifactTypes)
+{
+    tl::expected<DxcCompileKey, std::errc> key =
+        detail::computeCompileFingerprint(source, sourcePath, arguments, compilerVersion, artifactTypes, mIncludeCache);
+
+    if(!key) { mUncacheableCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return key;
+}
+
+DxcArtifactCache::Entry DxcArtifactCache::find(const DxcCompileKey& key)
+{
+    Entry entry;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        auto itr = mNodesByKey.find(key.hash);
+
+        if(itr != mNodesByKey.end() && itr->second->inputs == key.inputs)
+        {
+            mNodes.splice(mNodes.begin(), mNodes, itr->second);
+            entry = itr->second->entry;
+        }
+    }
+
+    if(entry != nullptr) { mHitCount.fetch_add(1, std::memory_order_relaxed); }
+    else { mMissCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return entry;
+}
+
+void DxcArtifactCache::insert(const DxcCompileKey& key, Entry entry)
+{
+    if(entry == nullptr) { return; }
+
+    const size_t byteCount = estimateByteCount(*entry) + key.inputs.capacity();
+
+    // the replaced or evicted entries are released outside of the lock
+    std::list<Node> releasedNodes;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        if(byteCount > mByteBudget) { return; }
+
+        // an entry of another compile whose hash collides is replaced as well, the most recent compile wins
+        if(auto itr = mNodesByKey.find(key.hash); itr != mNodesByKey.end())
+        {
+            mResidentByteCount -= itr->second->byteCount;
+            releasedNodes.splice(releasedNodes.end(), mNodes, itr->second);
+            mNodesByKey.erase(itr);
+        }
+
+        mNodes.push_front(
+            Node{.key = key.hash, .inputs = key.inputs, .entry = std::move(entry), .byteCount = byteCount});
+        mNodesByKey.insert_or_assign(key.hash, mNodes.begin());
+        mResidentByteCount += byteCount;
+
+        mInsertCount.fetch_add(1, std::memory_order_relaxed);
+
+        evictToBudget(releasedNodes);
+    }
+}
+
+void DxcArtifactCache::clear()
+{
+    std::list<Node> releasedNodes;
+
+    std::lock_guard lock(mMutex);
+
+    releasedNodes.swap(mNodes);
+    mNodesByKey.clear();
+    mResidentByteCount = 0;
+}
+
+DxcArtifactCacheStatistics DxcArtifactCache::statistics() const
+{
+    DxcArtifactCacheStatistics statistics;
+    statistics.hitCount = mHitCount.load(std::memory_order_relaxed);
+    statistics.missCount = mMissCount.load(std::memory_order_relaxed);
+    statistics.insertCount = mInsertCount.load(std::memory_order_relaxed);
+    statistics.evictionCount = mEvictionCount.load(std::memory_order_relaxed);
+    statistics.uncacheableCount = mUncacheableCount.load(std::memory_order_relaxed);
+
+    std::lock_guard lock(mMutex);
+
+    statistics.entryCount = mNodes.size();
+    statistics.residentByteCount = mResidentByteCount;
+    statistics.byteBudget = mByteBudget;
+
+    return statistics;
+}
+
+void DxcArtifactCache::resetStatistics() noexcept
+{
+    mHitCount.store(0, std::memory_order_relaxed);
+    mMissCount.store(0, std::memory_order_relaxed);
+    mInsertCount.store(0, std::memory_order_relaxed);
+    mEvictionCount.store(0, std::memory_order_relaxed);
+    mUncacheableCount.store(0, std::memory_order_relaxed);
+}
+
+void DxcArtifactCache::evictToBudget(std::list<Node>& releasedNodes)
+{
+    while(mResidentByteCount > mByteBudget)
+    {
+        const Node& node = mNodes.back();
+        mResidentByteCount -= node.byteCount;
+        mNodesByKey.erase(node.key);
+        releasedNodes.splice(releasedNodes.end(), mNodes, std::prev(mNodes.end()));
+
+        mEvictionCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+} // namespace shadercompile
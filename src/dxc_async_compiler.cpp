@@ -0,0 +1,324 @@
+#include "shadercompile/dxc_async_compiler.h"
+
+#include "shadercompile/dxc_external_compiler.h"
+#include "process.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <utility>
+
+namespace shadercompile
+{
+namespace
+{
+#ifndef _WIN32
+// A child that closed its output is about to exit, but may not have yet. It is checked for again after this long, which
+// is the only time the event loop polls.
+constexpr std::chrono::milliseconds kReapInterval{2};
+#endif
+} // namespace
+
+struct DxcAsyncCompiler::InFlightCompile
+{
+    std::unique_ptr<DxcExternalCompiler> compiler;
+    CompletionCallback completion;
+    bool outputClosed = false;
+};
+
+void DxcAsyncCompiler::CompileAwaitable::await_suspend(std::coroutine_handle<> continuation)
+{
+    // the coroutine may resume on another thread before compile() returns, nothing is touched afterwards
+    mCompiler.compile(std::move(mRequest),
+                      [this, continuation](Result result)
+                      {
+                          mResult = std::move(result);
+                          continuation.resume();
+                      });
+}
+
+DxcAsyncCompiler::DxcAsyncCompiler(std::filesystem::path compilerPath, Executor executor)
+    : mCompilerPath(std::move(compilerPath))
+    , mExecutor(std::move(executor))
+{
+#ifndef _WIN32
+    std::array<int, 2> wakeDescriptors;
+
+    if(pipe2(wakeDescriptors.data(), O_CLOEXEC | O_NONBLOCK) != 0) { return; }
+
+    mWakeReadDescriptor = wakeDescriptors[0];
+    mWakeWriteDescriptor = wakeDescriptors[1];
+
+    mEventLoopThread = std::thread(&DxcAsyncCompiler::eventLoopMain, this);
+#endif
+}
+
+DxcAsyncCompiler::~DxcAsyncCompiler()
+{
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+
+    wakeEventLoop();
+
+    if(mEventLoopThread.joinable()) { mEventLoopThread.join(); }
+
+#ifndef _WIN32
+    if(mWakeReadDescriptor != -1) { close(mWakeReadDescriptor); }
+
+    if(mWakeWriteDescriptor != -1) { close(mWakeWriteDescriptor); }
+#endif
+}
+
+void DxcAsyncCompiler::compile(CompileRequest request, CompletionCallback completion)
+{
+#ifdef _WIN32
+    complete(std::move(completion), tl::make_unexpected(std::errc::not_supported));
+#else
+    if(!mEventLoopThread.joinable())
+    {
+        complete(std::move(completion), tl::make_unexpected(std::errc::too_many_files_open));
+        return;
+    }
+
+    auto inFlightCompile = std::make_unique<InFlightCompile>();
+    inFlightCompile->compiler = std::make_unique<DxcExternalCompiler>(mCompilerPath);
+    inFlightCompile->completion = std::move(completion);
+
+    DxcExternalCompiler& compiler = *inFlightCompile->compiler;
+    detail::applyCompileRequest(compiler, request);
+    compiler.setProcessLimits(processLimits());
+    compiler.setAbortOnFirstError(abortOnFirstError());
+
+    tl::expected<void, std::errc> startResult =
+        request.source.empty() ? compiler.prepareCompileFromFile(request.sourcePath)
+                               : compiler.prepareCompileFromBuffer(request.source, request.sourceName);
+
+    if(startResult)
+    {
+        startResult = compiler.process().start();
+
+        // releases the prepared compile
+        if(!startResult) { static_cast<void>(compiler.completeCompile(tl::make_unexpected(startResult.error()))); }
+    }
+
+    if(!startResult)
+    {
+        complete(std::move(inFlightCompile->completion), tl::make_unexpected(startResult.error()));
+        return;
+    }
+
+    {
+        std::lock_guard lock(mMutex);
+
+        mStartedCompiles.push_back(std::move(inFlightCompile));
+        ++mInFlightCount;
+    }
+
+    wakeEventLoop();
+#endif
+}
+
+std::future<DxcAsyncCompiler::Result> DxcAsyncCompiler::compileAsync(CompileRequest request)
+{
+    // std::function needs a copyable callback
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+
+    compile(std::move(request), [promise](Result result) { promise->set_value(std::move(result)); });
+
+    return future;
+}
+
+void DxcAsyncCompiler::setProcessLimits(const DxcProcessLimits& limits)
+{
+    std::lock_guard lock(mMutex);
+    mProcessLimits = limits;
+}
+
+DxcProcessLimits DxcAsyncCompiler::processLimits() const
+{
+    std::lock_guard lock(mMutex);
+    return mProcessLimits;
+}
+
+void DxcAsyncCompiler::setAbortOnFirstError(bool abort)
+{
+    std::lock_guard lock(mMutex);
+    mAbortOnFirstError = abort;
+}
+
+bool DxcAsyncCompiler::abortOnFirstError() const
+{
+    std::lock_guard lock(mMutex);
+    return mAbortOnFirstError;
+}
+
+size_t DxcAsyncCompiler::inFlightCount() const
+{
+    std::lock_guard lock(mMutex);
+    return mInFlightCount;
+}
+
+void DxcAsyncCompiler::complete(CompletionCallback completion, Result result)
+{
+    if(!mExecutor)
+    {
+        completion(std::move(result));
+        return;
+    }
+
+    // the result is move-only, std::function needs a copyable task
+    auto sharedResult = std::make_shared<Result>(std::move(result));
+
+    mExecutor([completion = std::move(completion), sharedResult]() { completion(std::move(*sharedResult)); });
+}
+
+#ifdef _WIN32
+void DxcAsyncCompiler::eventLoopMain() {}
+
+void DxcAsyncCompiler::wakeEventLoop() noexcept {}
+#else
+void DxcAsyncCompiler::eventLoopMain()
+{
+    std::vector<std::unique_ptr<InFlightCompile>> compiles;
+    std::vector<pollfd> pollFds;
+    std::vector<InFlightCompile*> polledCompiles;
+
+    for(;;)
+    {
+        {
+            std::lock_guard lock(mMutex);
+
+            for(std::unique_ptr<InFlightCompile>& startedCompile : mStartedCompiles)
+            {
+                compiles.push_back(std::move(startedCompile));
+            }
+
+            mStartedCompiles.clear();
+
+            if(mStopping) { break; }
+        }
+
+        pollFds.clear();
+        polledCompiles.clear();
+        pollFds.push_back(pollfd{.fd = mWakeReadDescriptor, .events = POLLIN, .revents = 0});
+
+        bool reaping = false;
+        auto nextDeadline = std::chrono::steady_clock::time_point::max();
+
+        for(const std::unique_ptr<InFlightCompile>& compile : compiles)
+        {
+            nextDeadline = std::min(nextDeadline, compile->compiler->process().deadline());
+
+            if(compile->outputClosed)
+            {
+                reaping = true;
+                continue;
+            }
+
+            pollFds.push_back(
+                pollfd{.fd = compile->compiler->process().outputFileDescriptor(), .events = POLLIN, .revents = 0});
+            polledCompiles.push_back(compile.get());
+        }
+
+        int timeout = reaping ? (int)kReapInterval.count() : -1;
+
+        if(nextDeadline != std::chrono::steady_clock::time_point::max())
+        {
+            const auto untilDeadline = std::chrono::ceil<std::chrono::milliseconds>(nextDeadline -
+                                                                                    std::chrono::steady_clock::now());
+            const int deadlineTimeout = (int)std::max<std::chrono::milliseconds::rep>(untilDeadline.count(), 0);
+
+            timeout = (timeout == -1) ? deadlineTimeout : std::min(timeout, deadlineTimeout);
+        }
+
+        // a failed poll is retried, the children are still running and have to be supervised
+        if(poll(pollFds.data(), pollFds.size(), timeout) == -1) { continue; }
+
+        // a killed child closes its output, it is then drained and reaped like any other
+        const auto now = std::chrono::steady_clock::now();
+
+        for(const std::unique_ptr<InFlightCompile>& compile : compiles)
+        {
+            compile->compiler->process().killIfTimedOut(now);
+        }
+
+        if(pollFds[0].revents != 0)
+        {
+            std::array<char, 64> buffer;
+            while(read(mWakeReadDescriptor, buffer.data(), buffer.size()) > 0) {}
+        }
+
+        for(size_t index = 0; index < polledCompiles.size(); ++index)
+        {
+            InFlightCompile& compile = *polledCompiles[index];
+
+            if(pollFds[index + 1].revents == 0) { continue; }
+
+            if(!compile.compiler->process().readChildOutput()) { compile.outputClosed = true; }
+        }
+
+        for(size_t index = 0; index < compiles.size();)
+        {
+            InFlightCompile& compile = *compiles[index];
+
+            std::optional<tl::expected<int, std::errc>> exitCode;
+
+            if(compile.outputClosed) { exitCode = compile.compiler->process().tryReap(); }
+
+            if(!exitCode)
+            {
+                ++index;
+                continue;
+            }
+
+            tl::expected<CompileSummary, std::errc> summary = compile.compiler->completeCompile(exitCode.value());
+
+            Result result = summary ? Result(detail::takeCompileResult(*compile.compiler, summary.value()))
+                                    : Result(tl::make_unexpected(summary.error()));
+
+            std::unique_ptr<InFlightCompile> completedCompile = std::move(compiles[index]);
+            compiles[index] = std::move(compiles.back());
+            compiles.pop_back();
+
+            {
+                std::lock_guard lock(mMutex);
+                --mInFlightCount;
+            }
+
+            complete(std::move(completedCompile->completion), std::move(result));
+        }
+    }
+
+    for(std::unique_ptr<InFlightCompile>& compile : compiles)
+    {
+        // the process is reaped when it is destroyed
+        compile->compiler->process().kill();
+        static_cast<void>(compile->compiler->completeCompile(tl::make_unexpected(std::errc::operation_canceled)));
+
+        complete(std::move(compile->completion), tl::make_unexpected(std::errc::operation_canceled));
+    }
+
+    std::lock_guard lock(mMutex);
+    mInFlightCount = 0;
+}
+
+void DxcAsyncCompiler::wakeEventLoop() noexcept
+{
+    if(mWakeWriteDescriptor == -1) { return; }
+
+    // a full pipe already wakes the loop
+    const char byte = 0;
+    static_cast<void>(write(mWakeWriteDescriptor, &byte, 1));
+}
+#endif
+} // namespace shadercompile
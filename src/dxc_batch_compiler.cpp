@@ -0,0 +1,371 @@
+#include "shadercompile/dxc_batch_compiler.h"
+
+#include "compile_fingerprint.h"
+#include "utility.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+using namespace std::string_view_literals;
+
+namespace shadercompile
+{
+namespace
+{
+// Preprocesses request with -P and fingerprints everything that still decides code generation afterwards. The defines
+// and include directories are left out, the preprocessed source already reflects them. The key's inputs hold the
+// preprocessed source and the rest of it, requests only share a result when their inputs are equal.
+[[nodiscard]] std::optional<DxcCompileKey> computePreprocessedKey(detail::BaseDxcCompiler& compiler,
+                                                                  const CompileRequest& request)
+{
+    CompileRequest preprocessRequest;
+    preprocessRequest.sourcePath = request.sourcePath;
+    preprocessRequest.source = request.source;
+    preprocessRequest.sourceName = request.sourceName;
+    preprocessRequest.targetProfile = request.targetProfile;
+    preprocessRequest.entryPoint = request.entryPoint;
+    preprocessRequest.arguments = request.arguments;
+    preprocessRequest.arguments.emplace_back(L"-P");
+    preprocessRequest.enableArtifactWithMemorySink(DxcArtifactType::PreprocessedSource);
+
+    tl::expected<CompileResult, std::errc> result = DxcBatchCompiler::compile(compiler, preprocessRequest);
+
+    if(!result || !result->succeeded()) { return std::nullopt; }
+
+    const std::span<const std::byte> preprocessedSource = result->artifact(DxcArtifactType::PreprocessedSource).data();
+
+    if(preprocessedSource.empty()) { return std::nullopt; }
+
+    std::vector<std::wstring> normalizedArguments;
+    std::vector<std::filesystem::path> includeDirectories;
+    detail::normalizeCompileArguments(request.arguments, normalizedArguments, includeDirectories);
+
+    // Every field is terminated so that adjacent fields cannot run into each other. The preprocessed source may hold
+    // null characters, so it comes last.
+    constexpr std::string_view kTerminator("\0", 1);
+
+    DxcCompileKey key;
+    std::string& inputs = key.inputs;
+
+    for(const std::wstring& argument : normalizedArguments)
+    {
+        if(argument.starts_with(L"-D"sv) || argument.starts_with(L"-I"sv)) { continue; }
+
+        inputs.append(utf8Encode(argument));
+        inputs.append(kTerminator);
+    }
+
+    // arguments cannot be empty, so the empty field ends them
+    inputs.append(kTerminator);
+    inputs.append(utf8Encode(toWStringView(request.targetProfile)));
+    inputs.append(kTerminator);
+    inputs.append(utf8Encode(request.entryPoint));
+    inputs.append(kTerminator);
+
+    forEachEnum<DxcArtifactType>(
+        [&](DxcArtifactType type)
+        {
+            inputs.push_back((request.artifactSinks[(size_t)type] == DxcSinkType::None) ? '0' : '1');
+        });
+
+    inputs.append(reinterpret_cast<const char*>(preprocessedSource.data()), preprocessedSource.size());
+
+    Fnv1aHash hash;
+    hash.update(inputs);
+    key.hash = hash.value();
+
+    return key;
+}
+
+// Gives request a copy of the result compiled for another request with the same preprocessed key. The artifacts are
+// delivered to the sinks of request, which may differ from the sinks they were compiled into. Fails with
+// std::errc::io_error when an artifact cannot be read back or written to the file sink of request.
+[[nodiscard]] tl::expected<CompileResult, std::errc>
+shareCompileResult(const tl::expected<CompileResult, std::errc>& compiledResult, const CompileRequest& request)
+{
+    if(!compiledResult) { return tl::make_unexpected(compiledResult.error()); }
+
+    bool delivered = true;
+
+    CompileResult result;
+    result.returnCode = compiledResult->returnCode;
+    result.arguments = compiledResult->arguments;
+    result.messages = compiledResult->messages;
+    result.errorCount = compiledResult->errorCount;
+    result.warningCount = compiledResult->warningCount;
+
+    forEachEnum<DxcArtifactType>(
+        result.artifacts,
+        [&](DxcArtifactType type, DxcArtifact& artifact)
+        {
+            const DxcSinkType sinkType = request.artifactSinks[(size_t)type];
+            const DxcArtifact& compiledArtifact = compiledResult->artifact(type);
+
+            std::optional<std::vector<std::byte>> contents;
+
+            if(compiledArtifact.sinkType() == DxcSinkType::MemoryBuffer)
+            {
+                const std::span<const std::byte> data = compiledArtifact.data();
+                if(!data.empty()) { contents.emplace(data.begin(), data.end()); }
+            }
+            else if(compiledArtifact.sinkType() == DxcSinkType::File && !compiledArtifact.path().empty())
+            {
+                contents = readFileContents(compiledArtifact.path());
+
+                // a failed compile may leave no file behind
+                if(!contents && sinkType != DxcSinkType::None && compiledResult->succeeded()) { delivered = false; }
+            }
+
+            if(sinkType == DxcSinkType::MemoryBuffer)
+            {
+                artifact = contents ? DxcArtifact(std::move(contents.value())) : DxcArtifact(sinkType);
+            }
+            else if(sinkType == DxcSinkType::File)
+            {
+                // without contents the path is not handed out, the file there may be stale
+                if(!contents)
+                {
+                    artifact = DxcArtifact(sinkType);
+                    return;
+                }
+
+                const std::filesystem::path& path = request.artifactPaths[(size_t)type];
+
+                std::ofstream fileStream(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+                fileStream.write(reinterpret_cast<const char*>(contents->data()), (std::streamsize)contents->size());
+                fileStream.close();
+
+                if(!fileStream) { delivered = false; }
+
+                artifact = DxcArtifact(path);
+            }
+        });
+
+    if(!delivered) { return tl::make_unexpected(std::errc::io_error); }
+
+    return result;
+}
+} // namespace
+
+DxcBatchCompiler::DxcBatchCompiler(CompilerFactory compilerFactory, size_t threadCount)
+    : mCompilerFactory(std::move(compilerFactory))
+{
+    if(threadCount == 0) { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+
+    mPool = std::make_unique<WorkStealingPool>(threadCount);
+    mCompilers.resize(mPool->threadCount());
+}
+
+DxcBatchCompiler::~DxcBatchCompiler()
+{
+    // the workers must be gone before the compilers they use
+    mPool.reset();
+}
+
+size_t DxcBatchCompiler::threadCount() const noexcept
+{
+    return mPool->threadCount();
+}
+
+DxcBatchCompilerStatistics DxcBatchCompiler::statistics() const noexcept
+{
+    return DxcBatchCompilerStatistics{
+        .compileCount = mCompileCount.load(std::memory_order_relaxed),
+        .deduplicatedCount = mDeduplicatedCount.load(std::memory_order_relaxed),
+        .preprocessFailureCount = mPreprocessFailureCount.load(std::memory_order_relaxed)};
+}
+
+void DxcBatchCompiler::resetStatistics() noexcept
+{
+    mCompileCount.store(0, std::memory_order_relaxed);
+    mDeduplicatedCount.store(0, std::memory_order_relaxed);
+    mPreprocessFailureCount.store(0, std::memory_order_relaxed);
+}
+
+std::vector<tl::expected<CompileResult, std::errc>>
+DxcBatchCompiler::compileBatch(std::span<const CompileRequest> requests)
+{
+    if(mPreprocessDeduplication) { return compileDeduplicated(requests); }
+
+    std::vector<tl::expected<CompileResult, std::errc>> results(requests.size());
+
+    run(requests.size(),
+        [&](size_t index, detail::BaseDxcCompiler* compiler)
+        {
+            if(compiler == nullptr)
+            {
+                results[index] = tl::make_unexpected(std::errc::not_enough_memory);
+                return;
+            }
+
+            results[index] = compile(*compiler, requests[index]);
+        });
+
+    mCompileCount.fetch_add(requests.size(), std::memory_order_relaxed);
+
+    return results;
+}
+
+std::vector<tl::expected<CompileResult, std::errc>>
+DxcBatchCompiler::compileDeduplicated(std::span<const CompileRequest> requests)
+{
+    std::vector<std::optional<DxcCompileKey>> keys(requests.size());
+
+    run(requests.size(),
+        [&](size_t index, detail::BaseDxcCompiler* compiler)
+        {
+            if(compiler != nullptr) { keys[index] = computePreprocessedKey(*compiler, requests[index]); }
+        });
+
+    // The first request with a key is compiled, every later request with the same key shares its result. Requests
+    // whose hashes collide but whose inputs differ are compiled on their own.
+    std::vector<size_t> compiledIndices(requests.size());
+    std::vector<size_t> indicesToCompile;
+    std::unordered_map<uint64_t, std::vector<size_t>> compiledIndicesByHash;
+    uint64_t preprocessFailureCount = 0;
+
+    for(size_t index = 0; index < requests.size(); ++index)
+    {
+        compiledIndices[index] = index;
+
+        if(!keys[index])
+        {
+            ++preprocessFailureCount;
+            indicesToCompile.push_back(index);
+            continue;
+        }
+
+        std::vector<size_t>& candidates = compiledIndicesByHash[keys[index]->hash];
+
+        auto candidateItr = std::ranges::find_if(
+            candidates, [&](size_t candidate) { return keys[candidate]->inputs == keys[index]->inputs; });
+
+        if(candidateItr != candidates.end())
+        {
+            compiledIndices[index] = *candidateItr;
+            continue;
+        }
+
+        candidates.push_back(index);
+        indicesToCompile.push_back(index);
+    }
+
+    std::vector<tl::expected<CompileResult, std::errc>> results(requests.size());
+
+    run(indicesToCompile.size(),
+        [&](size_t index, detail::BaseDxcCompiler* compiler)
+        {
+            const size_t requestIndex = indicesToCompile[index];
+
+            if(compiler == nullptr)
+            {
+                results[requestIndex] = tl::make_unexpected(std::errc::not_enough_memory);
+                return;
+            }
+
+            results[requestIndex] = compile(*compiler, requests[requestIndex]);
+        });
+
+    // sharing may copy files, so it runs on the pool as well
+    std::atomic<uint64_t> recompileCount = 0;
+
+    run(requests.size(),
+        [&](size_t index, detail::BaseDxcCompiler* compiler)
+        {
+            if(compiledIndices[index] == index) { return; }
+
+            results[index] = shareCompileResult(results[compiledIndices[index]], requests[index]);
+
+            // a result whose artifacts could not be delivered is compiled for the request instead
+            if(!results[index] && results[compiledIndices[index]] && compiler != nullptr)
+            {
+                results[index] = compile(*compiler, requests[index]);
+                recompileCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+    const uint64_t compileCount = indicesToCompile.size() + recompileCount.load(std::memory_order_relaxed);
+
+    mCompileCount.fetch_add(compileCount, std::memory_order_relaxed);
+    mDeduplicatedCount.fetch_add(requests.size() - compileCount, std::memory_order_relaxed);
+    mPreprocessFailureCount.fetch_add(preprocessFailureCount, std::memory_order_relaxed);
+
+    return results;
+}
+
+void DxcBatchCompiler::run(size_t count,
+                           const std::function<void(size_t index, detail::BaseDxcCompiler* compiler)>& task)
+{
+    mPool->run(count,
+               [&](size_t index, size_t workerIndex)
+               {
+                   std::unique_ptr<detail::BaseDxcCompiler>& compiler = mCompilers[workerIndex];
+
+                   if(compiler == nullptr) { compiler = mCompilerFactory(); }
+
+                   task(index, compiler.get());
+               });
+}
+
+tl::expected<CompileResult, std::errc> DxcBatchCompiler::compile(detail::BaseDxcCompiler& compiler,
+                                                                 const CompileRequest& request)
+{
+    detail::applyCompileRequest(compiler, request);
+
+    tl::expected<CompileSummary, std::errc> summary =
+        request.source.empty() ? compiler.compileFromFile(request.sourcePath)
+                               : compiler.compileFromBuffer(request.source, std::wstring_view(request.sourceName));
+
+    if(!summary) { return tl::make_unexpected(summary.error()); }
+
+    return detail::takeCompileResult(compiler, summary.value());
+}
+
+namespace detail
+{
+void applyCompileRequest(BaseDxcCompiler& compiler, const CompileRequest& request)
+{
+    compiler.reset();
+
+    if(request.targetProfile != DxcTargetProfile::Unknown) { compiler.setTargetProfile(request.targetProfile); }
+
+    if(!request.entryPoint.empty()) { compiler.setEntryPoint(std::wstring_view(request.entryPoint)); }
+
+    compiler.addArguments(std::span<const std::wstring>(request.arguments));
+
+    forEachEnum<DxcArtifactType>(
+        [&](DxcArtifactType type)
+        {
+            const DxcSinkType sinkType = request.artifactSinks[(size_t)type];
+
+            if(sinkType == DxcSinkType::File)
+            {
+                compiler.enableArtifactWithFileSink(type, request.artifactPaths[(size_t)type]);
+            }
+            else if(sinkType == DxcSinkType::MemoryBuffer) { compiler.enableArtifactWithMemorySink(type); }
+        });
+}
+
+CompileResult takeCompileResult(BaseDxcCompiler& compiler, const CompileSummary& summary)
+{
+    CompileResult result;
+    result.returnCode = summary.returnCode;
+    result.termination = summary.termination;
+    result.arguments.assign(summary.arguments.begin(), summary.arguments.end());
+    result.messages = summary.messages;
+    result.errorCount = summary.errorCount;
+    result.warningCount = summary.warningCount;
+
+    forEachEnum<DxcArtifactType>(result.artifacts,
+                                 [&](DxcArtifactType type, DxcArtifact& artifact)
+                                 { artifact = compiler.takeArtifact(type); });
+
+    return result;
+}
+} // namespace detail
+} // namespace shadercompile
@@ -0,0 +1,66 @@
+#include "dxc_caching_include_handler.h"
+
+#include <utility>
+
+namespace shadercompile
+{
+DxcCachingIncludeHandler::DxcCachingIncludeHandler(ComPtr<IDxcUtils> utils,
+                                                   std::shared_ptr<DxcIncludeCache> cache) noexcept
+    : mUtils(std::move(utils))
+    , mCache(std::move(cache))
+{}
+
+HRESULT STDMETHODCALLTYPE DxcCachingIncludeHandler::LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource)
+{
+    if(ppIncludeSource == nullptr) { return E_INVALIDARG; }
+
+    *ppIncludeSource = nullptr;
+
+    if(pFilename == nullptr) { return E_INVALIDARG; }
+
+    // the compiler probes every include directory in turn, a failure here makes it try the next one
+    tl::expected<DxcIncludeCache::Contents, std::errc> contents = mCache->load(std::filesystem::path(pFilename));
+
+    if(!contents) { return E_FAIL; }
+
+    ComPtr<IDxcBlobEncoding> blob;
+    const HRESULT hr =
+        mUtils->CreateBlob(contents.value()->data(), (UINT32)contents.value()->size(), DXC_CP_ACP, &blob);
+
+    if(FAILED(hr)) { return hr; }
+
+    *ppIncludeSource = blob.Detach();
+
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DxcCachingIncludeHandler::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if(ppvObject == nullptr) { return E_INVALIDARG; }
+
+    if(IsEqualIID(riid, __uuidof(IDxcIncludeHandler)) || IsEqualIID(riid, __uuidof(IUnknown)))
+    {
+        AddRef();
+        *ppvObject = static_cast<IDxcIncludeHandler*>(this);
+        return S_OK;
+    }
+
+    *ppvObject = nullptr;
+
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE DxcCachingIncludeHandler::AddRef()
+{
+    return mReferenceCount.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG STDMETHODCALLTYPE DxcCachingIncludeHandler::Release()
+{
+    const ULONG referenceCount = mReferenceCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+
+    if(referenceCount == 0) { delete this; }
+
+    return referenceCount;
+}
+} // namespace shadercompile
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <shadercompile/detail/com_ptr.h>
+#include <shadercompile/dxc_include_cache.h>
+
+#include <dxcapi.h>
+
+#include <atomic>
+#include <memory>
+
+namespace shadercompile
+{
+// Serves the compiler's #include requests from a DxcIncludeCache. The cached contents are copied into a blob for the
+// compiler, which is far cheaper than the open and read done by the default include handler.
+class DxcCachingIncludeHandler final : public IDxcIncludeHandler
+{
+public:
+    DxcCachingIncludeHandler(ComPtr<IDxcUtils> utils, std::shared_ptr<DxcIncludeCache> cache) noexcept;
+
+    HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override;
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+private:
+    ~DxcCachingIncludeHandler() = default;
+
+    std::atomic<ULONG> mReferenceCount = 0;
+    ComPtr<IDxcUtils> mUtils;
+    std::shared_ptr<DxcIncludeCache> mCache;
+};
+} // namespace shadercompile
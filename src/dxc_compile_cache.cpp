@@ -0,0 +1,216 @@
+#include "shadercompile/dxc_compile_cache.h"
+
+#include "compile_fingerprint.h"
+#include "compile_server_protocol.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+namespace shadercompile
+{
+namespace
+{
+constexpr std::array<std::byte, 8> kEntryMagic = {std::byte{'S'},
+                                                  std::byte{'C'},
+                                                  std::byte{'C'},
+                                                  std::byte{'A'},
+                                                  std::byte{'C'},
+                                                  std::byte{'H'},
+                                                  std::byte{'E'},
+                                                  std::byte{'4'}};
+
+[[nodiscard]] std::string toHexString(uint64_t value)
+{
+    constexpr std::string_view kHexDigits = "0123456789abcdef"sv;
+
+    std::string str(16, '0');
+
+    for(size_t index = 0; index < 16; ++index)
+    {
+        str[15 - index] = kHexDigits[(value >> (index * 4)) & 0xF];
+    }
+
+    return str;
+}
+
+[[nodiscard]] std::array<char, 4> encodeSize(uint32_t size)
+{
+    return {(char)(size & 0xFF), (char)((size >> 8) & 0xFF), (char)((size >> 16) & 0xFF), (char)(size >> 24)};
+}
+
+[[nodiscard]] uint64_t makeTemporaryFileSuffix()
+{
+    thread_local std::mt19937_64 generator(std::random_device{}());
+    return generator();
+}
+} // namespace
+
+DxcCompileCache::DxcCompileCache(std::filesystem::path directory)
+    : mDirectory(std::move(directory))
+{}
+
+tl::expected<DxcCompileKey, std::errc> DxcCompileCache::computeKey(std::span<const std::byte> source,
+                                                                   const std::filesystem::path& sourcePath,
+                                                                   std::span<const std::wstring> arguments,
+                                                                   const DxcVersion& compilerVersion,
+                                                                   std::span<const DxcArtifactType> artifactTypes)
+{
+    tl::expected<DxcCompileKey, std::errc> key =
+        detail::computeCompileFingerprint(source, sourcePath, arguments, compilerVersion, artifactTypes, mIncludeCache);
+
+    if(!key) { mUncacheableCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return key;
+}
+
+std::optional<DxcCompileCacheEntry> DxcCompileCache::load(const DxcCompileKey& key)
+{
+    const std::filesystem::path path = entryPath(key.hash);
+    std::ifstream fileStream(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+
+    // a directory opens on some platforms and reports a size of -1 or a meaningless one, it is not an entry either
+    std::error_code errorCode;
+    const std::streamoff fileSize = fileStream.is_open() ? (std::streamoff)fileStream.tellg() : -1;
+
+    if(fileSize < 0 || !std::filesystem::is_regular_file(path, errorCode))
+    {
+        mMissCount.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    std::vector<std::byte> contents((size_t)fileSize);
+    fileStream.seekg(0);
+    fileStream.read(reinterpret_cast<char*>(contents.data()), (std::streamsize)contents.size());
+
+    constexpr size_t kHeaderSize = kEntryMagic.size() + sizeof(uint32_t);
+
+    // an entry is the magic, the size prefixed inputs of its key and the result as a compile server response frame
+    auto decodeEntry = [&]() -> std::optional<DxcCompileCacheEntry>
+    {
+        if(!fileStream || contents.size() < kHeaderSize) { return std::nullopt; }
+
+        if(!std::equal(kEntryMagic.begin(), kEntryMagic.end(), contents.begin())) { return std::nullopt; }
+
+        const std::span<const std::byte> entry = std::span<const std::byte>(contents).subspan(kEntryMagic.size());
+        const std::optional<uint32_t> inputsSize = detail::decodeFrameSize(entry.first<4>());
+
+        if(!inputsSize || inputsSize.value() > entry.size() - sizeof(uint32_t)) { return std::nullopt; }
+
+        // the entry of another compile whose hash collides with the key is a miss
+        const std::span<const std::byte> inputs = entry.subspan(sizeof(uint32_t), inputsSize.value());
+
+        if(!std::ranges::equal(inputs, std::as_bytes(std::span<const char>(key.inputs)))) { return std::nullopt; }
+
+        const std::span<const std::byte> frame = entry.subspan(sizeof(uint32_t) + inputsSize.value());
+
+        if(frame.size() < sizeof(uint32_t)) { return std::nullopt; }
+
+        const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(frame.first<4>());
+
+        if(!payloadSize || payloadSize.value() != frame.size() - sizeof(uint32_t)) { return std::nullopt; }
+
+        tl::expected<detail::CompileServerResponse, std::errc> response =
+            detail::decodeCompileServerResponse(frame.subspan(sizeof(uint32_t)));
+
+        if(!response) { return std::nullopt; }
+
+        return DxcCompileCacheEntry{.returnCode = response->returnCode,
+                                    .messages = std::move(response->messages),
+                                    .artifacts = std::move(response->artifacts)};
+    };
+
+    std::optional<DxcCompileCacheEntry> entry = decodeEntry();
+
+    if(entry) { mHitCount.fetch_add(1, std::memory_order_relaxed); }
+    else { mMissCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return entry;
+}
+
+tl::expected<void, std::errc> DxcCompileCache::store(const DxcCompileKey& key, const DxcCompileCacheEntry& entry)
+{
+    if(key.inputs.size() > detail::kMaxCompileServerFrameSize)
+    {
+        return tl::make_unexpected(std::errc::value_too_large);
+    }
+
+    const detail::CompileServerResponse response{
+        .returnCode = entry.returnCode, .messages = entry.messages, .artifacts = entry.artifacts};
+
+    std::vector<std::byte> frame;
+    detail::encodeCompileServerResponse(response, frame);
+
+    const std::filesystem::path path = entryPath(key.hash);
+
+    std::error_code errorCode;
+    std::filesystem::create_directories(path.parent_path(), errorCode);
+
+    if(errorCode) { return tl::make_unexpected(std::errc::io_error); }
+
+    // Written next to the entry and renamed over it, which is atomic on the same file system. Concurrent writers of
+    // the same inputs produce identical contents, so it does not matter which rename lands last. Of two compiles whose
+    // hashes collide the last one to be stored keeps the entry, the other one misses.
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += "." + toHexString(makeTemporaryFileSuffix()) + ".tmp";
+
+    {
+        std::ofstream fileStream(temporaryPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+        if(!fileStream.is_open()) { return tl::make_unexpected(std::errc::io_error); }
+
+        const std::array<char, 4> inputsSize = encodeSize((uint32_t)key.inputs.size());
+
+        fileStream.write(reinterpret_cast<const char*>(kEntryMagic.data()), kEntryMagic.size());
+        fileStream.write(inputsSize.data(), inputsSize.size());
+        fileStream.write(key.inputs.data(), (std::streamsize)key.inputs.size());
+        fileStream.write(reinterpret_cast<const char*>(frame.data()), (std::streamsize)frame.size());
+        fileStream.close();
+
+        if(!fileStream)
+        {
+            std::filesystem::remove(temporaryPath, errorCode);
+            return tl::make_unexpected(std::errc::io_error);
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, errorCode);
+
+    if(errorCode)
+    {
+        std::filesystem::remove(temporaryPath, errorCode);
+        return tl::make_unexpected(std::errc::io_error);
+    }
+
+    mStoreCount.fetch_add(1, std::memory_order_relaxed);
+
+    return {};
+}
+
+DxcCompileCacheStatistics DxcCompileCache::statistics() const noexcept
+{
+    return DxcCompileCacheStatistics{.hitCount = mHitCount.load(std::memory_order_relaxed),
+                                     .missCount = mMissCount.load(std::memory_order_relaxed),
+                                     .storeCount = mStoreCount.load(std::memory_order_relaxed),
+                                     .uncacheableCount = mUncacheableCount.load(std::memory_order_relaxed)};
+}
+
+void DxcCompileCache::resetStatistics() noexcept
+{
+    mHitCount.store(0, std::memory_order_relaxed);
+    mMissCount.store(0, std::memory_order_relaxed);
+    mStoreCount.store(0, std::memory_order_relaxed);
+    mUncacheableCount.store(0, std::memory_order_relaxed);
+}
+
+std::filesystem::path DxcCompileCache::entryPath(uint64_t hash) const
+{
+    const std::string name = toHexString(hash);
+
+    // fan out over 256 subdirectories to keep directory sizes reasonable
+    return mDirectory / name.substr(0, 2) / (name + ".entry");
+}
+} // namespace shadercompile
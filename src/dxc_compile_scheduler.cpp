@@ -0,0 +1,240 @@
+#include "shadercompile/dxc_compile_scheduler.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace shadercompile
+{
+struct DxcCompileScheduler::QueuedJob
+{
+    JobId id = 0;
+    CompileRequest request;
+    std::stop_token cancellationToken;
+    std::promise<Result> promise;
+    std::optional<std::stop_callback<std::function<void()>>> cancellationCallback;
+};
+
+DxcCompileScheduler::DxcCompileScheduler(CompilerFactory compilerFactory, size_t threadCount)
+    : mCompilerFactory(std::move(compilerFactory))
+{
+    if(threadCount == 0) { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+
+    mThreads.reserve(threadCount);
+
+    for(size_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+    {
+        mThreads.emplace_back(&DxcCompileScheduler::workerMain, this);
+    }
+}
+
+DxcCompileScheduler::~DxcCompileScheduler()
+{
+    std::array<JobQueue, (size_t)CompilePriority::_count> queues;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        mStopping = true;
+        queues.swap(mQueues);
+        mQueuedPriorities.clear();
+    }
+
+    mWorkAvailable.notify_all();
+
+    for(std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+
+    for(JobQueue& queue : queues)
+    {
+        for(auto& [jobId, job] : queue)
+        {
+            job->promise.set_value(tl::make_unexpected(std::errc::operation_canceled));
+        }
+    }
+}
+
+DxcCompileScheduler::Job
+DxcCompileScheduler::submit(CompileRequest request, CompilePriority priority, std::stop_token cancellationToken)
+{
+    auto queuedJob = std::make_unique<QueuedJob>();
+    queuedJob->request = std::move(request);
+    queuedJob->cancellationToken = cancellationToken;
+
+    Job job;
+    job.result = queuedJob->promise.get_future();
+
+    {
+        std::lock_guard lock(mMutex);
+        job.id = mNextJobId++;
+    }
+
+    queuedJob->id = job.id;
+
+    if(cancellationToken.stop_requested())
+    {
+        queuedJob->promise.set_value(tl::make_unexpected(std::errc::operation_canceled));
+
+        std::lock_guard lock(mMutex);
+        ++mCancelledCount;
+
+        return job;
+    }
+
+    // registered before the job is queued, a token that is stopped in between is seen when a worker takes the job
+    queuedJob->cancellationCallback.emplace(cancellationToken,
+                                            [this, jobId = job.id]() { cancelQueuedJob(jobId); });
+
+    {
+        std::lock_guard lock(mMutex);
+
+        mQueuedPriorities.emplace(job.id, priority);
+        mQueues[(size_t)priority].emplace(job.id, std::move(queuedJob));
+    }
+
+    mWorkAvailable.notify_one();
+
+    return job;
+}
+
+bool DxcCompileScheduler::setPriority(JobId jobId, CompilePriority priority)
+{
+    std::lock_guard lock(mMutex);
+
+    auto itr = mQueuedPriorities.find(jobId);
+
+    if(itr == mQueuedPriorities.end()) { return false; }
+
+    if(itr->second != priority)
+    {
+        mQueues[(size_t)priority].insert(mQueues[(size_t)itr->second].extract(jobId));
+        itr->second = priority;
+    }
+
+    return true;
+}
+
+DxcCompileSchedulerStatistics DxcCompileScheduler::statistics() const
+{
+    DxcCompileSchedulerStatistics statistics;
+
+    std::lock_guard lock(mMutex);
+
+    for(size_t priorityIndex = 0; priorityIndex < mQueues.size(); ++priorityIndex)
+    {
+        statistics.queuedCounts[priorityIndex] = mQueues[priorityIndex].size();
+    }
+
+    statistics.runningCount = mRunningCount;
+    statistics.completedCount = mCompletedCount;
+    statistics.cancelledCount = mCancelledCount;
+
+    return statistics;
+}
+
+void DxcCompileScheduler::workerMain()
+{
+    // created on the worker's first job, a factory that fails is asked again on the next one
+    std::unique_ptr<detail::BaseDxcCompiler> compiler;
+
+    for(;;)
+    {
+        std::unique_ptr<QueuedJob> job;
+        std::vector<std::unique_ptr<QueuedJob>> cancelledJobs;
+
+        {
+            std::unique_lock lock(mMutex);
+
+            mWorkAvailable.wait(lock,
+                                [&]()
+                                { return mStopping || !mQueuedPriorities.empty() || !mCancelledJobs.empty(); });
+
+            if(mStopping) { return; }
+
+            cancelledJobs.swap(mCancelledJobs);
+            job = popJob();
+
+            if(job != nullptr) { ++mRunningCount; }
+        }
+
+        // destroying a cancellation callback waits for it to return, which must not happen under the lock
+        cancelledJobs.clear();
+
+        if(job == nullptr) { continue; }
+
+        Result result = tl::make_unexpected(std::errc::operation_canceled);
+
+        if(!job->cancellationToken.stop_requested())
+        {
+            if(compiler == nullptr) { compiler = mCompilerFactory(); }
+
+            if(compiler == nullptr) { result = tl::make_unexpected(std::errc::not_enough_memory); }
+            else
+            {
+                compiler->setCancellationToken(job->cancellationToken);
+                result = DxcBatchCompiler::compile(*compiler, job->request);
+                compiler->setCancellationToken({});
+            }
+        }
+
+        const bool cancelled = !result && result.error() == std::errc::operation_canceled;
+
+        job->promise.set_value(std::move(result));
+        job.reset();
+
+        std::lock_guard lock(mMutex);
+
+        --mRunningCount;
+
+        if(cancelled) { ++mCancelledCount; }
+        else { ++mCompletedCount; }
+    }
+}
+
+void DxcCompileScheduler::cancelQueuedJob(JobId jobId)
+{
+    std::unique_ptr<QueuedJob> job;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        auto itr = mQueuedPriorities.find(jobId);
+
+        // a job that is running is cancelled by its compiler
+        if(itr == mQueuedPriorities.end()) { return; }
+
+        job = std::move(mQueues[(size_t)itr->second].extract(jobId).mapped());
+        mQueuedPriorities.erase(itr);
+
+        ++mCancelledCount;
+    }
+
+    job->promise.set_value(tl::make_unexpected(std::errc::operation_canceled));
+
+    {
+        std::lock_guard lock(mMutex);
+        mCancelledJobs.push_back(std::move(job));
+    }
+
+    mWorkAvailable.notify_one();
+}
+
+std::unique_ptr<DxcCompileScheduler::QueuedJob> DxcCompileScheduler::popJob()
+{
+    for(JobQueue& queue : mQueues)
+    {
+        if(queue.empty()) { continue; }
+
+        std::unique_ptr<QueuedJob> job = std::move(queue.begin()->second);
+        queue.erase(queue.begin());
+        mQueuedPriorities.erase(job->id);
+
+        return job;
+    }
+
+    return nullptr;
+}
+} // namespace shadercompile
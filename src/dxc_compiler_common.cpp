@@ -1,13 +1,34 @@
 #include "shadercompile/detail/dxc_compiler_common.h"
 
+#include "shadercompile/dxc_artifact_cache.h"
+#include "shadercompile/dxc_compile_cache.h"
+#include "shadercompile/dxc_dependency_graph.h"
+#include "shadercompile/dxc_single_flight.h"
+#include "compile_fingerprint.h"
+#include "diagnostic_parser.h"
+#include "diagnostic_scanner.h"
+#include "include_scanner.h"
 #include "utility.h"
 
 #include <dxcapi.h>
 
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <optional>
+#include <utility>
+
 using namespace std::string_view_literals;
 
 namespace shadercompile
 {
+namespace
+{
+// how often a compile that waits for an identical compile in flight checks whether it was cancelled
+constexpr std::chrono::milliseconds kSingleFlightPollInterval{10};
+} // namespace
+
 DxcArtifact::DxcArtifact() noexcept = default;
 
 DxcArtifact::DxcArtifact(DxcArtifact&&) noexcept = default;
@@ -17,24 +38,50 @@ DxcArtifact::DxcArtifact(DxcSinkType sinkType) noexcept
 {}
 
 DxcArtifact::DxcArtifact(std::vector<std::byte> buffer) noexcept
-    : mStorage(std::move(buffer))
-    , mSinkType(DxcSinkType::MemoryBuffer)
+    : mSinkType(DxcSinkType::MemoryBuffer)
+    , mStorage(std::move(buffer))
 {}
 
 DxcArtifact::DxcArtifact(std::filesystem::path path) noexcept
-    : mPath(std::move(path))
-    , mSinkType(DxcSinkType::File)
+    : mSinkType(DxcSinkType::File)
+    , mPath(std::move(path))
 {}
 
-DxcArtifact::DxcArtifact(Microsoft::WRL::ComPtr<IDxcBlob> buffer) noexcept
-    : mStorage(std::move(buffer))
-    , mSinkType(DxcSinkType::MemoryBuffer)
+DxcArtifact::DxcArtifact(ComPtr<IDxcBlob> buffer) noexcept
+    : mSinkType(DxcSinkType::MemoryBuffer)
+    , mStorage(std::move(buffer))
+{}
+
+DxcArtifact::DxcArtifact(std::shared_ptr<const std::vector<std::byte>> buffer) noexcept
+    : mSinkType(DxcSinkType::MemoryBuffer)
+    , mStorage(std::move(buffer))
 {}
 
 DxcArtifact::~DxcArtifact() noexcept = default;
 
 DxcArtifact& DxcArtifact::operator=(DxcArtifact&&) noexcept = default;
 
+std::span<const std::byte> DxcArtifact::data() const noexcept
+{
+    return std::visit(Overloaded{[](const std::vector<std::byte>& buffer)
+                                 { return std::span<const std::byte>(buffer); },
+                                 [](const ComPtr<IDxcBlob>& blob)
+                                 {
+                                     if(blob == nullptr) { return std::span<const std::byte>(); }
+
+                                     return std::span<const std::byte>(
+                                         static_cast<const std::byte*>(blob->GetBufferPointer()),
+                                         blob->GetBufferSize());
+                                 },
+                                 [](const std::shared_ptr<const std::vector<std::byte>>& buffer)
+                                 {
+                                     if(buffer == nullptr) { return std::span<const std::byte>(); }
+
+                                     return std::span<const std::byte>(*buffer);
+                                 }},
+                      mStorage);
+}
+
 namespace detail
 {
 [[nodiscard]] DxcTargetProfile parseTargetProfile(std::string_view targetProfileStr)
@@ -244,129 +291,387 @@ const DxcArtifact& BaseDxcCompiler::getArtifact(DxcArtifactType type) const noex
     return mArtifacts[(size_t)type];
 }
 
-void BaseDxcCompiler::reset() noexcept
+BaseDxcCompiler::~BaseDxcCompiler() noexcept = default;
+
+tl::expected<CompileSummary, std::errc> BaseDxcCompiler::compileFromFile(const std::filesystem::path& shaderFilePath)
 {
-    mEntryPoint.clear();
-    mShaderFilePath.clear();
-    mCompilerMessages.clear();
+    if(mCancellationToken.stop_requested()) { return tl::make_unexpected(std::errc::operation_canceled); }
 
-    forEachEnum<DxcArtifactType>(mArtifacts, [&](DxcArtifactType /*type*/, DxcArtifact& artifact) { artifact = {}; });
+    if(mDependencyGraph == nullptr) { return compileFileWithCaches(shaderFilePath); }
+
+    // compiling may append to the arguments, the dependencies are recorded under the arguments the caller gave
+    const std::vector<std::wstring> recordedArguments(arguments().begin(), arguments().end());
+
+    // The dependencies are read before the compiler runs and recorded with the contents read here, a file saved during
+    // the compile then leaves it stale instead of being recorded as up to date.
+    const std::optional<std::vector<std::byte>> sourceContents = readFileContents(shaderFilePath);
+    std::optional<std::vector<DxcFileDependency>> scannedDependencies;
+
+    if(sourceContents)
+    {
+        scannedDependencies = scanIncludeDependencies(sourceContents.value(), shaderFilePath, recordedArguments);
+    }
+
+    mIncludedFiles.clear();
+    mIncludedFilesRecorded = false;
+
+    tl::expected<CompileSummary, std::errc> summary = compileFileWithCaches(shaderFilePath);
+
+    if(!summary || summary->returnCode != 0) { return summary; }
+
+    if(!sourceContents)
+    {
+        mDependencyGraph->removeCompile(shaderFilePath, recordedArguments);
+        return summary;
+    }
+
+    const DxcFileDependency sourceFile{.path = shaderFilePath,
+                                       .contentHash = DxcDependencyGraph::hashContents(sourceContents.value())};
+    recordDependencies(shaderFilePath, recordedArguments, sourceFile, scannedDependencies);
+
+    return summary;
 }
 
-DxcArtifact& BaseDxcCompiler::accessArtifact(DxcArtifactType type) noexcept
+tl::expected<CompileSummary, std::errc> BaseDxcCompiler::compileFromBuffer(std::span<const std::byte> shaderSource,
+                                                                           std::string_view shaderSourceName)
 {
-    if(type >= DxcArtifactType::_count)
+    const std::wstring wideSourceName = utf8Decode(shaderSourceName);
+    return compileFromBuffer(shaderSource, std::wstring_view(wideSourceName));
+}
+
+tl::expected<CompileSummary, std::errc> BaseDxcCompiler::compileFromBuffer(std::span<const std::byte> shaderSource,
+                                                                           std::wstring_view shaderSourceName)
+{
+    if(mCancellationToken.stop_requested()) { return tl::make_unexpected(std::errc::operation_canceled); }
+
+    if(mDependencyGraph == nullptr) { return compileBufferWithCaches(shaderSource, shaderSourceName); }
+
+    const std::vector<std::wstring> recordedArguments(arguments().begin(), arguments().end());
+    const std::filesystem::path sourcePath(shaderSourceName);
+
+    const std::optional<std::vector<DxcFileDependency>> scannedDependencies =
+        scanIncludeDependencies(shaderSource, sourcePath, recordedArguments);
+
+    mIncludedFiles.clear();
+    mIncludedFilesRecorded = false;
+
+    tl::expected<CompileSummary, std::errc> summary = compileBufferWithCaches(shaderSource, shaderSourceName);
+
+    if(summary && summary->returnCode == 0)
     {
-        static DxcArtifact kEmptyArtifact{};
-        return kEmptyArtifact;
+        recordDependencies(sourcePath, recordedArguments, std::nullopt, scannedDependencies);
     }
 
-    return mArtifacts[(size_t)type];
+    return summary;
 }
 
-bool BaseDxcCompiler::shouldOutputArtifact(DxcArtifactType type) const
+void BaseDxcCompiler::setArtifactCache(std::shared_ptr<DxcArtifactCache> artifactCache) noexcept
 {
-    return getArtifact(type).sinkType() != DxcSinkType::None;
+    mArtifactCache = std::move(artifactCache);
 }
 
-[[nodiscard]] bool startsWithWhiteSpace(std::string_view str)
+void BaseDxcCompiler::setCompileCache(std::shared_ptr<DxcCompileCache> compileCache) noexcept
 {
-    if(str.empty()) { return false; }
+    mCompileCache = std::move(compileCache);
+}
 
-    return std::isblank(str.front());
+void BaseDxcCompiler::setSingleFlight(std::shared_ptr<DxcSingleFlight> singleFlight) noexcept
+{
+    mSingleFlight = std::move(singleFlight);
 }
 
-struct FindNewlineResult
+void BaseDxcCompiler::setDependencyGraph(std::shared_ptr<DxcDependencyGraph> dependencyGraph) noexcept
 {
-    size_t pos = std::string_view::npos;
-    size_t newlineCharCount = 0;
-};
+    mDependencyGraph = std::move(dependencyGraph);
+}
 
-[[nodiscard]] FindNewlineResult findNewline(std::string_view str, size_t offset = 0u)
+tl::expected<CompileSummary, std::errc>
+BaseDxcCompiler::compileFileWithCaches(const std::filesystem::path& shaderFilePath)
 {
-    FindNewlineResult result;
-    result.pos = str.find_first_of("\r\n", offset);
+    if(!hasCache()) { return compileFromFileImpl(shaderFilePath); }
 
-    if(result.pos == std::string_view::npos) { return result; }
+    // the key covers the source contents, a file that cannot be read here is left for the compiler to report
+    std::optional<std::vector<std::byte>> source = readFileContents(shaderFilePath);
 
-    if(str[result.pos] == '\r' && (result.pos + 1) < str.size() && str[result.pos + 1] == '\n')
-    {
-        result.newlineCharCount = 2;
-    }
-    else { result.newlineCharCount = 1; }
+    if(!source) { return compileFromFileImpl(shaderFilePath); }
 
-    return result;
+    return compileWithCaches(source.value(), shaderFilePath, [&]() { return compileFromFileImpl(shaderFilePath); });
 }
 
-std::string_view trimNewlines(std::string_view str)
+tl::expected<CompileSummary, std::errc>
+BaseDxcCompiler::compileBufferWithCaches(std::span<const std::byte> shaderSource, std::wstring_view shaderSourceName)
 {
-    while(!str.empty() && (str.ends_with('\r') || str.ends_with('\n')))
-    {
-        str = str.substr(0, str.size() - 1);
-    }
+    if(!hasCache()) { return compileFromBufferImpl(shaderSource, shaderSourceName); }
 
-    return str;
+    return compileWithCaches(shaderSource,
+                             std::filesystem::path(shaderSourceName),
+                             [&]() { return compileFromBufferImpl(shaderSource, shaderSourceName); });
 }
 
-[[nodiscard]] std::optional<size_t> findSectionBreak(std::string_view str, size_t offset)
+std::optional<std::vector<DxcFileDependency>>
+BaseDxcCompiler::scanIncludeDependencies(std::span<const std::byte> source,
+                                         const std::filesystem::path& sourcePath,
+                                         std::span<const std::wstring> arguments)
 {
-    const size_t sectionBreakStart = str.find(": ", offset);
+    std::vector<std::wstring> normalizedArguments;
+    std::vector<std::filesystem::path> includeDirectories;
+    normalizeCompileArguments(arguments, normalizedArguments, includeDirectories);
+
+    std::vector<DxcFileDependency> dependencies;
+
+    const tl::expected<void, std::errc> result = collectIncludeDependencies(
+        source, sourcePath, includeDirectories, mDependencyGraph->includeCache(), dependencies);
 
-    if(sectionBreakStart == std::string_view::npos) { return std::nullopt; }
+    if(!result) { return std::nullopt; }
 
-    return sectionBreakStart;
+    return dependencies;
 }
 
-void splitAllMessages(std::string_view str, std::vector<CompilerMessage>& compilerMessages)
+void BaseDxcCompiler::recordDependencies(const std::filesystem::path& sourcePath,
+                                         std::span<const std::wstring> arguments,
+                                         const std::optional<DxcFileDependency>& sourceFile,
+                                         const std::optional<std::vector<DxcFileDependency>>& scannedDependencies)
 {
-    size_t messageStartOffset = 0;
-    size_t searchOffset = 0;
+    std::vector<DxcFileDependency> dependencies;
 
-    while(searchOffset < str.size())
+    if(sourceFile) { dependencies.push_back(sourceFile.value()); }
+
+    if(mIncludedFilesRecorded)
+    {
+        dependencies.insert(dependencies.end(), mIncludedFiles.begin(), mIncludedFiles.end());
+    }
+    else if(scannedDependencies)
     {
-        const FindNewlineResult findNewlineResult = findNewline(str, searchOffset);
+        dependencies.insert(dependencies.end(), scannedDependencies->begin(), scannedDependencies->end());
+    }
+    else
+    {
+        // a compile with unknown dependencies is left out rather than recorded as up to date
+        mDependencyGraph->removeCompile(sourcePath, arguments);
+        return;
+    }
+
+    mDependencyGraph->recordCompile(sourcePath, arguments, dependencies);
+}
+
+template<class CompileF>
+tl::expected<CompileSummary, std::errc> BaseDxcCompiler::compileWithCaches(std::span<const std::byte> source,
+                                                                           const std::filesystem::path& sourcePath,
+                                                                           CompileF compile)
+{
+    std::array<DxcArtifactType, (size_t)DxcArtifactType::_count> artifactTypes;
+    size_t artifactTypeCount = 0;
 
-        if(findNewlineResult.pos == std::string_view::npos)
+    forEachEnum<DxcArtifactType>(
+        [&](DxcArtifactType type)
         {
-            if(searchOffset > messageStartOffset)
+            if(shouldOutputArtifact(type)) { artifactTypes[artifactTypeCount++] = type; }
+        });
+
+    const std::span<const DxcArtifactType> requestedArtifactTypes =
+        std::span<const DxcArtifactType>(artifactTypes).first(artifactTypeCount);
+
+    // the caches and the single flight derive the same key, it is computed once
+    tl::expected<DxcCompileKey, std::errc> key = tl::make_unexpected(std::errc::invalid_argument);
+
+    if(mArtifactCache != nullptr)
+    {
+        key = mArtifactCache->computeKey(source, sourcePath, arguments(), mCompilerVersion, requestedArtifactTypes);
+    }
+    else if(mCompileCache != nullptr)
+    {
+        key = mCompileCache->computeKey(source, sourcePath, arguments(), mCompilerVersion, requestedArtifactTypes);
+    }
+    else
+    {
+        key = mSingleFlight->computeKey(source, sourcePath, arguments(), mCompilerVersion, requestedArtifactTypes);
+    }
+
+    if(!key) { return compile(); }
+
+    CompileSummary cachedSummary;
+
+    if(mArtifactCache != nullptr)
+    {
+        const DxcArtifactCache::Entry entry = mArtifactCache->find(key.value());
+
+        if(entry != nullptr && restoreCacheEntry(entry, requestedArtifactTypes, cachedSummary))
+        {
+            return cachedSummary;
+        }
+    }
+
+    if(mCompileCache != nullptr)
+    {
+        std::optional<DxcCompileCacheEntry> loadedEntry = mCompileCache->load(key.value());
+
+        if(loadedEntry)
+        {
+            auto entry = std::make_shared<const DxcCompileCacheEntry>(std::move(loadedEntry.value()));
+
+            if(restoreCacheEntry(entry, requestedArtifactTypes, cachedSummary))
             {
-                CompilerMessage compilerMessage;
-                compilerMessage.fullMessage = str.substr(messageStartOffset, searchOffset - messageStartOffset - 1);
+                if(mArtifactCache != nullptr) { mArtifactCache->insert(key.value(), std::move(entry)); }
 
-                if(!compilerMessage.fullMessage.empty()) { compilerMessages.push_back(std::move(compilerMessage)); }
+                return cachedSummary;
+            }
+        }
+    }
+
+    bool leader = false;
+
+    if(mSingleFlight != nullptr)
+    {
+        const DxcSingleFlight::Ticket ticket = mSingleFlight->join(key.value());
+
+        leader = ticket.leader;
 
-                messageStartOffset = searchOffset;
+        if(!leader)
+        {
+            // the wait is sliced so that a cancelled compile does not wait for a result it no longer needs
+            while(ticket.result.wait_for(kSingleFlightPollInterval) != std::future_status::ready)
+            {
+                if(mCancellationToken.stop_requested()) { return tl::make_unexpected(std::errc::operation_canceled); }
             }
 
-            CompilerMessage compilerMessage;
-            compilerMessage.fullMessage = trimNewlines(str.substr(messageStartOffset));
+            // a leader that failed without a result leaves this compile to run on its own
+            const DxcSingleFlight::Entry entry = ticket.result.get();
 
-            if(!compilerMessage.fullMessage.empty()) { compilerMessages.push_back(std::move(compilerMessage)); }
+            if(entry != nullptr && restoreCacheEntry(entry, requestedArtifactTypes, cachedSummary))
+            {
+                return cachedSummary;
+            }
+        }
+    }
+
+    std::shared_ptr<const DxcCompileCacheEntry> newEntry;
+
+    // the waiting compiles are released on every path out of here
+    auto completeFlight = finally(
+        [&]()
+        {
+            if(leader) { mSingleFlight->complete(key.value(), newEntry); }
+        });
+
+    tl::expected<CompileSummary, std::errc> summary = compile();
+
+    // the compiles in flight with this one may have other limits, they run on their own
+    if(!summary || summary->termination != CompileTermination::Exited) { return summary; }
+
+    // failures are not stored, they may come from the environment rather than from the shader, but the compiles in
+    // flight with this one would fail the same way
+    if(summary->returnCode != 0)
+    {
+        if(leader) { newEntry = createCacheEntry(summary.value(), requestedArtifactTypes); }
+
+        return summary;
+    }
+
+    newEntry = createCacheEntry(summary.value(), requestedArtifactTypes);
+
+    if(mCompileCache != nullptr) { mCompileCache->store(key.value(), *newEntry); }
 
-            return;
+    if(mArtifactCache != nullptr) { mArtifactCache->insert(key.value(), newEntry); }
+
+    return summary;
+}
+
+std::shared_ptr<const DxcCompileCacheEntry>
+BaseDxcCompiler::createCacheEntry(const CompileSummary& summary, std::span<const DxcArtifactType> artifactTypes) const
+{
+    auto entry = std::make_shared<DxcCompileCacheEntry>();
+    entry->returnCode = summary.returnCode;
+    entry->messages = summary.messages;
+
+    for(const DxcArtifactType type : artifactTypes)
+    {
+        const DxcArtifact& artifact = getArtifact(type);
+
+        if(artifact.sinkType() == DxcSinkType::MemoryBuffer)
+        {
+            const std::span<const std::byte> contents = artifact.data();
+
+            if(!contents.empty()) { entry->artifacts[(size_t)type].emplace(contents.begin(), contents.end()); }
         }
+        else if(artifact.sinkType() == DxcSinkType::File)
+        {
+            entry->artifacts[(size_t)type] = readFileContents(artifact.path());
+        }
+    }
 
-        std::string_view lineStr =
-            str.substr(searchOffset, (findNewlineResult.pos - searchOffset) + findNewlineResult.newlineCharCount);
+    return entry;
+}
+
+bool BaseDxcCompiler::restoreCacheEntry(const std::shared_ptr<const DxcCompileCacheEntry>& entry,
+                                        std::span<const DxcArtifactType> artifactTypes,
+                                        CompileSummary& summary)
+{
+    for(const DxcArtifactType type : artifactTypes)
+    {
+        const std::optional<std::vector<std::byte>>& contents = entry->artifacts[(size_t)type];
+        DxcArtifact& artifact = accessArtifact(type);
+
+        if(!contents) { continue; }
 
-        if(messageStartOffset == searchOffset || startsWithWhiteSpace(lineStr))
+        if(artifact.sinkType() == DxcSinkType::MemoryBuffer)
+        {
+            // the buffer keeps the whole entry alive, which is never modified once it is shared
+            artifact = DxcArtifact(std::shared_ptr<const std::vector<std::byte>>(entry, &contents.value()));
+        }
+        else if(artifact.sinkType() == DxcSinkType::File)
         {
-            searchOffset += lineStr.size();
-            continue;
+            std::ofstream artifactStream(artifact.path(), std::ios_base::out | std::ios_base::binary);
+            artifactStream.write(reinterpret_cast<const char*>(contents->data()), (std::streamsize)contents->size());
+
+            if(!artifactStream) { return false; }
         }
+    }
 
-        CompilerMessage compilerMessage;
-        compilerMessage.fullMessage = trimNewlines(str.substr(messageStartOffset, searchOffset - messageStartOffset));
+    // the entry may have been stored by a compiler that retains more messages than this one
+    mCompilerMessages = entry->messages.first(mMaxMessageCount);
 
-        if(!compilerMessage.fullMessage.empty()) { compilerMessages.push_back(std::move(compilerMessage)); }
+    summary.returnCode = entry->returnCode;
+    summary.arguments = arguments();
+    summary.messages = mCompilerMessages;
+    summary.errorCount = (int)mCompilerMessages.count(CompilerMessageType::Error);
+    summary.warningCount = (int)mCompilerMessages.count(CompilerMessageType::Warning);
 
-        messageStartOffset = searchOffset;
-        searchOffset += lineStr.size();
+    return true;
+}
+
+DxcArtifact BaseDxcCompiler::takeArtifact(DxcArtifactType type) noexcept
+{
+    return std::exchange(accessArtifact(type), DxcArtifact());
+}
+
+void BaseDxcCompiler::reset() noexcept
+{
+    mEntryPoint.clear();
+    mShaderFilePath.clear();
+    mCompilerMessages = {};
+    mIncludedFiles.clear();
+    mIncludedFilesRecorded = false;
+
+    forEachEnum<DxcArtifactType>(mArtifacts, [&](DxcArtifactType /*type*/, DxcArtifact& artifact) { artifact = {}; });
+}
+
+DxcArtifact& BaseDxcCompiler::accessArtifact(DxcArtifactType type) noexcept
+{
+    if(type >= DxcArtifactType::_count)
+    {
+        static DxcArtifact kEmptyArtifact{};
+        return kEmptyArtifact;
     }
+
+    return mArtifacts[(size_t)type];
+}
+
+bool BaseDxcCompiler::shouldOutputArtifact(DxcArtifactType type) const
+{
+    return getArtifact(type).sinkType() != DxcSinkType::None;
 }
 
-void BaseDxcCompiler::parseCompilerMessages(std::string_view compilerOutput,
-                                            std::vector<CompilerMessage>& compilerMessages)
+CompilerMessages BaseDxcCompiler::parseCompilerMessages(std::string_view compilerOutput, size_t maxMessageCount)
 {
     // Example output:
     // C:\Users\test\error.hlsl:17:25: warning: implicit truncation of vector type [-Wconversion]
@@ -391,110 +696,25 @@ void BaseDxcCompiler::parseCompilerMessages(std::string_view compilerOutput,
     //   type section - message type (i.e. warning, error)
     //   detail section - any text further clarifying and detailing the error or warning
 
-    splitAllMessages(compilerOutput, compilerMessages);
-
-    for(CompilerMessage& compilerMessage : compilerMessages)
-    {
-        // check
-        const size_t sectionBreakOffset = compilerMessage.fullMessage.find(": ");
-
-        if(sectionBreakOffset == std::string_view::npos) { continue; }
-
-        size_t messageTypeOffset = 0;
-
-        if(std::isdigit(compilerMessage.fullMessage[sectionBreakOffset - 1]))
-        {
-            // If there is a digit to left of the first section break, then this message is one of two forms
-            // A: <path>:<line>:<column>: <type>: <message>
-            // or
-            // B: <path>:<line>: <type>: <message>
-
-            const ptrdiff_t lineOrColumnNumberOffset = (ptrdiff_t)compilerMessage.fullMessage.rfind(':', sectionBreakOffset - 1);
-
-            if(lineOrColumnNumberOffset == std::string::npos)
-            {
-                // This is an unknown message format. Expecting there to be at least one colon preceding the
-                // section break.
-                continue;
-            }
-
-            messageTypeOffset = sectionBreakOffset + 2;
-
-            int lineOrColumn;
+    // the spans are 32 bit offsets
+    compilerOutput = compilerOutput.substr(0, std::numeric_limits<uint32_t>::max());
 
-            std::string_view lineOrColumnStr =
-                std::string_view(compilerMessage.fullMessage)
-                    .substr(lineOrColumnNumberOffset + 1, sectionBreakOffset - lineOrColumnNumberOffset - 1);
+    // the messages are views into the builder's copy of the output
+    CompilerMessages::Builder builder{std::string(compilerOutput), maxMessageCount};
 
-            const std::from_chars_result lineOrColumnParseResult =
-                std::from_chars(lineOrColumnStr.data(), lineOrColumnStr.data() + lineOrColumnStr.size(), lineOrColumn);
+    // reused by every compile of the thread
+    thread_local DiagnosticSpans spans;
+    scanDiagnostics(builder.text(), spans);
 
-            if(lineOrColumnParseResult.ec != std::errc{})
-            {
-                // expected a number
-                continue;
-            }
-
-            if(std::isdigit(compilerMessage.fullMessage[lineOrColumnNumberOffset - 1]))
-            {
-                // message contains line and column numbers
-                compilerMessage.column = lineOrColumn;
-
-                const ptrdiff_t lineNumberOffset = (ptrdiff_t)compilerMessage.fullMessage.rfind(":", lineOrColumnNumberOffset - 1);
-
-                if(lineNumberOffset == std::string::npos)
-                {
-                    // expected another colon
-                    continue;
-                }
-
-                std::string_view lineStr =
-                    std::string_view(compilerMessage.fullMessage)
-                        .substr(lineNumberOffset + 1, lineOrColumnNumberOffset - lineNumberOffset - 1);
-
-                const std::from_chars_result lineParseResult =
-                    std::from_chars(lineStr.data(), lineStr.data() + lineStr.size(), compilerMessage.line);
-
-                if(lineParseResult.ec != std::errc{})
-                {
-                    // expected a number
-                    continue;
-                }
-
-                compilerMessage.filePathOffset = 0;
-                compilerMessage.filePathCount = (int)lineNumberOffset;
-            }
-            else
-            {
-                // message contains just a line number
-                compilerMessage.line = lineOrColumn;
-                compilerMessage.filePathOffset = 0;
-                compilerMessage.filePathCount = (int)lineOrColumnNumberOffset;
-            }
-        }
-
-        // parse message type
-        const std::optional<size_t> sectionBreakResult =
-            findSectionBreak(compilerMessage.fullMessage, messageTypeOffset);
-
-        if(!sectionBreakResult) { continue; }
-
-        std::string_view messageTypeStr =
-            std::string_view(compilerMessage.fullMessage)
-                .substr(messageTypeOffset, sectionBreakResult.value() - messageTypeOffset);
-
-        if(caseInsensitiveEqual(messageTypeStr, "warning")) { compilerMessage.type = CompilerMessageType::Warning; }
-        else if(caseInsensitiveEqual(messageTypeStr, "error")) { compilerMessage.type = CompilerMessageType::Error; }
-
-        if(sectionBreakResult.value() + 2 >= compilerMessage.fullMessage.size())
-        {
-            // there is not enough room for a message
-            continue;
-        }
+    for(size_t messageIndex = 0; messageIndex < spans.size(); ++messageIndex)
+    {
+        const std::string_view fullMessage =
+            builder.text().substr(spans.messageOffsets[messageIndex], spans.messageSizes[messageIndex]);
 
-        compilerMessage.messageOffset = (int)std::min(sectionBreakResult.value() + 2, compilerMessage.fullMessage.size());
-        compilerMessage.messageCount = int(std::ssize(compilerMessage.fullMessage) - compilerMessage.messageOffset);
+        builder.add(parseCompilerMessage(fullMessage, spans.colons(messageIndex)));
     }
+
+    return std::move(builder).build();
 }
 } // namespace detail
 } // namespace shadercompile
\ No newline at end of file
@@ -0,0 +1,529 @@
+#include "shadercompile/dxc_dependency_graph.h"
+
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <optional>
+#include <string_view>
+
+namespace shadercompile
+{
+namespace
+{
+constexpr std::array<std::byte, 8> kGraphMagic = {std::byte{'S'},
+                                                  std::byte{'C'},
+                                                  std::byte{'D'},
+                                                  std::byte{'E'},
+                                                  std::byte{'P'},
+                                                  std::byte{'S'},
+                                                  std::byte{'0'},
+                                                  std::byte{'1'}};
+
+// the content hash of a file that does not exist or cannot be read
+constexpr uint64_t kMissingContentHash = 0;
+
+// the smallest encodings of the entries of a saved graph: a path size followed by the write time, size and content
+// hash of a file, the source path size, argument count and dependency count of a compile, and a dependency's file
+// index and content hash
+constexpr size_t kMinEncodedFileSize = sizeof(uint32_t) + 3 * sizeof(uint64_t);
+constexpr size_t kMinEncodedCompileSize = 3 * sizeof(uint32_t);
+constexpr size_t kEncodedDependencySize = sizeof(uint32_t) + sizeof(uint64_t);
+
+[[nodiscard]] std::optional<std::filesystem::path> makeAbsolutePath(const std::filesystem::path& path)
+{
+    std::error_code errorCode;
+    std::filesystem::path absolutePath = std::filesystem::absolute(path, errorCode);
+
+    if(errorCode) { return std::nullopt; }
+
+    return absolutePath.lexically_normal();
+}
+} // namespace
+
+void DxcDependencyGraph::recordCompile(const std::filesystem::path& sourcePath,
+                                       std::span<const std::wstring> arguments,
+                                       std::span<const DxcFileDependency> dependencies)
+{
+    std::vector<std::filesystem::path> absolutePaths;
+    std::vector<uint64_t> readContentHashes;
+    absolutePaths.reserve(dependencies.size());
+    readContentHashes.reserve(dependencies.size());
+
+    // a file read twice keeps the contents of its first read
+    for(const DxcFileDependency& dependency : dependencies)
+    {
+        std::optional<std::filesystem::path> absolutePath = makeAbsolutePath(dependency.path);
+
+        if(absolutePath && std::find(absolutePaths.begin(), absolutePaths.end(), absolutePath) == absolutePaths.end())
+        {
+            absolutePaths.push_back(std::move(absolutePath.value()));
+            readContentHashes.push_back(dependency.contentHash);
+        }
+    }
+
+    std::vector<std::optional<FileState>> knownStates(absolutePaths.size());
+
+    {
+        std::lock_guard lock(mMutex);
+
+        for(size_t index = 0; index < absolutePaths.size(); ++index)
+        {
+            auto itr = mFileIndices.find(absolutePaths[index].native());
+            if(itr != mFileIndices.end()) { knownStates[index] = mFiles[itr->second].state; }
+        }
+    }
+
+    // The files are read without holding the lock, so compiles on other threads can record at the same time. Their
+    // current state is kept for the files, the compile keeps the contents it read.
+    std::vector<FileState> states;
+    states.reserve(absolutePaths.size());
+
+    for(size_t index = 0; index < absolutePaths.size(); ++index)
+    {
+        const FileState* knownState = knownStates[index] ? &knownStates[index].value() : nullptr;
+        states.push_back(readFileState(absolutePaths[index], knownState));
+    }
+
+    CompileNode compileNode;
+    compileNode.compile.sourcePath = sourcePath;
+    compileNode.compile.arguments.assign(arguments.begin(), arguments.end());
+    compileNode.dependencies.reserve(absolutePaths.size());
+
+    std::lock_guard lock(mMutex);
+
+    for(size_t index = 0; index < absolutePaths.size(); ++index)
+    {
+        const uint32_t fileIndex = findOrAddFile(absolutePaths[index]);
+        mFiles[fileIndex].state = states[index];
+
+        compileNode.dependencies.push_back(Dependency{.fileIndex = fileIndex, .contentHash = readContentHashes[index]});
+    }
+
+    mCompiles.insert_or_assign(makeCompileKey(sourcePath, arguments), std::move(compileNode));
+}
+
+void DxcDependencyGraph::removeCompile(const std::filesystem::path& sourcePath, std::span<const std::wstring> arguments)
+{
+    std::lock_guard lock(mMutex);
+
+    // the file nodes are kept, they are few and other compiles are likely to depend on them again
+    mCompiles.erase(makeCompileKey(sourcePath, arguments));
+}
+
+bool DxcDependencyGraph::contains(const std::filesystem::path& sourcePath,
+                                  std::span<const std::wstring> arguments) const
+{
+    std::lock_guard lock(mMutex);
+
+    return mCompiles.contains(makeCompileKey(sourcePath, arguments));
+}
+
+std::vector<DxcRecordedCompile> DxcDependencyGraph::findStaleCompiles()
+{
+    std::vector<uint32_t> fileIndices;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        fileIndices.resize(mFiles.size());
+
+        for(uint32_t fileIndex = 0; fileIndex < (uint32_t)mFiles.size(); ++fileIndex)
+        {
+            fileIndices[fileIndex] = fileIndex;
+        }
+    }
+
+    return refreshFiles(std::move(fileIndices));
+}
+
+std::vector<DxcRecordedCompile>
+DxcDependencyGraph::findStaleCompiles(std::span<const std::filesystem::path> changedFiles)
+{
+    std::vector<uint32_t> fileIndices;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        for(const std::filesystem::path& changedFile : changedFiles)
+        {
+            const std::optional<std::filesystem::path> absolutePath = makeAbsolutePath(changedFile);
+
+            if(!absolutePath) { continue; }
+
+            // a file no compile has read cannot make anything stale
+            auto itr = mFileIndices.find(absolutePath->native());
+            if(itr != mFileIndices.end()) { fileIndices.push_back(itr->second); }
+        }
+    }
+
+    return refreshFiles(std::move(fileIndices));
+}
+
+std::vector<std::filesystem::path> DxcDependencyGraph::dependencies(const std::filesystem::path& sourcePath,
+                                                                    std::span<const std::wstring> arguments) const
+{
+    std::lock_guard lock(mMutex);
+
+    std::vector<std::filesystem::path> paths;
+
+    auto itr = mCompiles.find(makeCompileKey(sourcePath, arguments));
+
+    if(itr == mCompiles.end()) { return paths; }
+
+    paths.reserve(itr->second.dependencies.size());
+
+    for(const Dependency& dependency : itr->second.dependencies)
+    {
+        paths.push_back(mFiles[dependency.fileIndex].path);
+    }
+
+    return paths;
+}
+
+std::vector<std::filesystem::path> DxcDependencyGraph::files() const
+{
+    std::lock_guard lock(mMutex);
+
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(mFiles.size());
+
+    for(const FileNode& file : mFiles)
+    {
+        paths.push_back(file.path);
+    }
+
+    return paths;
+}
+
+tl::expected<void, std::errc> DxcDependencyGraph::save(const std::filesystem::path& path) const
+{
+    std::vector<std::byte> frame;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        detail::FrameWriter writer(frame);
+        writer.writeU32((uint32_t)mFiles.size());
+
+        for(const FileNode& file : mFiles)
+        {
+            writer.writeString(utf8Encode(file.path.wstring()));
+            writer.writeU64((uint64_t)file.state.lastWriteTime.time_since_epoch().count());
+            writer.writeU64((uint64_t)file.state.size);
+            writer.writeU64(file.state.contentHash);
+        }
+
+        writer.writeU32((uint32_t)mCompiles.size());
+
+        for(const auto& [key, compileNode] : mCompiles)
+        {
+            writer.writeString(utf8Encode(compileNode.compile.sourcePath.wstring()));
+            writer.writeU32((uint32_t)compileNode.compile.arguments.size());
+
+            for(const std::wstring& argument : compileNode.compile.arguments)
+            {
+                writer.writeString(utf8Encode(argument));
+            }
+
+            writer.writeU32((uint32_t)compileNode.dependencies.size());
+
+            for(const Dependency& dependency : compileNode.dependencies)
+            {
+                writer.writeU32(dependency.fileIndex);
+                writer.writeU64(dependency.contentHash);
+            }
+        }
+
+        writer.finish();
+    }
+
+    // written next to the graph and renamed over it, so a crash never leaves a partially written graph behind
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+        std::ofstream fileStream(temporaryPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+        if(!fileStream.is_open()) { return tl::make_unexpected(std::errc::io_error); }
+
+        fileStream.write(reinterpret_cast<const char*>(kGraphMagic.data()), kGraphMagic.size());
+        fileStream.write(reinterpret_cast<const char*>(frame.data()), (std::streamsize)frame.size());
+        fileStream.close();
+
+        if(!fileStream) { return tl::make_unexpected(std::errc::io_error); }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(temporaryPath, path, errorCode);
+
+    if(errorCode)
+    {
+        std::filesystem::remove(temporaryPath, errorCode);
+        return tl::make_unexpected(std::errc::io_error);
+    }
+
+    return {};
+}
+
+tl::expected<void, std::errc> DxcDependencyGraph::load(const std::filesystem::path& path)
+{
+    std::optional<std::vector<std::byte>> contents = readFileContents(path);
+
+    if(!contents) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+    constexpr size_t kHeaderSize = kGraphMagic.size() + sizeof(uint32_t);
+
+    if(contents->size() < kHeaderSize || !std::equal(kGraphMagic.begin(), kGraphMagic.end(), contents->begin()))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    const std::span<const std::byte> frame = std::span<const std::byte>(contents.value()).subspan(kGraphMagic.size());
+    const std::optional<uint32_t> payloadSize = detail::decodeFrameSize(frame.first<4>());
+
+    if(!payloadSize || payloadSize.value() != frame.size() - sizeof(uint32_t))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    detail::FrameReader reader(frame.subspan(sizeof(uint32_t)));
+
+    std::vector<FileNode> files;
+    std::unordered_map<std::filesystem::path::string_type, uint32_t> fileIndices;
+    std::unordered_map<uint64_t, CompileNode> compiles;
+
+    uint32_t fileCount;
+    if(!reader.readU32(fileCount) || !reader.canHold(fileCount, kMinEncodedFileSize))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    for(uint32_t fileIndex = 0; fileIndex < fileCount; ++fileIndex)
+    {
+        std::string filePath;
+        uint64_t lastWriteTime;
+        uint64_t size;
+        uint64_t contentHash;
+
+        if(!reader.readString(filePath) || !reader.readU64(lastWriteTime) || !reader.readU64(size) ||
+           !reader.readU64(contentHash))
+        {
+            return tl::make_unexpected(std::errc::bad_message);
+        }
+
+        FileNode& file = files.emplace_back();
+        file.path = std::filesystem::path(utf8Decode(filePath));
+        file.state.lastWriteTime = std::filesystem::file_time_type(
+            std::filesystem::file_time_type::duration((std::filesystem::file_time_type::rep)lastWriteTime));
+        file.state.size = (uintmax_t)size;
+        file.state.contentHash = contentHash;
+
+        fileIndices.insert_or_assign(file.path.native(), fileIndex);
+    }
+
+    uint32_t compileCount;
+    if(!reader.readU32(compileCount) || !reader.canHold(compileCount, kMinEncodedCompileSize))
+    {
+        return tl::make_unexpected(std::errc::bad_message);
+    }
+
+    for(uint32_t compileIndex = 0; compileIndex < compileCount; ++compileIndex)
+    {
+        CompileNode compileNode;
+
+        std::string sourcePath;
+        uint32_t argumentCount;
+        if(!reader.readString(sourcePath) || !reader.readU32(argumentCount) ||
+           !reader.canHold(argumentCount, sizeof(uint32_t)))
+        {
+            return tl::make_unexpected(std::errc::bad_message);
+        }
+
+        compileNode.compile.sourcePath = std::filesystem::path(utf8Decode(sourcePath));
+
+        for(uint32_t argumentIndex = 0; argumentIndex < argumentCount; ++argumentIndex)
+        {
+            std::string argument;
+            if(!reader.readString(argument)) { return tl::make_unexpected(std::errc::bad_message); }
+
+            compileNode.compile.arguments.push_back(utf8Decode(argument));
+        }
+
+        uint32_t dependencyCount;
+        if(!reader.readU32(dependencyCount) || !reader.canHold(dependencyCount, kEncodedDependencySize))
+        {
+            return tl::make_unexpected(std::errc::bad_message);
+        }
+
+        for(uint32_t dependencyIndex = 0; dependencyIndex < dependencyCount; ++dependencyIndex)
+        {
+            Dependency dependency;
+
+            if(!reader.readU32(dependency.fileIndex) || !reader.readU64(dependency.contentHash) ||
+               dependency.fileIndex >= fileCount)
+            {
+                return tl::make_unexpected(std::errc::bad_message);
+            }
+
+            compileNode.dependencies.push_back(dependency);
+        }
+
+        const uint64_t key = makeCompileKey(compileNode.compile.sourcePath, compileNode.compile.arguments);
+        compiles.insert_or_assign(key, std::move(compileNode));
+    }
+
+    if(!reader.atEnd()) { return tl::make_unexpected(std::errc::bad_message); }
+
+    std::lock_guard lock(mMutex);
+
+    mFiles = std::move(files);
+    mFileIndices = std::move(fileIndices);
+    mCompiles = std::move(compiles);
+
+    return {};
+}
+
+void DxcDependencyGraph::clear()
+{
+    std::lock_guard lock(mMutex);
+
+    mFiles.clear();
+    mFileIndices.clear();
+    mCompiles.clear();
+}
+
+DxcDependencyGraphStatistics DxcDependencyGraph::statistics() const
+{
+    std::lock_guard lock(mMutex);
+
+    DxcDependencyGraphStatistics statistics;
+    statistics.compileCount = mCompiles.size();
+    statistics.fileCount = mFiles.size();
+
+    for(const auto& [key, compileNode] : mCompiles)
+    {
+        statistics.dependencyCount += compileNode.dependencies.size();
+    }
+
+    return statistics;
+}
+
+uint64_t DxcDependencyGraph::makeCompileKey(const std::filesystem::path& sourcePath,
+                                            std::span<const std::wstring> arguments)
+{
+    constexpr std::string_view kTerminator("\0", 1);
+
+    Fnv1aHash hash;
+    hash.update(utf8Encode(sourcePath.wstring()));
+    hash.update(kTerminator);
+
+    for(const std::wstring& argument : arguments)
+    {
+        hash.update(utf8Encode(argument));
+        hash.update(kTerminator);
+    }
+
+    return hash.value();
+}
+
+DxcDependencyGraph::FileState DxcDependencyGraph::readFileState(const std::filesystem::path& path,
+                                                                const FileState* known)
+{
+    FileState state;
+    state.contentHash = kMissingContentHash;
+
+    std::error_code errorCode;
+    state.lastWriteTime = std::filesystem::last_write_time(path, errorCode);
+
+    if(errorCode) { return state; }
+
+    state.size = std::filesystem::file_size(path, errorCode);
+
+    if(errorCode) { return state; }
+
+    if(known != nullptr && known->contentHash != kMissingContentHash && known->lastWriteTime == state.lastWriteTime &&
+       known->size == state.size)
+    {
+        return *known;
+    }
+
+    const std::optional<std::vector<std::byte>> contents = readFileContents(path);
+
+    if(!contents) { return state; }
+
+    state.contentHash = hashContents(contents.value());
+
+    return state;
+}
+
+uint64_t DxcDependencyGraph::hashContents(std::span<const std::byte> contents) noexcept
+{
+    Fnv1aHash hash;
+    hash.update(contents);
+
+    return hash.value();
+}
+
+uint32_t DxcDependencyGraph::findOrAddFile(const std::filesystem::path& absolutePath)
+{
+    auto [itr, inserted] = mFileIndices.try_emplace(absolutePath.native(), (uint32_t)mFiles.size());
+
+    if(inserted) { mFiles.push_back(FileNode{.path = absolutePath, .state = {}}); }
+
+    return itr->second;
+}
+
+std::vector<DxcRecordedCompile> DxcDependencyGraph::refreshFiles(std::vector<uint32_t> fileIndices)
+{
+    std::vector<std::pair<std::filesystem::path, FileState>> knownFiles;
+    knownFiles.reserve(fileIndices.size());
+
+    {
+        std::lock_guard lock(mMutex);
+
+        for(const uint32_t fileIndex : fileIndices)
+        {
+            knownFiles.emplace_back(mFiles[fileIndex].path, mFiles[fileIndex].state);
+        }
+    }
+
+    std::vector<FileState> states;
+    states.reserve(knownFiles.size());
+
+    for(const auto& [path, knownState] : knownFiles)
+    {
+        states.push_back(readFileState(path, &knownState));
+    }
+
+    std::lock_guard lock(mMutex);
+
+    for(size_t index = 0; index < fileIndices.size(); ++index)
+    {
+        // a load() in the meantime may have replaced the files
+        if(fileIndices[index] < mFiles.size() && mFiles[fileIndices[index]].path == knownFiles[index].first)
+        {
+            mFiles[fileIndices[index]].state = states[index];
+        }
+    }
+
+    std::vector<DxcRecordedCompile> staleCompiles;
+
+    for(const auto& [key, compileNode] : mCompiles)
+    {
+        const bool stale = std::any_of(compileNode.dependencies.begin(),
+                                       compileNode.dependencies.end(),
+                                       [&](const Dependency& dependency)
+                                       {
+                                           return mFiles[dependency.fileIndex].state.contentHash !=
+                                                  dependency.contentHash;
+                                       });
+
+        if(stale) { staleCompiles.push_back(compileNode.compile); }
+    }
+
+    return staleCompiles;
+}
+} // namespace shadercompile
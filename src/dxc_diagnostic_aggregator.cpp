@@ -0,0 +1,221 @@
+#include "shadercompile/dxc_diagnostic_aggregator.h"
+
+#include "utility.h"
+
+#include <algorithm>
+
+namespace shadercompile
+{
+namespace
+{
+// the text that identifies a message besides its location and type
+[[nodiscard]] std::string_view messageText(const CompilerMessage& message)
+{
+    return message.hasMessage() ? message.message() : message.fullMessage;
+}
+
+[[nodiscard]] std::string_view messageFilePath(const CompilerMessage& message)
+{
+    return message.hasFilePath() ? message.filePath() : std::string_view();
+}
+} // namespace
+
+void DxcDiagnosticAggregator::add(DxcVariantId variant, const CompilerMessage& message)
+{
+    ++mMessageCount;
+
+    const std::string_view filePath = messageFilePath(message);
+    const std::string_view text = messageText(message);
+
+    Fnv1aHash hash;
+    hash.update(filePath);
+    hash.update(std::as_bytes(std::span<const int>(&message.line, 1)));
+    hash.update(std::as_bytes(std::span<const int>(&message.column, 1)));
+    hash.update(std::as_bytes(std::span<const CompilerMessageType>(&message.type, 1)));
+    hash.update(text);
+
+    const auto [hashItr, inserted] = mDiagnosticsByHash.try_emplace(hash.value(), (uint32_t)mDiagnostics.size());
+
+    if(!inserted)
+    {
+        // a hash match has to be confirmed, the hash is not collision resistant
+        uint32_t diagnosticIndex = hashItr->second;
+
+        for(;;)
+        {
+            Diagnostic& diagnostic = mDiagnostics[diagnosticIndex];
+
+            if(matches(diagnostic, filePath, message, text))
+            {
+                addVariant(diagnostic, variant);
+                return;
+            }
+
+            if(diagnostic.nextWithSameHash == kNoDiagnostic)
+            {
+                diagnostic.nextWithSameHash = (uint32_t)mDiagnostics.size();
+                break;
+            }
+
+            diagnosticIndex = diagnostic.nextWithSameHash;
+        }
+    }
+
+    const uint32_t diagnosticIndex = (uint32_t)mDiagnostics.size();
+
+    Diagnostic& diagnostic = mDiagnostics.emplace_back();
+    diagnostic.line = message.line;
+    diagnostic.column = message.column;
+    diagnostic.type = message.type;
+    diagnostic.textOffset = mText.size();
+    diagnostic.textSize = text.size();
+
+    mText.append(text);
+
+    if(message.hasFilePath())
+    {
+        diagnostic.filePathIndex = findOrAddFilePath(filePath);
+        mFilePaths[diagnostic.filePathIndex].diagnosticIndices.push_back(diagnosticIndex);
+    }
+
+    addVariant(diagnostic, variant);
+
+    if(diagnostic.type < CompilerMessageType::_count) { ++mTypeCounts[(size_t)diagnostic.type]; }
+}
+
+void DxcDiagnosticAggregator::add(DxcVariantId variant, const CompilerMessages& messages)
+{
+    for(const CompilerMessage& message : messages)
+    {
+        add(variant, message);
+    }
+}
+
+void DxcDiagnosticAggregator::add(const DxcPermutationResults& results)
+{
+    // ascending keys let the permutations that report a diagnostic merge into few ranges
+    std::vector<DxcPermutationKey> keys;
+    keys.reserve(results.size());
+
+    for(const auto& [key, result] : results)
+    {
+        if(result) { keys.push_back(key); }
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    for(const DxcPermutationKey key : keys)
+    {
+        add(key, results.at(key)->messages);
+    }
+}
+
+DxcAggregatedDiagnostic DxcDiagnosticAggregator::operator[](size_t index) const
+{
+    const Diagnostic& diagnostic = mDiagnostics[index];
+
+    DxcAggregatedDiagnostic aggregatedDiagnostic;
+    aggregatedDiagnostic.line = diagnostic.line;
+    aggregatedDiagnostic.column = diagnostic.column;
+    aggregatedDiagnostic.type = diagnostic.type;
+    aggregatedDiagnostic.text = std::string_view(mText).substr(diagnostic.textOffset, diagnostic.textSize);
+    aggregatedDiagnostic.variantCount = diagnostic.variantCount;
+    aggregatedDiagnostic.variants = diagnostic.variants;
+
+    if(diagnostic.filePathIndex != kNoFilePath)
+    {
+        aggregatedDiagnostic.filePath = mFilePaths[diagnostic.filePathIndex].path;
+    }
+
+    return aggregatedDiagnostic;
+}
+
+std::span<const uint32_t> DxcDiagnosticAggregator::diagnosticsInFile(std::string_view filePath) const
+{
+    const auto itr = mFilePathIndices.find(filePath);
+
+    if(itr == mFilePathIndices.end()) { return {}; }
+
+    return mFilePaths[itr->second].diagnosticIndices;
+}
+
+std::vector<std::string_view> DxcDiagnosticAggregator::filePaths() const
+{
+    std::vector<std::string_view> paths;
+    paths.reserve(mFilePaths.size());
+
+    for(const FilePath& filePath : mFilePaths)
+    {
+        paths.push_back(filePath.path);
+    }
+
+    return paths;
+}
+
+void DxcDiagnosticAggregator::clear()
+{
+    mText.clear();
+    mDiagnostics.clear();
+    mDiagnosticsByHash.clear();
+    mFilePaths.clear();
+    mFilePathIndices.clear();
+    mTypeCounts = {};
+    mMessageCount = 0;
+}
+
+uint32_t DxcDiagnosticAggregator::findOrAddFilePath(std::string_view filePath)
+{
+    const auto itr = mFilePathIndices.find(filePath);
+
+    if(itr != mFilePathIndices.end()) { return itr->second; }
+
+    const uint32_t filePathIndex = (uint32_t)mFilePaths.size();
+
+    mFilePaths.push_back(FilePath{.path = std::string(filePath), .diagnosticIndices = {}});
+    mFilePathIndices.emplace(std::string(filePath), filePathIndex);
+
+    return filePathIndex;
+}
+
+bool DxcDiagnosticAggregator::matches(const Diagnostic& diagnostic,
+                                      std::string_view filePath,
+                                      const CompilerMessage& message,
+                                      std::string_view text) const
+{
+    if(diagnostic.line != message.line || diagnostic.column != message.column || diagnostic.type != message.type)
+    {
+        return false;
+    }
+
+    const std::string_view diagnosticFilePath =
+        (diagnostic.filePathIndex != kNoFilePath) ? std::string_view(mFilePaths[diagnostic.filePathIndex].path) : "";
+
+    if(diagnosticFilePath != filePath || (diagnostic.filePathIndex != kNoFilePath) != message.hasFilePath())
+    {
+        return false;
+    }
+
+    return std::string_view(mText).substr(diagnostic.textOffset, diagnostic.textSize) == text;
+}
+
+void DxcDiagnosticAggregator::addVariant(Diagnostic& diagnostic, DxcVariantId variant)
+{
+    if(!diagnostic.variants.empty())
+    {
+        DxcVariantRange& lastRange = diagnostic.variants.back();
+
+        // a variant that reports the same diagnostic twice, e.g. from a header included twice, counts once
+        if(lastRange.last == variant) { return; }
+
+        if(lastRange.last + 1 == variant)
+        {
+            lastRange.last = variant;
+            ++diagnostic.variantCount;
+            return;
+        }
+    }
+
+    diagnostic.variants.push_back(DxcVariantRange{.first = variant, .last = variant});
+    ++diagnostic.variantCount;
+}
+} // namespace shadercompile
@@ -1,17 +1,58 @@
 #include "shadercompile/dxc_external_compiler.h"
 
+#include "diagnostic_parser.h"
+#include "memory_file.h"
 #include "process.h"
+#include "scratch_file.h"
 #include "utility.h"
 
+#include <algorithm>
+#include <array>
 #include <fstream>
+#include <optional>
 
 using namespace std::string_view_literals;
 
 namespace shadercompile
 {
+namespace
+{
+[[nodiscard]] CompileTermination toCompileTermination(ProcessTermination termination) noexcept
+{
+    switch(termination)
+    {
+    case ProcessTermination::TimedOut: return CompileTermination::TimedOut;
+    case ProcessTermination::CpuTimeLimitExceeded: return CompileTermination::CpuTimeLimitExceeded;
+    case ProcessTermination::MemoryLimitExceeded: return CompileTermination::MemoryLimitExceeded;
+    default: return CompileTermination::Exited;
+    }
+}
+} // namespace
+
+struct DxcExternalCompiler::PendingCompile
+{
+    // memory sink artifacts are written by dxc into scratch files that only live until the compile completes
+    std::array<std::optional<ScratchFile>, (size_t)DxcArtifactType::_count> scratchFiles;
+
+#ifdef __linux__
+    std::optional<MemoryFile> sourceFile;
+#else
+    // the copy of a buffer source, removed when the compile completes
+    std::filesystem::path temporarySourcePath;
+#endif
+
+    // only fed while there is a message callback or the compile aborts on its first error
+    detail::IncrementalDiagnosticParser parser;
+    bool streaming = false;
+    bool abortedOnError = false;
+    // the output up to the end of the messages parsed before dxc was killed
+    size_t abortedOutputSize = 0;
+};
+
 DxcExternalCompiler::DxcExternalCompiler(std::filesystem::path compilerPath)
 {
     mProcess = std::make_unique<Process>(compilerPath);
+    mProcess->setJobServer(DxcJobServer::shared());
 }
 
 DxcExternalCompiler::~DxcExternalCompiler() = default;
@@ -58,14 +99,74 @@ std::wstring_view DxcExternalCompiler::command() const
 }
 
 tl::expected<CompileSummary, std::errc>
-DxcExternalCompiler::compileFromFile(const std::filesystem::path& shaderFilePath)
+DxcExternalCompiler::compileFromBufferImpl(std::span<const std::byte> shaderSource, std::wstring_view shaderSourceName)
 {
-    return compileFromFile(shaderFilePath, {});
+    tl::expected<void, std::errc> prepareResult = prepareCompileFromBuffer(shaderSource, shaderSourceName);
+
+    if(!prepareResult) { return tl::make_unexpected(prepareResult.error()); }
+
+    return completeCompile(mProcess->execute(cancellationToken()));
 }
 
-tl::expected<CompileSummary, std::errc> DxcExternalCompiler::compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                                               std::string_view shaderSourceName)
+tl::expected<void, std::errc> DxcExternalCompiler::prepareCompileFromBuffer(std::span<const std::byte> shaderSource,
+                                                                           std::wstring_view shaderSourceName)
 {
+    // The source is written behind a #line directive naming shaderSourceName, so dxc reports diagnostics against that
+    // name directly and the output never has to be searched for the temporary path.
+    constexpr std::array<std::byte, 3> kUtf8ByteOrderMark = {std::byte{0xEF}, std::byte{0xBB}, std::byte{0xBF}};
+
+    std::span<const std::byte> byteOrderMark;
+
+    if(shaderSource.size() >= kUtf8ByteOrderMark.size() &&
+       std::equal(kUtf8ByteOrderMark.begin(), kUtf8ByteOrderMark.end(), shaderSource.begin()))
+    {
+        // the byte order mark has to stay in front of the directive
+        byteOrderMark = shaderSource.first(kUtf8ByteOrderMark.size());
+        shaderSource = shaderSource.subspan(kUtf8ByteOrderMark.size());
+    }
+
+    const std::string utf8SourceName = utf8Encode(shaderSourceName);
+
+    std::string lineDirective;
+
+    if(!utf8SourceName.empty())
+    {
+        lineDirective.reserve(utf8SourceName.size() + 12);
+        lineDirective.append("#line 1 \"");
+
+        for(const char c : utf8SourceName)
+        {
+            if(c == '\\' || c == '"') { lineDirective.push_back('\\'); }
+            lineDirective.push_back(c);
+        }
+
+        lineDirective.append("\"\n");
+    }
+
+#ifdef __linux__
+    // the source goes into an anonymous in-memory file that dxc opens through /proc/self/fd, so nothing touches the
+    // disk
+    tl::expected<MemoryFile, std::errc> sourceFile = MemoryFile::create("shadercompile-source");
+
+    if(!sourceFile) { return tl::make_unexpected(sourceFile.error()); }
+
+    for(std::span<const std::byte> bytes :
+        {byteOrderMark, std::as_bytes(std::span<const char>(lineDirective)), shaderSource})
+    {
+        tl::expected<void, std::errc> writeResult = sourceFile->write(bytes);
+
+        if(!writeResult) { return tl::make_unexpected(writeResult.error()); }
+    }
+
+    mShaderFilePath = sourceFile->path();
+
+    mProcess->inheritFileDescriptor(sourceFile->fileDescriptor());
+
+    mPendingCompile = std::make_unique<PendingCompile>();
+    mPendingCompile->sourceFile = std::move(sourceFile.value());
+
+    return prepareCompileFromFile(mShaderFilePath);
+#else
     tl::expected<std::filesystem::path, std::errc> createFileResult =
         createTemporaryFilePath(L"shader-", L"", L".hlsl");
 
@@ -74,21 +175,46 @@ tl::expected<CompileSummary, std::errc> DxcExternalCompiler::compileFromBuffer(s
     mShaderFilePath = std::move(createFileResult.value());
 
     {
-        std::ofstream tempFileStream(mShaderFilePath);
+        std::ofstream tempFileStream(mShaderFilePath, std::ios_base::out | std::ios_base::binary);
 
         if(!tempFileStream.is_open()) { return tl::make_unexpected(std::errc::io_error); }
 
+        tempFileStream.write(reinterpret_cast<const char*>(byteOrderMark.data()), byteOrderMark.size());
+        tempFileStream.write(lineDirective.data(), lineDirective.size());
         tempFileStream.write(reinterpret_cast<const char*>(shaderSource.data()), shaderSource.size());
     }
 
-    return compileFromFile(mShaderFilePath, shaderSourceName);
+    mPendingCompile = std::make_unique<PendingCompile>();
+    mPendingCompile->temporarySourcePath = mShaderFilePath;
+
+    return prepareCompileFromFile(mShaderFilePath);
+#endif
 }
 
-tl::expected<CompileSummary, std::errc> DxcExternalCompiler::compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                                               std::wstring_view shaderSourceName)
+void DxcExternalCompiler::setProcessLimits(const DxcProcessLimits& limits)
 {
-    std::string utf8SourceName = utf8Encode(shaderSourceName);
-    return compileFromBuffer(shaderSource, utf8SourceName);
+    mProcess->setLimits(ProcessLimits{.wallClockTimeout = limits.wallClockTimeout,
+                                      .cpuTime = limits.cpuTimeLimit,
+                                      .addressSpaceBytes = limits.addressSpaceByteLimit});
+}
+
+DxcProcessLimits DxcExternalCompiler::processLimits() const
+{
+    const ProcessLimits& limits = mProcess->limits();
+
+    return DxcProcessLimits{.wallClockTimeout = limits.wallClockTimeout,
+                            .cpuTimeLimit = limits.cpuTime,
+                            .addressSpaceByteLimit = limits.addressSpaceBytes};
+}
+
+void DxcExternalCompiler::setJobServer(std::shared_ptr<DxcJobServer> jobServer)
+{
+    mProcess->setJobServer(std::move(jobServer));
+}
+
+const std::shared_ptr<DxcJobServer>& DxcExternalCompiler::jobServer() const noexcept
+{
+    return mProcess->jobServer();
 }
 
 void DxcExternalCompiler::reset() noexcept
@@ -99,95 +225,146 @@ void DxcExternalCompiler::reset() noexcept
 }
 
 tl::expected<CompileSummary, std::errc>
-DxcExternalCompiler::compileFromFile(const std::filesystem::path& shaderFilePath, std::string_view shaderSourceName)
+DxcExternalCompiler::compileFromFileImpl(const std::filesystem::path& shaderFilePath)
+{
+    tl::expected<void, std::errc> prepareResult = prepareCompileFromFile(shaderFilePath);
+
+    if(!prepareResult) { return tl::make_unexpected(prepareResult.error()); }
+
+    return completeCompile(mProcess->execute(cancellationToken()));
+}
+
+tl::expected<void, std::errc> DxcExternalCompiler::prepareCompileFromFile(const std::filesystem::path& shaderFilePath)
 {
+    // a buffer compile has already started one
+    if(mPendingCompile == nullptr) { mPendingCompile = std::make_unique<PendingCompile>(); }
+
     forEachEnum<DxcArtifactType>(
         [&](DxcArtifactType type)
         {
             if(!shouldOutputArtifact(type)) { return; }
 
-            addArtifactArguments(type);
+            addArtifactArguments(type, mPendingCompile->scratchFiles[(size_t)type]);
         });
 
     mProcess->addArgument(shaderFilePath);
 
-    tl::expected<int, std::errc> executeResult = mProcess->execute();
+    if(mMessageCallback || mAbortOnFirstError)
+    {
+        mPendingCompile->streaming = true;
+
+        mProcess->setOutputCallback(
+            [this](std::span<const std::byte> chunk)
+            {
+                streamCompilerOutput(std::string_view(reinterpret_cast<const char*>(chunk.data()), chunk.size()),
+                                     false);
+            });
+    }
+
+    return {};
+}
+
+tl::expected<CompileSummary, std::errc>
+DxcExternalCompiler::completeCompile(tl::expected<int, std::errc> executeResult)
+{
+    auto releasePendingCompile = finally([this]() { discardPendingCompile(); });
 
     if(!executeResult) { return tl::make_unexpected(executeResult.error()); }
 
+    if(mPendingCompile->streaming) { streamCompilerOutput({}, true); }
+
+    const CompileTermination termination = mPendingCompile->abortedOnError
+                                               ? CompileTermination::AbortedOnError
+                                               : toCompileTermination(mProcess->termination());
+
     forEachEnum<DxcArtifactType>(mArtifacts,
-                                 [](DxcArtifactType /*type*/, DxcArtifact& artifact)
+                                 [&](DxcArtifactType type, DxcArtifact& artifact)
                                  {
-                                     if(artifact.sinkType() != DxcSinkType::MemoryBuffer) { return; }
+                                     const std::optional<ScratchFile>& scratchFile =
+                                         mPendingCompile->scratchFiles[(size_t)type];
 
-                                     std::ifstream artifactFileStream(artifact.path(),
-                                                                      std::ios_base::in | std::ios_base::binary);
+                                     if(artifact.sinkType() != DxcSinkType::MemoryBuffer || !scratchFile) { return; }
 
-                                     if(!artifactFileStream.is_open()) { return; }
+                                     // a killed compiler may have written part of the artifact
+                                     if(termination != CompileTermination::Exited) { return; }
 
-                                     const std::streampos beginPos = artifactFileStream.tellg();
-                                     artifactFileStream.seekg(0, std::ios_base::end);
-                                     const std::streampos endPos = artifactFileStream.tellg();
-                                     artifactFileStream.seekg(0, std::ios_base::beg);
+                                     tl::expected<std::vector<std::byte>, std::errc> contents = scratchFile->read();
 
-                                     std::vector<std::byte> buffer(endPos - beginPos);
-                                     artifactFileStream.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+                                     if(!contents) { return; }
 
-                                     artifact = DxcArtifact(std::move(buffer));
+                                     artifact = DxcArtifact(std::move(contents.value()));
                                  });
 
     std::span<const std::byte> byteOutput = mProcess->output();
 
     std::string_view compilerOutput(reinterpret_cast<const char*>(byteOutput.data()), byteOutput.size());
 
-    // replace the file name (probably a temporary file name), with shaderSourceName
-    std::string modifiedOutput;
-
-    if(!shaderSourceName.empty())
+    // the same messages the callback was called with
+    if(mPendingCompile->abortedOnError)
     {
-        modifiedOutput.reserve(compilerOutput.size());
-
-        const std::string utf8FilePath = shaderFilePath.string();
+        compilerOutput = compilerOutput.substr(0, mPendingCompile->abortedOutputSize);
+    }
 
-        const std::boyer_moore_horspool_searcher searcher(utf8FilePath.begin(), utf8FilePath.end());
+    mCompilerMessages = parseCompilerMessages(compilerOutput, mMaxMessageCount);
 
-        auto searchStartItr = compilerOutput.begin();
+    CompileSummary summary;
+    summary.returnCode = executeResult.value();
+    summary.termination = termination;
+    summary.messages = mCompilerMessages;
+    summary.arguments = mProcess->arguments();
+    summary.errorCount = (int)mCompilerMessages.count(CompilerMessageType::Error);
+    summary.warningCount = (int)mCompilerMessages.count(CompilerMessageType::Warning);
 
-        while(searchStartItr != compilerOutput.end())
-        {
-            auto searchItr = std::search(searchStartItr, compilerOutput.end(), searcher);
+    return summary;
+}
 
-            modifiedOutput.append(searchStartItr, searchItr);
+void DxcExternalCompiler::discardPendingCompile() noexcept
+{
+    mProcess->setOutputCallback(nullptr);
 
-            if(searchItr != compilerOutput.end())
-            {
-                modifiedOutput.append(shaderSourceName);
-                searchStartItr = searchItr + utf8FilePath.size();
-            }
-            else { searchStartItr = compilerOutput.end(); }
-        }
+#ifndef _WIN32
+    mProcess->clearInheritedFileDescriptors();
+#endif
 
-        compilerOutput = modifiedOutput;
+#ifndef __linux__
+    if(mPendingCompile != nullptr && !mPendingCompile->temporarySourcePath.empty())
+    {
+        std::error_code errorCode;
+        std::filesystem::remove(mPendingCompile->temporarySourcePath, errorCode);
     }
+#endif
 
-    mCompilerMessages.clear();
-    parseCompilerMessages(compilerOutput, mCompilerMessages);
+    mPendingCompile.reset();
+}
 
-    CompileSummary summary;
-    summary.returnCode = executeResult.value();
-    summary.messages = mCompilerMessages;
-    summary.arguments = mProcess->arguments();
+void DxcExternalCompiler::streamCompilerOutput(std::string_view chunk, bool outputEnded)
+{
+    PendingCompile& pendingCompile = *mPendingCompile;
 
-    for(const CompilerMessage& message : mCompilerMessages)
+    // the output dxc writes after the error it is killed for is not parsed
+    if(pendingCompile.abortedOnError) { return; }
+
+    bool errorCompleted = false;
+
+    auto onMessage = [&](const CompilerMessage& message)
     {
-        summary.errorCount += (message.type == CompilerMessageType::Error) ? 1 : 0;
-        summary.warningCount += (message.type == CompilerMessageType::Warning) ? 1 : 0;
-    }
+        if(mMessageCallback) { mMessageCallback(message); }
 
-    return summary;
+        if(message.type == CompilerMessageType::Error) { errorCompleted = true; }
+    };
+
+    if(outputEnded) { pendingCompile.parser.finish(onMessage); }
+    else { pendingCompile.parser.feed(chunk, onMessage); }
+
+    if(!mAbortOnFirstError || !errorCompleted || outputEnded) { return; }
+
+    pendingCompile.abortedOnError = true;
+    pendingCompile.abortedOutputSize = pendingCompile.parser.completedSize();
+
+    mProcess->kill();
 }
 
-void DxcExternalCompiler::addArtifactArguments(DxcArtifactType artifactType)
+void DxcExternalCompiler::addArtifactArguments(DxcArtifactType artifactType, std::optional<ScratchFile>& scratchFile)
 {
     static constexpr std::array<std::wstring_view, (size_t)DxcArtifactType::_count> kArtifactArgumentPrefixes = {
         L"-Fc"sv,  // AssemblyCodeListing
@@ -195,7 +372,8 @@ void DxcExternalCompiler::addArtifactArguments(DxcArtifactType artifactType)
         L"-Fo"sv,  // Object
         L"-Fre"sv, // Reflection
         L"-Frs"sv, // Root signature
-        L"-Fsh"sv  // Shader hash
+        L"-Fsh"sv, // Shader hash
+        L"-Fi"sv   // Preprocessed source
     };
 
     DxcArtifact& artifact = accessArtifact(artifactType);
@@ -206,12 +384,20 @@ void DxcExternalCompiler::addArtifactArguments(DxcArtifactType artifactType)
 
     if(artifact.sinkType() == DxcSinkType::MemoryBuffer)
     {
-        tl::expected<std::filesystem::path, std::errc> createFilePathResult =
-            createTemporaryFilePath(L"", kArtifactArgumentPrefixes[(size_t)artifactType], L".tmp");
+        tl::expected<ScratchFile, std::errc> createScratchFileResult =
+            ScratchFile::create(kArtifactArgumentPrefixes[(size_t)artifactType]);
+
+        if(!createScratchFileResult) { return; }
+
+        scratchFile = std::move(createScratchFileResult.value());
 
-        if(!createFilePathResult) { return; }
+#ifdef __linux__
+        mProcess->inheritFileDescriptor(scratchFile->fileDescriptor());
+#endif
 
-        artifact.setPath(std::move(createFilePathResult.value()));
+        mProcess->addArgument(kArtifactArgumentPrefixes[(size_t)artifactType]);
+        mProcess->addArgument(scratchFile->path());
+        return;
     }
 
     mProcess->addArgument(kArtifactArgumentPrefixes[(size_t)artifactType]);
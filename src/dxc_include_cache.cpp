@@ -0,0 +1,140 @@
+#include "shadercompile/dxc_include_cache.h"
+
+#include "utility.h"
+
+#include <fstream>
+#include <mutex>
+#include <utility>
+
+namespace shadercompile
+{
+tl::expected<DxcIncludeCache::Contents, std::errc> DxcIncludeCache::load(const std::filesystem::path& path)
+{
+    return loadFile(path).map([](File&& file) { return std::move(file.contents); });
+}
+
+tl::expected<DxcIncludeCache::File, std::errc> DxcIncludeCache::loadFile(const std::filesystem::path& path)
+{
+    std::error_code errorCode;
+    const std::filesystem::path absolutePath = std::filesystem::absolute(path, errorCode).lexically_normal();
+
+    if(errorCode) { return tl::make_unexpected(std::errc::invalid_argument); }
+
+    const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(absolutePath, errorCode);
+
+    if(errorCode) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+    const uintmax_t size = std::filesystem::file_size(absolutePath, errorCode);
+
+    if(errorCode) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+    bool invalidated = false;
+
+    {
+        std::shared_lock lock(mMutex);
+
+        auto itr = mFiles.find(absolutePath.native());
+
+        if(itr != mFiles.end())
+        {
+            if(itr->second.lastWriteTime == lastWriteTime && itr->second.size == size)
+            {
+                mHitCount.fetch_add(1, std::memory_order_relaxed);
+                return itr->second.file;
+            }
+
+            invalidated = true;
+        }
+    }
+
+    std::ifstream fileStream(absolutePath, std::ios_base::in | std::ios_base::binary);
+
+    if(!fileStream.is_open()) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+    std::vector<std::byte> contents((size_t)size);
+    fileStream.read(reinterpret_cast<char*>(contents.data()), (std::streamsize)contents.size());
+
+    // the file may have been truncated between the stat and the read, the next load sees the new size and rereads it
+    contents.resize((size_t)fileStream.gcount());
+
+    Fnv1aHash hash;
+    hash.update(contents);
+
+    mMissCount.fetch_add(1, std::memory_order_relaxed);
+    if(invalidated) { mInvalidationCount.fetch_add(1, std::memory_order_relaxed); }
+
+    std::unique_lock lock(mMutex);
+
+    FileEntry& entry = mFiles[absolutePath.native()];
+    entry.lastWriteTime = lastWriteTime;
+    entry.size = size;
+    entry.file.contents = internContents(hash.value(), std::move(contents));
+    entry.file.contentHash = hash.value();
+
+    // drop the slots of contents that no file refers to anymore
+    if(invalidated)
+    {
+        std::erase_if(mContents, [](const auto& item) { return item.second.expired(); });
+    }
+
+    return entry.file;
+}
+
+DxcIncludeCache::Contents DxcIncludeCache::internContents(uint64_t hash, std::vector<std::byte> contents)
+{
+    auto itr = mContents.find(hash);
+
+    if(itr != mContents.end())
+    {
+        Contents existing = itr->second.lock();
+
+        if(existing != nullptr && *existing == contents) { return existing; }
+
+        // on a hash collision the first contents keep the slot and the new contents are simply not shared
+        if(existing != nullptr) { return std::make_shared<const std::vector<std::byte>>(std::move(contents)); }
+    }
+
+    Contents shared = std::make_shared<const std::vector<std::byte>>(std::move(contents));
+    mContents.insert_or_assign(hash, shared);
+
+    return shared;
+}
+
+void DxcIncludeCache::clear()
+{
+    std::unique_lock lock(mMutex);
+
+    mFiles.clear();
+    mContents.clear();
+}
+
+DxcIncludeCacheStatistics DxcIncludeCache::statistics() const
+{
+    DxcIncludeCacheStatistics statistics;
+    statistics.hitCount = mHitCount.load(std::memory_order_relaxed);
+    statistics.missCount = mMissCount.load(std::memory_order_relaxed);
+    statistics.invalidationCount = mInvalidationCount.load(std::memory_order_relaxed);
+
+    std::shared_lock lock(mMutex);
+
+    statistics.fileCount = mFiles.size();
+
+    for(const auto& [hash, weakContents] : mContents)
+    {
+        if(Contents contents = weakContents.lock(); contents != nullptr)
+        {
+            ++statistics.contentCount;
+            statistics.contentByteCount += contents->size();
+        }
+    }
+
+    return statistics;
+}
+
+void DxcIncludeCache::resetStatistics() noexcept
+{
+    mHitCount.store(0, std::memory_order_relaxed);
+    mMissCount.store(0, std::memory_order_relaxed);
+    mInvalidationCount.store(0, std::memory_order_relaxed);
+}
+} // namespace shadercompile
@@ -0,0 +1,297 @@
+#include "shadercompile/dxc_job_server.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+using namespace std::string_view_literals;
+
+namespace shadercompile
+{
+namespace
+{
+#ifndef _WIN32
+// Waiting for make's jobserver also waits for the implicit token and for cancellation, which are checked again after
+// this long.
+constexpr std::chrono::milliseconds kTokenPollInterval{10};
+
+// the value of the last jobserver option in MAKEFLAGS, make passes the old spelling to older sub-makes
+[[nodiscard]] std::string_view findJobServerAuth(std::string_view makeFlags)
+{
+    std::string_view auth;
+
+    for(size_t offset = 0; offset < makeFlags.size();)
+    {
+        size_t end = makeFlags.find(' ', offset);
+        if(end == std::string_view::npos) { end = makeFlags.size(); }
+
+        const std::string_view flag = makeFlags.substr(offset, end - offset);
+
+        if(flag.starts_with("--jobserver-auth="sv)) { auth = flag.substr("--jobserver-auth="sv.size()); }
+        else if(flag.starts_with("--jobserver-fds="sv)) { auth = flag.substr("--jobserver-fds="sv.size()); }
+
+        offset = end + 1;
+    }
+
+    return auth;
+}
+
+// True when descriptor is a pipe that can be used for access, O_RDONLY or O_WRONLY. The jobserver is looked up when
+// the first compiler is created, by then the program may have reused the numbers of descriptors make closed.
+[[nodiscard]] bool isPipeDescriptor(int descriptor, int access)
+{
+    if(descriptor < 0) { return false; }
+
+    struct stat status;
+    if(fstat(descriptor, &status) != 0 || !S_ISFIFO(status.st_mode)) { return false; }
+
+    const int flags = fcntl(descriptor, F_GETFL);
+    if(flags == -1) { return false; }
+
+    const int accessMode = flags & O_ACCMODE;
+    return accessMode == access || accessMode == O_RDWR;
+}
+#endif
+} // namespace
+
+DxcJobServer::Token::Token(Token&& other) noexcept
+    : mJobServer(std::move(other.mJobServer))
+    , mImplicit(other.mImplicit)
+    , mValue(other.mValue)
+{}
+
+DxcJobServer::Token::~Token() { release(); }
+
+DxcJobServer::Token& DxcJobServer::Token::operator=(Token&& other) noexcept
+{
+    if(this == &other) { return *this; }
+
+    release();
+
+    mJobServer = std::move(other.mJobServer);
+    mImplicit = other.mImplicit;
+    mValue = other.mValue;
+
+    return *this;
+}
+
+void DxcJobServer::Token::release() noexcept
+{
+    if(mJobServer == nullptr) { return; }
+
+    mJobServer->releaseToken(mImplicit, mValue);
+    mJobServer.reset();
+}
+
+std::shared_ptr<DxcJobServer> DxcJobServer::fromEnvironment(size_t localTokenCount)
+{
+#ifndef _WIN32
+    const char* makeFlags = std::getenv("MAKEFLAGS");
+    const std::string_view auth = findJobServerAuth((makeFlags != nullptr) ? makeFlags : "");
+
+    if(auth.starts_with("fifo:"sv))
+    {
+        const std::string fifoPath(auth.substr("fifo:"sv.size()));
+        const int descriptor = open(fifoPath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+        if(descriptor != -1)
+        {
+            std::shared_ptr<DxcJobServer> jobServer(new DxcJobServer(Kind::Fifo, 0));
+            jobServer->mReadDescriptor = descriptor;
+            jobServer->mWriteDescriptor = descriptor;
+            jobServer->mOwnsReadDescriptor = true;
+
+            return jobServer;
+        }
+    }
+    else if(const size_t separator = auth.find(','); separator != std::string_view::npos)
+    {
+        int readDescriptor = -1;
+        int writeDescriptor = -1;
+
+        std::from_chars(auth.data(), auth.data() + separator, readDescriptor);
+        std::from_chars(auth.data() + separator + 1, auth.data() + auth.size(), writeDescriptor);
+
+        // make closes the descriptors for rules that are not marked with +, the local semaphore is used then
+        if(isPipeDescriptor(readDescriptor, O_RDONLY) && isPipeDescriptor(writeDescriptor, O_WRONLY))
+        {
+            std::shared_ptr<DxcJobServer> jobServer(new DxcJobServer(Kind::Pipe, 0));
+            jobServer->mWriteDescriptor = writeDescriptor;
+
+            // The inherited read end is shared with make and every other job, it cannot be made non-blocking without
+            // affecting them. Reopening it creates a separate open file description that can. Where that is not
+            // possible a read can block when another job takes the token between poll and read.
+            const std::string reopenPath = "/proc/self/fd/" + std::to_string(readDescriptor);
+            jobServer->mReadDescriptor = open(reopenPath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+            if(jobServer->mReadDescriptor != -1) { jobServer->mOwnsReadDescriptor = true; }
+            else { jobServer->mReadDescriptor = readDescriptor; }
+
+            return jobServer;
+        }
+    }
+#endif
+
+    return createLocal(localTokenCount);
+}
+
+std::shared_ptr<DxcJobServer> DxcJobServer::createLocal(size_t tokenCount)
+{
+    if(tokenCount == 0) { tokenCount = std::max(1u, std::thread::hardware_concurrency()); }
+
+    return std::shared_ptr<DxcJobServer>(new DxcJobServer(Kind::Local, tokenCount));
+}
+
+const std::shared_ptr<DxcJobServer>& DxcJobServer::shared()
+{
+    static const std::shared_ptr<DxcJobServer> jobServer = fromEnvironment();
+    return jobServer;
+}
+
+DxcJobServer::DxcJobServer(Kind kind, size_t localTokenCount)
+    : mKind(kind)
+    , mAvailableLocalTokens(localTokenCount)
+{}
+
+DxcJobServer::~DxcJobServer()
+{
+#ifndef _WIN32
+    if(mOwnsReadDescriptor) { close(mReadDescriptor); }
+#endif
+}
+
+tl::expected<DxcJobServer::Token, std::errc> DxcJobServer::acquire(std::stop_token cancellationToken)
+{
+    std::unique_lock lock(mMutex);
+
+    if(mKind == Kind::Local)
+    {
+        if(mAvailableLocalTokens == 0)
+        {
+            ++mStatistics.waitCount;
+
+            if(!mTokenReleased.wait(lock, cancellationToken, [this]() { return mAvailableLocalTokens > 0; }))
+            {
+                return tl::make_unexpected(std::errc::operation_canceled);
+            }
+        }
+
+        --mAvailableLocalTokens;
+        ++mStatistics.acquiredCount;
+        ++mStatistics.heldCount;
+
+        return Token(shared_from_this(), false, 0);
+    }
+
+#ifdef _WIN32
+    return tl::make_unexpected(std::errc::not_supported);
+#else
+    bool waited = false;
+
+    for(;;)
+    {
+        if(cancellationToken.stop_requested()) { return tl::make_unexpected(std::errc::operation_canceled); }
+
+        if(!mImplicitTokenHeld)
+        {
+            mImplicitTokenHeld = true;
+            ++mStatistics.acquiredCount;
+            ++mStatistics.heldCount;
+
+            return Token(shared_from_this(), true, 0);
+        }
+
+        // other jobs of the build read from the same jobserver, none of that happens under the lock
+        lock.unlock();
+
+        tl::expected<std::optional<char>, std::errc> value = tryReadToken();
+
+        if(value && !value->has_value())
+        {
+            pollfd pollFd{.fd = mReadDescriptor, .events = POLLIN, .revents = 0};
+            static_cast<void>(poll(&pollFd, 1, (int)kTokenPollInterval.count()));
+        }
+
+        lock.lock();
+
+        if(!value) { return tl::make_unexpected(value.error()); }
+
+        if(value->has_value())
+        {
+            mStatistics.waitCount += waited ? 1 : 0;
+            ++mStatistics.acquiredCount;
+            ++mStatistics.heldCount;
+
+            return Token(shared_from_this(), false, value->value());
+        }
+
+        waited = true;
+    }
+#endif
+}
+
+DxcJobServerStatistics DxcJobServer::statistics() const
+{
+    std::lock_guard lock(mMutex);
+    return mStatistics;
+}
+
+void DxcJobServer::releaseToken([[maybe_unused]] bool implicit, [[maybe_unused]] char value) noexcept
+{
+#ifndef _WIN32
+    // a token that cannot be written back is lost for the rest of the build, there is nothing else to do with it
+    if(mKind != Kind::Local && !implicit)
+    {
+        while(write(mWriteDescriptor, &value, 1) == -1 && errno == EINTR) {}
+    }
+#endif
+
+    {
+        std::lock_guard lock(mMutex);
+
+        --mStatistics.heldCount;
+
+        if(mKind == Kind::Local) { ++mAvailableLocalTokens; }
+        else if(implicit) { mImplicitTokenHeld = false; }
+    }
+
+    if(mKind == Kind::Local) { mTokenReleased.notify_one(); }
+}
+
+tl::expected<std::optional<char>, std::errc> DxcJobServer::tryReadToken() noexcept
+{
+#ifdef _WIN32
+    return std::optional<char>();
+#else
+    for(;;)
+    {
+        char value = 0;
+        const ssize_t readResult = read(mReadDescriptor, &value, 1);
+
+        if(readResult == 1) { return value; }
+
+        // make closed the jobserver, it is no longer running the build
+        if(readResult == 0) { return tl::make_unexpected(std::errc::broken_pipe); }
+
+        if(errno == EINTR) { continue; }
+
+        if(errno == EAGAIN || errno == EWOULDBLOCK) { return std::optional<char>(); }
+
+        return tl::make_unexpected(std::errc(errno));
+    }
+#endif
+}
+} // namespace shadercompile
@@ -1,16 +1,96 @@
 #include "shadercompile/dxc_library_compiler.h"
 
+#include "dxc_caching_include_handler.h"
+#include "dxc_recording_include_handler.h"
 #include "utility.h"
 
 #include <dxcapi.h>
 
 #include <fstream>
 
-using namespace Microsoft::WRL;
+#ifndef _WIN32
+#include <dlfcn.h>
+
+#include <mutex>
+#endif
+
 using namespace std::string_view_literals;
 
 namespace shadercompile
 {
+namespace
+{
+#ifndef _WIN32
+std::mutex gLibraryMutex;
+std::filesystem::path gLibraryPath = "libdxcompiler.so";
+DxcCreateInstanceProc gDxcCreateInstance = nullptr;
+#endif
+
+DxcCreateInstanceProc loadDxcCreateInstance()
+{
+#ifdef _WIN32
+    return &DxcCreateInstance;
+#else
+    std::lock_guard lock(gLibraryMutex);
+
+    if(gDxcCreateInstance != nullptr) { return gDxcCreateInstance; }
+
+    // the library is never unloaded, the thread local DXC instances may outlive any object that could own it
+    void* library = dlopen(gLibraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+    if(library == nullptr) { return nullptr; }
+
+    gDxcCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(dlsym(library, "DxcCreateInstance"));
+
+    if(gDxcCreateInstance == nullptr) { dlclose(library); }
+
+    return gDxcCreateInstance;
+#endif
+}
+} // namespace
+
+struct DxcLibraryCompiler::DxcThreadInstances
+{
+    ComPtr<IDxcUtils> utils;
+    ComPtr<IDxcCompiler3> compiler;
+    ComPtr<IDxcIncludeHandler> includeHandler;
+};
+
+DxcLibraryCompiler::DxcThreadInstances* DxcLibraryCompiler::getDxcThreadInstances()
+{
+    // DXC compiler objects must not be used by two threads at once, so every thread creates its own set on its first
+    // compile and keeps it until the thread exits. Any number of DxcLibraryCompiler objects on that thread share it.
+    thread_local DxcThreadInstances instances;
+
+    if(instances.compiler != nullptr) { return &instances; }
+
+    const DxcCreateInstanceProc createInstance = loadDxcCreateInstance();
+
+    if(createInstance == nullptr) { return nullptr; }
+
+    if(FAILED(createInstance(CLSID_DxcUtils, IID_PPV_ARGS(&instances.utils))) ||
+       FAILED(instances.utils->CreateDefaultIncludeHandler(&instances.includeHandler)) ||
+       FAILED(createInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&instances.compiler))))
+    {
+        instances = {};
+        return nullptr;
+    }
+
+    return &instances;
+}
+
+#ifndef _WIN32
+bool DxcLibraryCompiler::setLibraryPath(std::filesystem::path libraryPath)
+{
+    std::lock_guard lock(gLibraryMutex);
+
+    if(gDxcCreateInstance != nullptr) { return false; }
+
+    gLibraryPath = std::move(libraryPath);
+    return true;
+}
+#endif
+
 void DxcLibraryCompiler::addArgument(std::string_view arg)
 {
     mArguments.push_back(utf8Decode(arg));
@@ -68,13 +148,15 @@ void DxcLibraryCompiler::reset() noexcept
     mArgumentsBuffer.clear();
 }
 
-tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileFromFile(const std::filesystem::path& shaderFilePath)
+tl::expected<CompileSummary, std::errc>
+DxcLibraryCompiler::compileFromFileImpl(const std::filesystem::path& shaderFilePath)
 {
-    ComPtr<IDxcUtils> utils;
-    DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+    DxcThreadInstances* instances = getDxcThreadInstances();
+
+    if(instances == nullptr) { return tl::make_unexpected(std::errc::state_not_recoverable); }
 
     ComPtr<IDxcBlobEncoding> sourceBlob;
-    HRESULT hr = utils->LoadFile(shaderFilePath.c_str(), nullptr, &sourceBlob);
+    HRESULT hr = instances->utils->LoadFile(shaderFilePath.wstring().c_str(), nullptr, &sourceBlob);
 
     if(FAILED(hr)) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
 
@@ -83,82 +165,89 @@ tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileFromFile(cons
     hr = sourceBlob->GetEncoding(&known, &encoding);
 
     if(!known || FAILED(hr)) { encoding = DXC_CP_ACP; }
-    
-    return compileFromBuffer(
-        DxcBuffer{.Ptr = sourceBlob->GetBufferPointer(), .Size = sourceBlob->GetBufferSize(), .Encoding = encoding},
-        shaderFilePath.native(),
-        utils);
-}
 
-tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileFromBuffer(std::span<const std::byte> shaderSource,
-                                                                              std::string_view shaderSourceName)
-{
-    const std::wstring wideSourceName = utf8Decode(shaderSourceName);
-    return compileFromBuffer(shaderSource, wideSourceName);
+    return compileDxcBuffer(
+        DxcBuffer{.Ptr = sourceBlob->GetBufferPointer(), .Size = sourceBlob->GetBufferSize(), .Encoding = encoding},
+        shaderFilePath.wstring(),
+        *instances);
 }
 
 tl::expected<CompileSummary, std::errc>
-DxcLibraryCompiler::compileFromBuffer(std::span<const std::byte> shaderContentBuffer,
-                                      std::wstring_view shaderSourceName)
+DxcLibraryCompiler::compileFromBufferImpl(std::span<const std::byte> shaderContentBuffer,
+                                          std::wstring_view shaderSourceName)
 {
-    ComPtr<IDxcUtils> utils;
-    DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&utils));
+    DxcThreadInstances* instances = getDxcThreadInstances();
+
+    if(instances == nullptr) { return tl::make_unexpected(std::errc::state_not_recoverable); }
 
-    return compileFromBuffer(DxcBuffer{.Ptr = shaderContentBuffer.data(),
-                                       .Size = (UINT32)shaderContentBuffer.size(),
-                                       .Encoding = DXC_CP_ACP},
-                             shaderSourceName,
-                             utils);
+    return compileDxcBuffer(DxcBuffer{.Ptr = shaderContentBuffer.data(),
+                                      .Size = (UINT32)shaderContentBuffer.size(),
+                                      .Encoding = DXC_CP_ACP},
+                            shaderSourceName,
+                            *instances);
 }
 
-tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileFromBuffer(DxcBuffer source,
-                                                                              std::wstring_view sourceName,
-                                                                              Microsoft::WRL::ComPtr<IDxcUtils> utils)
+tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileDxcBuffer(DxcBuffer source,
+                                                                             std::wstring_view sourceName,
+                                                                             DxcThreadInstances& instances)
 {
-    ComPtr<IDxcCompiler3> compiler;
-    DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&compiler));
-
-    ComPtr<IDxcIncludeHandler> includeHandler;
-    utils->CreateDefaultIncludeHandler(&includeHandler);
+    mCompilerMessages = {};
 
-    addArgument(sourceName);
+    // the source name is passed to the compiler but never stored in mArguments, so repeated compiles do not grow it
+    const std::wstring sourceNameArgument(sourceName);
 
-    // Compile
     mArgumentsBuffer.clear();
+    mArgumentsBuffer.reserve(mArguments.size() + 1);
 
     for(const std::wstring& argument : mArguments)
     {
         mArgumentsBuffer.push_back(argument.c_str());
     }
 
+    if(!sourceNameArgument.empty()) { mArgumentsBuffer.push_back(sourceNameArgument.c_str()); }
+
+    ComPtr<IDxcIncludeHandler> includeHandler = instances.includeHandler;
+
+    if(mIncludeCache != nullptr) { includeHandler = new DxcCachingIncludeHandler(instances.utils, mIncludeCache); }
+
+    // the files the compiler actually loaded are exact, the base compiler records them in the dependency graph
+    if(dependencyGraph() != nullptr)
+    {
+        includeHandler = new DxcRecordingIncludeHandler(std::move(includeHandler), mIncludedFiles);
+        mIncludedFilesRecorded = true;
+    }
+
     ComPtr<IDxcResult> results;
-    HRESULT hr = compiler->Compile(&source,
-                                   mArgumentsBuffer.data(),
-                                   (UINT32)mArgumentsBuffer.size(),
-                                   includeHandler.Get(),
-                                   IID_PPV_ARGS(&results));
+    HRESULT hr = instances.compiler->Compile(&source,
+                                             mArgumentsBuffer.data(),
+                                             (UINT32)mArgumentsBuffer.size(),
+                                             includeHandler.Get(),
+                                             IID_PPV_ARGS(&results));
 
     if(FAILED(hr)) { return tl::make_unexpected(std::errc::state_not_recoverable); }
 
     CompileSummary summary;
     summary.arguments = mArguments;
 
-    // Check for errors
     ComPtr<IDxcBlobUtf8> errors;
     hr = results->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr);
 
-    if(FAILED(hr) || (errors != nullptr && errors->GetStringLength() != 0))
+    if(SUCCEEDED(hr) && errors != nullptr && errors->GetStringLength() != 0)
     {
-        parseCompilerMessages(std::string_view(errors->GetStringPointer(), errors->GetStringLength()),
-                              mCompilerMessages);
+        mCompilerMessages = parseCompilerMessages(
+            std::string_view(errors->GetStringPointer(), errors->GetStringLength()), mMaxMessageCount);
         summary.messages = mCompilerMessages;
+        summary.errorCount = (int)mCompilerMessages.count(CompilerMessageType::Error);
+        summary.warningCount = (int)mCompilerMessages.count(CompilerMessageType::Warning);
+    }
 
-        for(const CompilerMessage& message : mCompilerMessages)
-        {
-            summary.errorCount += (message.type == CompilerMessageType::Error) ? 1 : 0;
-            summary.warningCount += (message.type == CompilerMessageType::Warning) ? 1 : 0;
-        }
+    HRESULT status = S_OK;
+    hr = results->GetStatus(&status);
 
+    // warnings alone do not fail a compile, only a failed status skips the artifacts
+    if(FAILED(hr) || FAILED(status))
+    {
+        summary.returnCode = 1;
         return summary;
     }
 
@@ -174,15 +263,18 @@ tl::expected<CompileSummary, std::errc> DxcLibraryCompiler::compileFromBuffer(Dx
                 DXC_OUT_OBJECT,         // Object,
                 DXC_OUT_REFLECTION,     // Reflection,
                 DXC_OUT_ROOT_SIGNATURE, // RootSignature,
-                DXC_OUT_SHADER_HASH     // ShaderHash,
+                DXC_OUT_SHADER_HASH,    // ShaderHash,
+                DXC_OUT_HLSL            // PreprocessedSource,
             };
 
             ComPtr<IDxcBlob> output = nullptr;
-            ComPtr<IDxcBlobUtf16> outputName = nullptr;
+            ComPtr<IDxcBlobWide> outputName = nullptr;
             hr = results->GetOutput(kDxcOutKindMap[(size_t)artifactType],
                                     IID_PPV_ARGS(&output),
                                     outputName.GetAddressOf());
 
+            if(FAILED(hr) || output == nullptr) { return; }
+
             if(artifact.sinkType() == DxcSinkType::File)
             {
                 std::ofstream fileStream(artifact.path(), std::ios_base::out | std::ios_base::binary);
@@ -0,0 +1,226 @@
+#include "shadercompile/dxc_permutation_compiler.h"
+
+#include "utility.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace shadercompile
+{
+namespace
+{
+// requests are built one chunk at a time, so memory does not grow with the number of permutations beyond the results
+constexpr size_t kRequestsPerWorker = 64;
+} // namespace
+
+tl::expected<size_t, std::errc> DxcPermutationSet::addAxis(std::wstring define, std::vector<std::wstring> values)
+{
+    if(define.empty() || values.empty() || findAxis(define))
+    {
+        return tl::make_unexpected(std::errc::invalid_argument);
+    }
+
+    if(mPermutationCount > std::numeric_limits<DxcPermutationKey>::max() / values.size())
+    {
+        return tl::make_unexpected(std::errc::value_too_large);
+    }
+
+    mStrides.push_back(mPermutationCount);
+    mPermutationCount *= values.size();
+
+    mAxes.push_back(DxcPermutationAxis{.define = std::move(define), .values = std::move(values)});
+
+    return mAxes.size() - 1;
+}
+
+tl::expected<size_t, std::errc> DxcPermutationSet::addAxis(std::string_view define,
+                                                           std::span<const std::string_view> values)
+{
+    std::vector<std::wstring> wideValues;
+    wideValues.reserve(values.size());
+
+    for(const std::string_view value : values)
+    {
+        wideValues.push_back(utf8Decode(value));
+    }
+
+    return addAxis(utf8Decode(define), std::move(wideValues));
+}
+
+tl::expected<size_t, std::errc> DxcPermutationSet::addBoolAxis(std::wstring define)
+{
+    return addAxis(std::move(define), std::vector<std::wstring>{L"0", L"1"});
+}
+
+tl::expected<size_t, std::errc> DxcPermutationSet::addBoolAxis(std::string_view define)
+{
+    return addBoolAxis(utf8Decode(define));
+}
+
+tl::expected<void, std::errc>
+DxcPermutationSet::exclude(std::span<const std::pair<std::wstring_view, std::wstring_view>> conditions)
+{
+    std::vector<Condition> exclusion;
+    exclusion.reserve(conditions.size());
+
+    for(const auto& [define, value] : conditions)
+    {
+        const std::optional<size_t> axisIndex = findAxis(define);
+
+        if(!axisIndex) { return tl::make_unexpected(std::errc::invalid_argument); }
+
+        const std::vector<std::wstring>& values = mAxes[axisIndex.value()].values;
+        auto valueItr = std::find(values.begin(), values.end(), value);
+
+        if(valueItr == values.end()) { return tl::make_unexpected(std::errc::invalid_argument); }
+
+        exclusion.push_back(
+            Condition{.axisIndex = axisIndex.value(), .valueIndex = (size_t)std::distance(values.begin(), valueItr)});
+    }
+
+    mExclusions.push_back(std::move(exclusion));
+
+    return {};
+}
+
+void DxcPermutationSet::excludeIf(ExclusionPredicate predicate)
+{
+    mExclusionPredicates.push_back(std::move(predicate));
+}
+
+std::optional<size_t> DxcPermutationSet::findAxis(std::wstring_view define) const noexcept
+{
+    auto itr = std::find_if(
+        mAxes.begin(), mAxes.end(), [&](const DxcPermutationAxis& axis) { return axis.define == define; });
+
+    if(itr == mAxes.end()) { return std::nullopt; }
+
+    return (size_t)std::distance(mAxes.begin(), itr);
+}
+
+size_t DxcPermutationSet::valueIndex(DxcPermutationKey key, size_t axisIndex) const noexcept
+{
+    return (size_t)((key / mStrides[axisIndex]) % mAxes[axisIndex].values.size());
+}
+
+const std::wstring& DxcPermutationSet::value(DxcPermutationKey key, size_t axisIndex) const noexcept
+{
+    return mAxes[axisIndex].values[valueIndex(key, axisIndex)];
+}
+
+std::optional<DxcPermutationKey> DxcPermutationSet::makeKey(std::span<const size_t> valueIndices) const noexcept
+{
+    if(valueIndices.size() != mAxes.size()) { return std::nullopt; }
+
+    DxcPermutationKey key = 0;
+
+    for(size_t axisIndex = 0; axisIndex < mAxes.size(); ++axisIndex)
+    {
+        if(valueIndices[axisIndex] >= mAxes[axisIndex].values.size()) { return std::nullopt; }
+
+        key += valueIndices[axisIndex] * mStrides[axisIndex];
+    }
+
+    return key;
+}
+
+bool DxcPermutationSet::isExcluded(DxcPermutationKey key) const
+{
+    const bool excludedByConditions =
+        std::any_of(mExclusions.begin(),
+                    mExclusions.end(),
+                    [&](const std::vector<Condition>& exclusion)
+                    {
+                        return std::all_of(exclusion.begin(),
+                                           exclusion.end(),
+                                           [&](const Condition& condition)
+                                           { return valueIndex(key, condition.axisIndex) == condition.valueIndex; });
+                    });
+
+    if(excludedByConditions) { return true; }
+
+    return std::any_of(mExclusionPredicates.begin(),
+                       mExclusionPredicates.end(),
+                       [&](const ExclusionPredicate& predicate) { return predicate(*this, key); });
+}
+
+std::vector<DxcPermutationKey> DxcPermutationSet::enumerate() const
+{
+    std::vector<DxcPermutationKey> keys;
+
+    for(DxcPermutationKey key = 0; key < mPermutationCount; ++key)
+    {
+        if(!isExcluded(key)) { keys.push_back(key); }
+    }
+
+    return keys;
+}
+
+void DxcPermutationSet::appendDefineArguments(DxcPermutationKey key, std::vector<std::wstring>& arguments) const
+{
+    for(size_t axisIndex = 0; axisIndex < mAxes.size(); ++axisIndex)
+    {
+        std::wstring argument = L"-D";
+        argument.append(mAxes[axisIndex].define);
+        argument.push_back(L'=');
+        argument.append(value(key, axisIndex));
+
+        arguments.push_back(std::move(argument));
+    }
+}
+
+DxcPermutationCompiler::DxcPermutationCompiler(DxcBatchCompiler::CompilerFactory compilerFactory, size_t threadCount)
+    : mBatchCompiler(std::move(compilerFactory), threadCount)
+{}
+
+DxcPermutationResults DxcPermutationCompiler::compile(const DxcPermutationSet& permutationSet,
+                                                      const CompileRequest& baseRequest,
+                                                      const RequestCustomizer& customizeRequest)
+{
+    const std::vector<DxcPermutationKey> keys = permutationSet.enumerate();
+
+    return compile(permutationSet, keys, baseRequest, customizeRequest);
+}
+
+DxcPermutationResults DxcPermutationCompiler::compile(const DxcPermutationSet& permutationSet,
+                                                      std::span<const DxcPermutationKey> keys,
+                                                      const CompileRequest& baseRequest,
+                                                      const RequestCustomizer& customizeRequest)
+{
+    DxcPermutationResults results;
+    results.reserve(keys.size());
+
+    // deduplication only finds matches within one batch, so it gets all permutations at once
+    const size_t chunkSize = mBatchCompiler.preprocessDeduplication()
+                                 ? std::max<size_t>(keys.size(), 1)
+                                 : mBatchCompiler.threadCount() * kRequestsPerWorker;
+
+    std::vector<CompileRequest> requests;
+    requests.reserve(std::min(chunkSize, keys.size()));
+
+    for(size_t chunkBegin = 0; chunkBegin < keys.size(); chunkBegin += chunkSize)
+    {
+        const std::span<const DxcPermutationKey> chunkKeys =
+            keys.subspan(chunkBegin, std::min(chunkSize, keys.size() - chunkBegin));
+
+        requests.clear();
+
+        for(const DxcPermutationKey key : chunkKeys)
+        {
+            CompileRequest& request = requests.emplace_back(baseRequest);
+            permutationSet.appendDefineArguments(key, request.arguments);
+
+            if(customizeRequest) { customizeRequest(permutationSet, key, request); }
+        }
+
+        std::vector<tl::expected<CompileResult, std::errc>> chunkResults = mBatchCompiler.compileBatch(requests);
+
+        for(size_t index = 0; index < chunkKeys.size(); ++index)
+        {
+            results.insert_or_assign(chunkKeys[index], std::move(chunkResults[index]));
+        }
+    }
+
+    return results;
+}
+} // namespace shadercompile
@@ -0,0 +1,61 @@
+#include "dxc_recording_include_handler.h"
+
+#include <span>
+#include <utility>
+
+namespace shadercompile
+{
+DxcRecordingIncludeHandler::DxcRecordingIncludeHandler(ComPtr<IDxcIncludeHandler> includeHandler,
+                                                       std::vector<DxcFileDependency>& includedFiles) noexcept
+    : mIncludeHandler(std::move(includeHandler))
+    , mIncludedFiles(includedFiles)
+{}
+
+HRESULT STDMETHODCALLTYPE DxcRecordingIncludeHandler::LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource)
+{
+    if(pFilename == nullptr) { return E_INVALIDARG; }
+
+    const HRESULT hr = mIncludeHandler->LoadSource(pFilename, ppIncludeSource);
+
+    // only the candidate that was found is recorded, not every include directory the compiler probed
+    if(FAILED(hr) || *ppIncludeSource == nullptr) { return hr; }
+
+    const std::span<const std::byte> contents(static_cast<const std::byte*>((*ppIncludeSource)->GetBufferPointer()),
+                                              (*ppIncludeSource)->GetBufferSize());
+
+    mIncludedFiles.push_back(
+        DxcFileDependency{.path = pFilename, .contentHash = DxcDependencyGraph::hashContents(contents)});
+
+    return hr;
+}
+
+HRESULT STDMETHODCALLTYPE DxcRecordingIncludeHandler::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if(ppvObject == nullptr) { return E_INVALIDARG; }
+
+    if(IsEqualIID(riid, __uuidof(IDxcIncludeHandler)) || IsEqualIID(riid, __uuidof(IUnknown)))
+    {
+        AddRef();
+        *ppvObject = static_cast<IDxcIncludeHandler*>(this);
+        return S_OK;
+    }
+
+    *ppvObject = nullptr;
+
+    return E_NOINTERFACE;
+}
+
+ULONG STDMETHODCALLTYPE DxcRecordingIncludeHandler::AddRef()
+{
+    return mReferenceCount.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+ULONG STDMETHODCALLTYPE DxcRecordingIncludeHandler::Release()
+{
+    const ULONG referenceCount = mReferenceCount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+
+    if(referenceCount == 0) { delete this; }
+
+    return referenceCount;
+}
+} // namespace shadercompile
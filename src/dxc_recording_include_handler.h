@@ -0,0 +1,36 @@
+#pragma once
+
+#include <shadercompile/detail/com_ptr.h>
+#include <shadercompile/dxc_dependency_graph.h>
+
+#include <dxcapi.h>
+
+#include <atomic>
+#include <filesystem>
+#include <vector>
+
+namespace shadercompile
+{
+// Forwards the compiler's #include requests to another include handler and appends the name of every file that was
+// loaded, with the hash of the contents handed to the compiler, to includedFiles. The compiler calls the handler on the
+// compiling thread only, so the vector needs no synchronization, but it must outlive the compile.
+class DxcRecordingIncludeHandler final : public IDxcIncludeHandler
+{
+public:
+    DxcRecordingIncludeHandler(ComPtr<IDxcIncludeHandler> includeHandler,
+                               std::vector<DxcFileDependency>& includedFiles) noexcept;
+
+    HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override;
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+
+private:
+    ~DxcRecordingIncludeHandler() = default;
+
+    std::atomic<ULONG> mReferenceCount = 0;
+    ComPtr<IDxcIncludeHandler> mIncludeHandler;
+    std::vector<DxcFileDependency>& mIncludedFiles;
+};
+} // namespace shadercompile
@@ -0,0 +1,242 @@
+#include "shadercompile/dxc_server_compiler.h"
+
+#include "compile_server_connection.h"
+#include "compile_server_protocol.h"
+#include "utility.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+#include <string>
+
+namespace shadercompile
+{
+namespace
+{
+[[nodiscard]] std::wstring makeAbsolutePath(std::wstring_view path)
+{
+    std::error_code errorCode;
+    std::filesystem::path absolutePath = std::filesystem::absolute(std::filesystem::path(path), errorCode);
+
+    return errorCode ? std::wstring(path) : absolutePath.lexically_normal().wstring();
+}
+
+// the daemon runs in its own working directory, so include directories given relative to ours would not resolve
+void makeIncludeDirectoriesAbsolute(std::vector<std::string>& arguments)
+{
+    for(size_t index = 0; index < arguments.size(); ++index)
+    {
+        std::string& argument = arguments[index];
+
+        if(argument.size() < 2 || (argument[0] != '-' && argument[0] != '/') || argument[1] != 'I') { continue; }
+
+        if(argument.size() == 2)
+        {
+            if(index + 1 < arguments.size())
+            {
+                arguments[index + 1] = utf8Encode(makeAbsolutePath(utf8Decode(arguments[index + 1])));
+                ++index;
+            }
+        }
+        else { argument = argument.substr(0, 2) + utf8Encode(makeAbsolutePath(utf8Decode(argument.substr(2)))); }
+    }
+}
+} // namespace
+
+DxcServerCompiler::DxcServerCompiler(std::filesystem::path serverPath)
+{
+    mConnection = std::make_unique<CompileServerConnection>(std::move(serverPath));
+}
+
+DxcServerCompiler::DxcServerCompiler(std::unique_ptr<CompileServerConnection> connection)
+    : mConnection(std::move(connection))
+{}
+
+DxcServerCompiler::~DxcServerCompiler() = default;
+
+void DxcServerCompiler::addArgument(std::string_view arg)
+{
+    mArguments.push_back(utf8Decode(arg));
+}
+
+void DxcServerCompiler::addArguments(std::span<const std::string> args)
+{
+    mArguments.reserve(mArguments.size() + args.size());
+
+    for(const std::string& arg : args)
+    {
+        mArguments.push_back(utf8Decode(arg));
+    }
+}
+
+void DxcServerCompiler::addArguments(std::span<std::string_view> args)
+{
+    mArguments.reserve(mArguments.size() + args.size());
+
+    for(const std::string_view arg : args)
+    {
+        mArguments.push_back(utf8Decode(arg));
+    }
+}
+
+void DxcServerCompiler::addArgument(std::wstring_view arg)
+{
+    mArguments.emplace_back(arg);
+}
+
+void DxcServerCompiler::addArguments(std::span<const std::wstring> args)
+{
+    mArguments.insert(mArguments.end(), args.begin(), args.end());
+}
+
+void DxcServerCompiler::addArguments(std::span<std::wstring_view> args)
+{
+    mArguments.reserve(mArguments.size() + args.size());
+
+    for(const std::wstring_view arg : args)
+    {
+        mArguments.emplace_back(arg);
+    }
+}
+
+void DxcServerCompiler::reset() noexcept
+{
+    BaseDxcCompiler::reset();
+    mArguments.clear();
+}
+
+tl::expected<CompileSummary, std::errc>
+DxcServerCompiler::compileFromFileImpl(const std::filesystem::path& shaderFilePath)
+{
+    detail::CompileServerRequest request;
+    request.sourceKind = detail::CompileServerSourceKind::File;
+    request.sourceName = connectsToDaemon() ? utf8Encode(makeAbsolutePath(shaderFilePath.wstring()))
+                                            : utf8Encode(shaderFilePath.wstring());
+
+    return compile(request);
+}
+
+tl::expected<CompileSummary, std::errc>
+DxcServerCompiler::compileFromBufferImpl(std::span<const std::byte> shaderSource, std::wstring_view shaderSourceName)
+{
+    detail::CompileServerRequest request;
+    request.sourceKind = detail::CompileServerSourceKind::Buffer;
+    // the name locates the includes that are relative to the source
+    request.sourceName = (connectsToDaemon() && !shaderSourceName.empty())
+                             ? utf8Encode(makeAbsolutePath(shaderSourceName))
+                             : utf8Encode(shaderSourceName);
+    request.source.assign(shaderSource.begin(), shaderSource.end());
+
+    return compile(request);
+}
+
+bool DxcServerCompiler::connectsToDaemon() const noexcept
+{
+    return mConnection->endpoint() == CompileServerConnection::Endpoint::Daemon;
+}
+
+tl::expected<CompileSummary, std::errc> DxcServerCompiler::compile(detail::CompileServerRequest& request)
+{
+    request.arguments.reserve(mArguments.size());
+    request.maxMessageCount = mMaxMessageCount;
+
+    for(const std::wstring& argument : mArguments)
+    {
+        request.arguments.push_back(utf8Encode(argument));
+    }
+
+    if(connectsToDaemon()) { makeIncludeDirectoriesAbsolute(request.arguments); }
+
+    forEachEnum<DxcArtifactType>(mArtifacts,
+                                 [&](DxcArtifactType type, const DxcArtifact& artifact)
+                                 {
+                                     detail::CompileServerArtifactSink& sink = request.artifacts[(size_t)type];
+                                     sink.sinkType = artifact.sinkType();
+
+                                     if(artifact.sinkType() == DxcSinkType::File)
+                                     {
+                                         sink.path = utf8Encode(std::filesystem::absolute(artifact.path()).wstring());
+                                     }
+                                 });
+
+    tl::expected<void, std::errc> startResult = mConnection->start();
+
+    if(!startResult) { return tl::make_unexpected(startResult.error()); }
+
+    detail::encodeCompileServerRequest(request, mFrameBuffer);
+
+    tl::expected<void, std::errc> exchangeResult = mConnection->writeFrame(mFrameBuffer);
+
+    if(exchangeResult) { exchangeResult = mConnection->readFrame(mFrameBuffer); }
+
+    if(!exchangeResult)
+    {
+        // the server went away mid request, most likely because the compiler crashed. Reap it so the next compile
+        // starts a fresh one.
+        mConnection->stop();
+        return tl::make_unexpected(exchangeResult.error());
+    }
+
+    tl::expected<detail::CompileServerResponse, std::errc> response =
+        detail::decodeCompileServerResponse(mFrameBuffer);
+
+    if(!response)
+    {
+        mConnection->stop();
+        return tl::make_unexpected(response.error());
+    }
+
+    if(response->error != std::errc{}) { return tl::make_unexpected(response->error); }
+
+    mCompilerMessages = std::move(response->messages);
+
+    forEachEnum<DxcArtifactType>(mArtifacts,
+                                 [&](DxcArtifactType type, DxcArtifact& artifact)
+                                 {
+                                     std::optional<std::vector<std::byte>>& buffer = response->artifacts[(size_t)type];
+
+                                     if(artifact.sinkType() != DxcSinkType::MemoryBuffer || !buffer) { return; }
+
+                                     artifact = DxcArtifact(std::move(buffer.value()));
+                                 });
+
+    CompileSummary summary;
+    summary.returnCode = response->returnCode;
+    summary.arguments = mArguments;
+    summary.messages = mCompilerMessages;
+    summary.errorCount = (int)mCompilerMessages.count(CompilerMessageType::Error);
+    summary.warningCount = (int)mCompilerMessages.count(CompilerMessageType::Warning);
+
+    return summary;
+}
+
+DxcDaemonCompiler::DxcDaemonCompiler(std::filesystem::path socketPath)
+    : DxcServerCompiler(std::make_unique<CompileServerConnection>(std::move(socketPath),
+                                                                  CompileServerConnection::Endpoint::Daemon))
+{}
+
+std::filesystem::path DxcDaemonCompiler::defaultSocketPath()
+{
+    const char* runtimeDirectory = std::getenv("XDG_RUNTIME_DIR");
+
+    if(runtimeDirectory != nullptr && runtimeDirectory[0] != '\0')
+    {
+        return std::filesystem::path(runtimeDirectory) / "shadercompile.sock";
+    }
+
+    std::error_code errorCode;
+    std::filesystem::path temporaryDirectory = std::filesystem::temp_directory_path(errorCode);
+
+    if(errorCode) { temporaryDirectory = std::filesystem::path("/tmp"); }
+
+#ifdef _WIN32
+    return temporaryDirectory / "shadercompile.sock";
+#else
+    // The temporary directory is shared between users, each of them gets their own daemon. Another user could still
+    // create the socket first, the connection only accepts a daemon run by the current user.
+    return temporaryDirectory / ("shadercompile-" + std::to_string(getuid()) + ".sock");
+#endif
+}
+} // namespace shadercompile
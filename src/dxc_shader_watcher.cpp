@@ -0,0 +1,265 @@
+#include "shadercompile/dxc_shader_watcher.h"
+
+#ifdef __linux__
+#include "file_watcher.h"
+#endif
+
+#include <unordered_set>
+#include <utility>
+
+namespace shadercompile
+{
+#ifdef __linux__
+struct DxcShaderWatcher::FileWatcherState
+{
+    FileWatcher fileWatcher;
+};
+#else
+struct DxcShaderWatcher::FileWatcherState
+{};
+#endif
+
+namespace
+{
+[[nodiscard]] std::filesystem::path requestSourcePath(const CompileRequest& request)
+{
+    return request.source.empty() ? request.sourcePath : std::filesystem::path(request.sourceName);
+}
+} // namespace
+
+DxcShaderWatcher::DxcShaderWatcher(DxcBatchCompiler::CompilerFactory compilerFactory,
+                                   ResultCallback resultCallback,
+                                   size_t threadCount)
+    : mDependencyGraph(std::make_shared<DxcDependencyGraph>())
+    , mBatchCompiler(
+          [compilerFactory = std::move(compilerFactory), dependencyGraph = mDependencyGraph]()
+          {
+              std::unique_ptr<detail::BaseDxcCompiler> compiler = compilerFactory();
+              if(compiler != nullptr) { compiler->setDependencyGraph(dependencyGraph); }
+              return compiler;
+          },
+          threadCount)
+    , mResultCallback(std::move(resultCallback))
+{}
+
+DxcShaderWatcher::~DxcShaderWatcher()
+{
+    stop();
+}
+
+void DxcShaderWatcher::setDebounceInterval(std::chrono::milliseconds debounceInterval)
+{
+    std::lock_guard lock(mMutex);
+    mDebounceInterval = debounceInterval;
+}
+
+DxcShaderWatcher::RequestId DxcShaderWatcher::watch(CompileRequest request)
+{
+    RequestId requestId;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        requestId = mNextRequestId++;
+        mRequests.insert_or_assign(requestId, WatchedRequest{.request = std::move(request)});
+    }
+
+#ifdef __linux__
+    if(running()) { mFileWatcherState->fileWatcher.wake(); }
+#endif
+
+    return requestId;
+}
+
+void DxcShaderWatcher::unwatch(RequestId requestId)
+{
+    std::lock_guard lock(mMutex);
+    mRequests.erase(requestId);
+}
+
+tl::expected<void, std::errc> DxcShaderWatcher::start()
+{
+#ifdef __linux__
+    if(running()) { return {}; }
+
+    tl::expected<FileWatcher, std::errc> fileWatcher = FileWatcher::create();
+
+    if(!fileWatcher) { return tl::make_unexpected(fileWatcher.error()); }
+
+    mFileWatcherState = std::make_unique<FileWatcherState>(FileWatcherState{std::move(fileWatcher.value())});
+
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = false;
+    }
+
+    mThread = std::thread(&DxcShaderWatcher::watcherMain, this);
+
+    return {};
+#else
+    return tl::make_unexpected(std::errc::not_supported);
+#endif
+}
+
+void DxcShaderWatcher::stop()
+{
+    if(!running()) { return; }
+
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+
+#ifdef __linux__
+    mFileWatcherState->fileWatcher.wake();
+#endif
+
+    mThread.join();
+    mFileWatcherState.reset();
+}
+
+bool DxcShaderWatcher::compileRequests(const std::vector<DxcRecordedCompile>& staleCompiles, bool filesChanged)
+{
+    std::unordered_set<std::filesystem::path::string_type> staleSources;
+
+    for(const DxcRecordedCompile& staleCompile : staleCompiles)
+    {
+        staleSources.insert(staleCompile.sourcePath.native());
+    }
+
+    std::vector<RequestId> requestIds;
+    std::vector<CompileRequest> requests;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        for(const auto& [requestId, watchedRequest] : mRequests)
+        {
+            const bool stale = staleSources.contains(requestSourcePath(watchedRequest.request).native());
+            const bool compile = (watchedRequest.state == RequestState::NotCompiled) ||
+                                 (filesChanged && watchedRequest.state == RequestState::Failed) ||
+                                 (stale && watchedRequest.state != RequestState::Failed);
+
+            if(!compile) { continue; }
+
+            requestIds.push_back(requestId);
+            requests.push_back(watchedRequest.request);
+        }
+    }
+
+    if(requests.empty()) { return false; }
+
+    std::vector<tl::expected<CompileResult, std::errc>> results = mBatchCompiler.compileBatch(requests);
+
+    for(size_t index = 0; index < requests.size(); ++index)
+    {
+        {
+            std::lock_guard lock(mMutex);
+
+            auto itr = mRequests.find(requestIds[index]);
+
+            // unwatched while it compiled
+            if(itr == mRequests.end()) { continue; }
+
+            // the compiler records the dependencies of exactly the compiles with a return code of 0
+            const bool upToDate = results[index] && results[index]->returnCode == 0;
+            itr->second.state = upToDate ? RequestState::UpToDate : RequestState::Failed;
+        }
+
+        mResultCallback(requestIds[index], requests[index], std::move(results[index]));
+    }
+
+    return true;
+}
+
+#ifdef __linux__
+void DxcShaderWatcher::watcherMain()
+{
+    FileWatcher& fileWatcher = mFileWatcherState->fileWatcher;
+    std::vector<std::filesystem::path> changedFiles;
+    bool compiled = false;
+
+    while(true)
+    {
+        std::chrono::milliseconds debounceInterval;
+
+        {
+            std::lock_guard lock(mMutex);
+
+            if(mStopping) { return; }
+
+            debounceInterval = mDebounceInterval;
+        }
+
+        // the requests watched since the last pass
+        compiled = compileRequests({}, false) || compiled;
+        watchDependencyDirectories();
+
+        // a dependency saved after a compile read it but before its directory was watched raised no event
+        while(compiled)
+        {
+            compiled = compileRequests(mDependencyGraph->findStaleCompiles(), false);
+
+            if(compiled) { watchDependencyDirectories(); }
+        }
+
+        changedFiles.clear();
+
+        tl::expected<FileWatcher::WaitResult, std::errc> waitResult =
+            fileWatcher.wait(std::chrono::milliseconds(-1), changedFiles);
+
+        if(!waitResult) { return; }
+
+        if(waitResult.value() == FileWatcher::WaitResult::Woken) { continue; }
+
+        bool overflowed = (waitResult.value() == FileWatcher::WaitResult::Overflowed);
+
+        // an editor saving several files produces a burst of changes, they are compiled together once it is over
+        while(waitResult && (waitResult.value() == FileWatcher::WaitResult::Changed ||
+                             waitResult.value() == FileWatcher::WaitResult::Overflowed))
+        {
+            waitResult = fileWatcher.wait(debounceInterval, changedFiles);
+            overflowed = overflowed || (waitResult && waitResult.value() == FileWatcher::WaitResult::Overflowed);
+        }
+
+        if(!waitResult) { return; }
+
+        const std::vector<DxcRecordedCompile> staleCompiles = overflowed
+                                                                  ? mDependencyGraph->findStaleCompiles()
+                                                                  : mDependencyGraph->findStaleCompiles(changedFiles);
+
+        compiled = compileRequests(staleCompiles, true);
+    }
+}
+
+void DxcShaderWatcher::watchDependencyDirectories()
+{
+    FileWatcher& fileWatcher = mFileWatcherState->fileWatcher;
+
+    std::vector<std::filesystem::path> files = mDependencyGraph->files();
+
+    {
+        std::lock_guard lock(mMutex);
+
+        // the source of a request that never compiled is not in the graph yet
+        for(const auto& [requestId, watchedRequest] : mRequests)
+        {
+            if(watchedRequest.request.source.empty())
+            {
+                std::error_code errorCode;
+                const std::filesystem::path sourcePath =
+                    std::filesystem::absolute(watchedRequest.request.sourcePath, errorCode);
+
+                if(!errorCode) { files.push_back(sourcePath.lexically_normal()); }
+            }
+        }
+    }
+
+    for(const std::filesystem::path& file : files)
+    {
+        // a directory that does not exist cannot hold a dependency yet, it is tried again after the next compile
+        fileWatcher.watchDirectory(file.parent_path());
+    }
+}
+#endif
+} // namespace shadercompile
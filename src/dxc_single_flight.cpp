@@ -0,0 +1,96 @@
+#include "shadercompile/dxc_single_flight.h"
+
+#include "compile_fingerprint.h"
+
+#include <utility>
+
+namespace shadercompile
+{
+tl::expected<DxcCompileKey, std::errc> DxcSingleFlight::computeKey(std::span<const std::byte> source,
+                                                                   const std::filesystem::path& sourcePath,
+                                                                   std::span<const std::wstring> arguments,
+                                                                   const DxcVersion& compilerVersion,
+                                                                   std::span<const DxcArtifactType> artifactTypes)
+{
+    tl::expected<DxcCompileKey, std::errc> key =
+        detail::computeCompileFingerprint(source, sourcePath, arguments, compilerVersion, artifactTypes, mIncludeCache);
+
+    if(!key) { mUncacheableCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return key;
+}
+
+DxcSingleFlight::Ticket DxcSingleFlight::join(const DxcCompileKey& key)
+{
+    Ticket ticket;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        auto [itr, inserted] = mFlights.try_emplace(key.hash);
+
+        if(inserted)
+        {
+            itr->second.inputs = key.inputs;
+            itr->second.result = itr->second.promise.get_future().share();
+        }
+        else if(itr->second.inputs != key.inputs)
+        {
+            // another compile whose hash collides is in flight, its result must not be shared with this one
+            std::promise<Entry> ownCompile;
+            ownCompile.set_value(nullptr);
+
+            ticket.result = ownCompile.get_future().share();
+            return ticket;
+        }
+
+        ticket.leader = inserted;
+        ticket.result = itr->second.result;
+    }
+
+    if(ticket.leader) { mLeaderCount.fetch_add(1, std::memory_order_relaxed); }
+    else { mFollowerCount.fetch_add(1, std::memory_order_relaxed); }
+
+    return ticket;
+}
+
+void DxcSingleFlight::complete(const DxcCompileKey& key, Entry entry)
+{
+    std::promise<Entry> promise;
+
+    {
+        std::lock_guard lock(mMutex);
+
+        auto itr = mFlights.find(key.hash);
+
+        if(itr == mFlights.end() || itr->second.inputs != key.inputs) { return; }
+
+        promise = std::move(itr->second.promise);
+        mFlights.erase(itr);
+    }
+
+    // the waiting compiles wake up outside of the lock, a compile joining from now on leads a new flight
+    promise.set_value(std::move(entry));
+}
+
+DxcSingleFlightStatistics DxcSingleFlight::statistics() const
+{
+    DxcSingleFlightStatistics statistics;
+    statistics.leaderCount = mLeaderCount.load(std::memory_order_relaxed);
+    statistics.followerCount = mFollowerCount.load(std::memory_order_relaxed);
+    statistics.uncacheableCount = mUncacheableCount.load(std::memory_order_relaxed);
+
+    std::lock_guard lock(mMutex);
+
+    statistics.inFlightCount = mFlights.size();
+
+    return statistics;
+}
+
+void DxcSingleFlight::resetStatistics() noexcept
+{
+    mLeaderCount.store(0, std::memory_order_relaxed);
+    mFollowerCount.store(0, std::memory_order_relaxed);
+    mUncacheableCount.store(0, std::memory_order_relaxed);
+}
+} // namespace shadercompile
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <tl/expected.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace shadercompile
+{
+// Reports changes to the files in a set of directories through inotify. Directories rather than files are watched, so
+// a file that an editor saves by writing a new file and renaming it over the old one is still seen.
+class FileWatcher
+{
+public:
+    enum class WaitResult
+    {
+        Changed,
+        // the kernel dropped events, any watched file may have changed
+        Overflowed,
+        TimedOut,
+        Woken
+    };
+
+    [[nodiscard]] static tl::expected<FileWatcher, std::errc> create();
+
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher(FileWatcher&& other) noexcept;
+    ~FileWatcher();
+
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    FileWatcher& operator=(FileWatcher&& other) noexcept;
+
+    // does nothing when the directory is already watched, a directory that is deleted stops being watched
+    tl::expected<void, std::errc> watchDirectory(const std::filesystem::path& directory);
+
+    // Waits until files change, timeout passes or wake() is called. A negative timeout waits forever. The changed
+    // files are appended to changedFiles, a file can be reported more than once.
+    [[nodiscard]] tl::expected<WaitResult, std::errc> wait(std::chrono::milliseconds timeout,
+                                                           std::vector<std::filesystem::path>& changedFiles);
+
+    // makes a wait() on another thread return WaitResult::Woken
+    void wake() noexcept;
+
+private:
+    FileWatcher(int inotifyDescriptor, int wakeDescriptor) noexcept
+        : mInotifyDescriptor(inotifyDescriptor)
+        , mWakeDescriptor(wakeDescriptor)
+    {}
+
+    void close() noexcept;
+
+    int mInotifyDescriptor = -1;
+    // an eventfd
+    int mWakeDescriptor = -1;
+    std::unordered_map<int, std::filesystem::path> mDirectories;
+    std::unordered_map<std::filesystem::path::string_type, int> mWatchDescriptors;
+};
+} // namespace shadercompile
+
+#endif
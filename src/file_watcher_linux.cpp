@@ -0,0 +1,165 @@
+#include "file_watcher.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+
+namespace shadercompile
+{
+namespace
+{
+// IN_CLOSE_WRITE rather than IN_MODIFY, so a save is reported once it is complete instead of once per write
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+} // namespace
+
+tl::expected<FileWatcher, std::errc> FileWatcher::create()
+{
+    const int inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if(inotifyDescriptor == -1) { return tl::make_unexpected(std::errc(errno)); }
+
+    const int wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(wakeDescriptor == -1)
+    {
+        const std::errc error = std::errc(errno);
+        ::close(inotifyDescriptor);
+        return tl::make_unexpected(error);
+    }
+
+    return FileWatcher(inotifyDescriptor, wakeDescriptor);
+}
+
+FileWatcher::FileWatcher(FileWatcher&& other) noexcept
+    : mInotifyDescriptor(std::exchange(other.mInotifyDescriptor, -1))
+    , mWakeDescriptor(std::exchange(other.mWakeDescriptor, -1))
+    , mDirectories(std::move(other.mDirectories))
+    , mWatchDescriptors(std::move(other.mWatchDescriptors))
+{}
+
+FileWatcher::~FileWatcher()
+{
+    close();
+}
+
+FileWatcher& FileWatcher::operator=(FileWatcher&& other) noexcept
+{
+    if(this != &other)
+    {
+        close();
+
+        mInotifyDescriptor = std::exchange(other.mInotifyDescriptor, -1);
+        mWakeDescriptor = std::exchange(other.mWakeDescriptor, -1);
+        mDirectories = std::move(other.mDirectories);
+        mWatchDescriptors = std::move(other.mWatchDescriptors);
+    }
+
+    return *this;
+}
+
+tl::expected<void, std::errc> FileWatcher::watchDirectory(const std::filesystem::path& directory)
+{
+    if(mWatchDescriptors.contains(directory.native())) { return {}; }
+
+    const int watchDescriptor = inotify_add_watch(mInotifyDescriptor, directory.c_str(), kWatchMask);
+
+    if(watchDescriptor == -1) { return tl::make_unexpected(std::errc(errno)); }
+
+    // a directory reached through two paths gets the same watch descriptor, the last path is reported
+    mDirectories.insert_or_assign(watchDescriptor, directory);
+    mWatchDescriptors.insert_or_assign(directory.native(), watchDescriptor);
+
+    return {};
+}
+
+tl::expected<FileWatcher::WaitResult, std::errc> FileWatcher::wait(std::chrono::milliseconds timeout,
+                                                                   std::vector<std::filesystem::path>& changedFiles)
+{
+    std::array<pollfd, 2> descriptors = {pollfd{.fd = mInotifyDescriptor, .events = POLLIN, .revents = 0},
+                                         pollfd{.fd = mWakeDescriptor, .events = POLLIN, .revents = 0}};
+
+    const int timeoutMilliseconds = (timeout.count() < 0) ? -1 : (int)timeout.count();
+
+    int readyCount;
+    while((readyCount = poll(descriptors.data(), descriptors.size(), timeoutMilliseconds)) == -1)
+    {
+        if(errno != EINTR) { return tl::make_unexpected(std::errc(errno)); }
+    }
+
+    if(readyCount == 0) { return WaitResult::TimedOut; }
+
+    if((descriptors[1].revents & POLLIN) != 0)
+    {
+        uint64_t wakeCount;
+        [[maybe_unused]] const ssize_t bytesRead = read(mWakeDescriptor, &wakeCount, sizeof(wakeCount));
+
+        return WaitResult::Woken;
+    }
+
+    WaitResult result = WaitResult::Changed;
+
+    alignas(inotify_event) std::array<char, 16 * 1024> buffer;
+
+    while(true)
+    {
+        const ssize_t bytesRead = read(mInotifyDescriptor, buffer.data(), buffer.size());
+
+        if(bytesRead == -1)
+        {
+            if(errno == EINTR) { continue; }
+            if(errno == EAGAIN) { break; }
+            return tl::make_unexpected(std::errc(errno));
+        }
+
+        for(ssize_t offset = 0; offset < bytesRead;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += (ssize_t)(sizeof(inotify_event) + event->len);
+
+            if((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                result = WaitResult::Overflowed;
+                continue;
+            }
+
+            auto directoryItr = mDirectories.find(event->wd);
+
+            if(directoryItr == mDirectories.end()) { continue; }
+
+            if((event->mask & IN_IGNORED) != 0)
+            {
+                mWatchDescriptors.erase(directoryItr->second.native());
+                mDirectories.erase(directoryItr);
+                continue;
+            }
+
+            if(event->len != 0) { changedFiles.push_back(directoryItr->second / event->name); }
+        }
+    }
+
+    return result;
+}
+
+void FileWatcher::wake() noexcept
+{
+    const uint64_t increment = 1;
+    [[maybe_unused]] const ssize_t bytesWritten = write(mWakeDescriptor, &increment, sizeof(increment));
+}
+
+void FileWatcher::close() noexcept
+{
+    if(mInotifyDescriptor != -1) { ::close(mInotifyDescriptor); }
+    if(mWakeDescriptor != -1) { ::close(mWakeDescriptor); }
+
+    mInotifyDescriptor = -1;
+    mWakeDescriptor = -1;
+    mDirectories.clear();
+    mWatchDescriptors.clear();
+}
+} // namespace shadercompile
@@ -0,0 +1,199 @@
+#include "include_scanner.h"
+
+#include <shadercompile/dxc_dependency_graph.h>
+#include <shadercompile/dxc_include_cache.h>
+
+#include <array>
+#include <bit>
+#include <functional>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace shadercompile::detail
+{
+namespace
+{
+struct IncludeDirective
+{
+    std::string_view name;
+    bool angled = false;
+};
+
+[[nodiscard]] size_t skipHorizontalWhiteSpace(std::string_view text, size_t offset)
+{
+    while(offset < text.size() && (text[offset] == ' ' || text[offset] == '\t'))
+    {
+        ++offset;
+    }
+
+    return offset;
+}
+
+// Collects the #include directives of text. Returns false when a directive does not name its file with a literal.
+[[nodiscard]] bool findIncludeDirectives(std::string_view text, std::vector<IncludeDirective>& directives)
+{
+    using namespace std::string_view_literals;
+
+    size_t lineStart = 0;
+
+    while(lineStart < text.size())
+    {
+        size_t lineEnd = text.find('\n', lineStart);
+        if(lineEnd == std::string_view::npos) { lineEnd = text.size(); }
+
+        const std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        size_t offset = skipHorizontalWhiteSpace(line, 0);
+        if(offset == line.size() || line[offset] != '#') { continue; }
+
+        offset = skipHorizontalWhiteSpace(line, offset + 1);
+        if(!line.substr(offset).starts_with("include"sv)) { continue; }
+
+        offset = skipHorizontalWhiteSpace(line, offset + "include"sv.size());
+        if(offset == line.size()) { return false; }
+
+        const char open = line[offset];
+        const char close = (open == '<') ? '>' : '"';
+
+        if(open != '<' && open != '"') { return false; }
+
+        const size_t nameEnd = line.find(close, offset + 1);
+        if(nameEnd == std::string_view::npos) { return false; }
+
+        directives.push_back(
+            IncludeDirective{.name = line.substr(offset + 1, nameEnd - offset - 1), .angled = (open == '<')});
+    }
+
+    return true;
+}
+
+// calls the visitor once for every existing file that an #include directive could resolve to
+class IncludeDependencyWalker
+{
+public:
+    using Visitor = std::function<void(const std::filesystem::path& absolutePath, const DxcIncludeCache::File& file)>;
+
+    IncludeDependencyWalker(std::span<const std::filesystem::path> includeDirectories,
+                            DxcIncludeCache& includeCache,
+                            Visitor visitor)
+        : mIncludeDirectories(includeDirectories)
+        , mIncludeCache(includeCache)
+        , mVisitor(std::move(visitor))
+    {}
+
+    [[nodiscard]] tl::expected<void, std::errc> walkDependencies(std::span<const std::byte> contents,
+                                                                 const std::filesystem::path& includerDirectory)
+    {
+        std::vector<IncludeDirective> directives;
+
+        if(!findIncludeDirectives(std::string_view(reinterpret_cast<const char*>(contents.data()), contents.size()),
+                                  directives))
+        {
+            return tl::make_unexpected(std::errc::not_supported);
+        }
+
+        for(const IncludeDirective& directive : directives)
+        {
+            // the same search order as the compiler: the including file's directory for quoted includes, then the
+            // include directories, then the working directory
+            std::vector<std::filesystem::path> candidates;
+            const std::filesystem::path name(utf8Decode(directive.name));
+
+            if(name.is_absolute()) { candidates.push_back(name); }
+            else
+            {
+                if(!directive.angled) { candidates.push_back(includerDirectory / name); }
+
+                for(const std::filesystem::path& includeDirectory : mIncludeDirectories)
+                {
+                    candidates.push_back(includeDirectory / name);
+                }
+
+                candidates.push_back(name);
+            }
+
+            bool found = false;
+
+            for(const std::filesystem::path& candidate : candidates)
+            {
+                tl::expected<void, std::errc> result = visitFile(candidate);
+
+                if(result) { found = true; }
+                else if(result.error() != std::errc::no_such_file_or_directory) { return result; }
+            }
+
+            if(!found) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+        }
+
+        return {};
+    }
+
+private:
+    [[nodiscard]] tl::expected<void, std::errc> visitFile(const std::filesystem::path& path)
+    {
+        std::error_code errorCode;
+        const std::filesystem::path absolutePath = std::filesystem::absolute(path, errorCode).lexically_normal();
+
+        if(errorCode) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+        if(mVisited.contains(absolutePath.native())) { return {}; }
+
+        tl::expected<DxcIncludeCache::File, std::errc> file = mIncludeCache.loadFile(absolutePath);
+
+        if(!file) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+        mVisited.insert(absolutePath.native());
+
+        mVisitor(absolutePath, file.value());
+
+        return walkDependencies(*file->contents, absolutePath.parent_path());
+    }
+
+    std::span<const std::filesystem::path> mIncludeDirectories;
+    DxcIncludeCache& mIncludeCache;
+    Visitor mVisitor;
+    std::unordered_set<std::filesystem::path::string_type> mVisited;
+};
+} // namespace
+
+tl::expected<void, std::errc> appendIncludeDependencyInputs(std::span<const std::byte> source,
+                                                            const std::filesystem::path& sourcePath,
+                                                            std::span<const std::filesystem::path> includeDirectories,
+                                                            DxcIncludeCache& includeCache,
+                                                            std::string& inputs)
+{
+    IncludeDependencyWalker walker(
+        includeDirectories,
+        includeCache,
+        [&](const std::filesystem::path& absolutePath, const DxcIncludeCache::File& file)
+        {
+            // the contents themselves, like the source's, so that headers whose hashes collide still differ
+            const std::vector<std::byte>& contents = *file.contents;
+            const auto contentsSize = std::bit_cast<std::array<char, sizeof(uint64_t)>>((uint64_t)contents.size());
+
+            inputs.append(utf8Encode(absolutePath.wstring()));
+            inputs.push_back('\0');
+            inputs.append(contentsSize.data(), contentsSize.size());
+            inputs.append(reinterpret_cast<const char*>(contents.data()), contents.size());
+        });
+
+    return walker.walkDependencies(source, sourcePath.parent_path());
+}
+
+tl::expected<void, std::errc> collectIncludeDependencies(std::span<const std::byte> source,
+                                                         const std::filesystem::path& sourcePath,
+                                                         std::span<const std::filesystem::path> includeDirectories,
+                                                         DxcIncludeCache& includeCache,
+                                                         std::vector<DxcFileDependency>& dependencies)
+{
+    IncludeDependencyWalker walker(
+        includeDirectories,
+        includeCache,
+        [&](const std::filesystem::path& absolutePath, const DxcIncludeCache::File& file)
+        { dependencies.push_back(DxcFileDependency{.path = absolutePath, .contentHash = file.contentHash}); });
+
+    return walker.walkDependencies(source, sourcePath.parent_path());
+}
+} // namespace shadercompile::detail
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "utility.h"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+class DxcIncludeCache;
+struct DxcFileDependency;
+
+namespace detail
+{
+// Appends every file that the #include directives of source, and of the files they include, could resolve to to
+// inputs: for each directive every existing candidate in the search order contributes its null terminated path and its
+// size prefixed contents. This is conservative, a header added earlier in the search order or a change inside an
+// #if 0 block changes the inputs too.
+// Fails with std::errc::not_supported when a directive names its file through a macro and with
+// std::errc::no_such_file_or_directory when no candidate exists, in both cases the dependencies are unknown.
+[[nodiscard]] tl::expected<void, std::errc>
+appendIncludeDependencyInputs(std::span<const std::byte> source,
+                              const std::filesystem::path& sourcePath,
+                              std::span<const std::filesystem::path> includeDirectories,
+                              DxcIncludeCache& includeCache,
+                              std::string& inputs);
+
+// Appends the absolute path and the content hash of every file that appendIncludeDependencyInputs() would append, with
+// the same conservative candidate search and the same errors. On an error the files found so far are still appended.
+[[nodiscard]] tl::expected<void, std::errc>
+collectIncludeDependencies(std::span<const std::byte> source,
+                           const std::filesystem::path& sourcePath,
+                           std::span<const std::filesystem::path> includeDirectories,
+                           DxcIncludeCache& includeCache,
+                           std::vector<DxcFileDependency>& dependencies);
+} // namespace detail
+} // namespace shadercompile
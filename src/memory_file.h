@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <system_error>
+
+namespace shadercompile
+{
+// An anonymous file that only lives in memory (memfd). It is visible to this process, and to any child that inherits
+// the descriptor, through path().
+class MemoryFile
+{
+public:
+    [[nodiscard]] static tl::expected<MemoryFile, std::errc> create(const char* debugName);
+
+    MemoryFile() = default;
+    MemoryFile(const MemoryFile&) = delete;
+    MemoryFile(MemoryFile&& other) noexcept;
+    ~MemoryFile();
+
+    MemoryFile& operator=(const MemoryFile&) = delete;
+    MemoryFile& operator=(MemoryFile&& other) noexcept;
+
+    [[nodiscard]] int fileDescriptor() const noexcept { return mFileDescriptor; }
+
+    // /proc/self/fd/<n>, which resolves in any process holding the descriptor under the same number
+    [[nodiscard]] std::filesystem::path path() const;
+
+    tl::expected<void, std::errc> write(std::span<const std::byte> bytes);
+
+private:
+    explicit MemoryFile(int fileDescriptor) noexcept
+        : mFileDescriptor(fileDescriptor)
+    {}
+
+    int mFileDescriptor = -1;
+};
+} // namespace shadercompile
+
+#endif
@@ -0,0 +1,65 @@
+#include "memory_file.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <utility>
+
+namespace shadercompile
+{
+tl::expected<MemoryFile, std::errc> MemoryFile::create(const char* debugName)
+{
+    // close-on-exec so unrelated children never see the file; Process re-enables inheritance per child
+    const int fileDescriptor = memfd_create(debugName, MFD_CLOEXEC);
+
+    if(fileDescriptor == -1) { return tl::make_unexpected(std::errc(errno)); }
+
+    return MemoryFile(fileDescriptor);
+}
+
+MemoryFile::MemoryFile(MemoryFile&& other) noexcept
+    : mFileDescriptor(std::exchange(other.mFileDescriptor, -1))
+{}
+
+MemoryFile::~MemoryFile()
+{
+    if(mFileDescriptor != -1) { close(mFileDescriptor); }
+}
+
+MemoryFile& MemoryFile::operator=(MemoryFile&& other) noexcept
+{
+    if(this != &other)
+    {
+        if(mFileDescriptor != -1) { close(mFileDescriptor); }
+
+        mFileDescriptor = std::exchange(other.mFileDescriptor, -1);
+    }
+
+    return *this;
+}
+
+std::filesystem::path MemoryFile::path() const
+{
+    return std::filesystem::path("/proc/self/fd") / std::to_string(mFileDescriptor);
+}
+
+tl::expected<void, std::errc> MemoryFile::write(std::span<const std::byte> bytes)
+{
+    while(!bytes.empty())
+    {
+        const ssize_t bytesWritten = ::write(mFileDescriptor, bytes.data(), bytes.size());
+
+        if(bytesWritten < 0)
+        {
+            if(errno == EINTR) { continue; }
+            return tl::make_unexpected(std::errc(errno));
+        }
+
+        bytes = bytes.subspan(bytesWritten);
+    }
+
+    return {};
+}
+} // namespace shadercompile
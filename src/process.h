@@ -1,30 +1,59 @@
 #pragma once
 
+#include <shadercompile/dxc_job_server.h>
 #include <tl/expected.hpp>
 
+#include <chrono>
 #include <cstddef>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <span>
+#include <stop_token>
 #include <string>
 #include <system_error>
 #include <vector>
 
 namespace shadercompile
 {
+// limits of zero are not applied
+struct ProcessLimits
+{
+    std::chrono::milliseconds wallClockTimeout{0};
+    std::chrono::seconds cpuTime{0};
+    size_t addressSpaceBytes = 0;
+};
+
+enum class ProcessTermination
+{
+    Exited,
+    TimedOut,
+    CpuTimeLimitExceeded,
+    // the child crashed while an address space limit was set, which is almost always an allocation the limit refused
+    MemoryLimitExceeded,
+    // kill() ended the child
+    Killed
+};
+
 class Process
 {
 public:
+    // a chunk of output as it was read, it only lives for the call
+    using OutputCallback = std::function<void(std::span<const std::byte> chunk)>;
+
     Process() = default;
     explicit Process(std::string_view command);
     explicit Process(std::wstring_view command);
     explicit Process(std::wstring command);
     explicit Process(const std::filesystem::path& command);
     Process(const Process&) = delete;
-    Process(Process&&) = default;
+    // the moved-from process owns no child and no handles
+    Process(Process&& other);
     ~Process();
 
     Process& operator=(const Process&) = delete;
-    Process& operator=(Process&&) = default;
+    Process& operator=(Process&& other);
 
     void addArgument(std::string_view arg);
     void addArgument(std::wstring_view arg);
@@ -47,27 +76,104 @@ public:
 
     void clearOutput() { mOutput.clear(); }
 
+    // The timeout kills the child and the processes it started. The CPU time and address space limits are set on the
+    // child with prlimit, they are only supported on Linux and fail execute() and start() with std::errc::not_supported
+    // elsewhere.
+    void setLimits(const ProcessLimits& limits) { mLimits = limits; }
+
+    [[nodiscard]] const ProcessLimits& limits() const noexcept { return mLimits; }
+
+    // execute() holds a token of jobServer while the child runs, nullptr runs it right away
+    void setJobServer(std::shared_ptr<DxcJobServer> jobServer) { mJobServer = std::move(jobServer); }
+
+    [[nodiscard]] const std::shared_ptr<DxcJobServer>& jobServer() const noexcept { return mJobServer; }
+
+    // Called by readChildOutput() with every chunk it appends to output(), on the thread that reads. It may call
+    // kill(), the output that follows is still read.
+    void setOutputCallback(OutputCallback callback) { mOutputCallback = std::move(callback); }
+
+    // why the last child ended, its exit code alone cannot tell a limit apart from a crash
+    [[nodiscard]] ProcessTermination termination() const noexcept { return mTermination; }
+
+#ifndef _WIN32
+    // keeps fileDescriptor open under the same number in the child, even if it is marked close-on-exec
+    void inheritFileDescriptor(int fileDescriptor) { mInheritedFileDescriptors.push_back(fileDescriptor); }
+
+    void clearInheritedFileDescriptors() { mInheritedFileDescriptors.clear(); }
+#endif
+
     [[nodiscard]] std::span<const std::wstring> arguments() const noexcept { return mArguments; }
 
     [[nodiscard]] std::wstring_view command() const noexcept { return mCommand; }
 
-    tl::expected<int, std::errc> execute();
+    // Stopping cancellationToken terminates the child, which makes execute() fail with std::errc::operation_canceled.
+    // A child that already exited on its own keeps its return code.
+    tl::expected<int, std::errc> execute(std::stop_token cancellationToken = {});
 
     [[nodiscard]] std::span<const std::byte> output() const& { return mOutput; }
 
     [[nodiscard]] std::vector<std::byte>& output() && { return mOutput; }
 
+#ifndef _WIN32
+    // For event loops that supervise many children at once. start() spawns the child and returns right away. The loop
+    // waits for outputFileDescriptor() to become readable and calls readChildOutput() until it returns false, which
+    // happens once the child closed its output. Then it calls tryReap() until it returns the exit code. No job server
+    // token is taken.
+    tl::expected<void, std::errc> start();
+
+    [[nodiscard]] int outputFileDescriptor() const noexcept { return mChildStdOutRead; }
+
+    // std::nullopt while the child is still running
+    [[nodiscard]] std::optional<tl::expected<int, std::errc>> tryReap();
+
+    // the time at which the timeout expires, time_point::max() without one
+    [[nodiscard]] std::chrono::steady_clock::time_point deadline() const noexcept { return mDeadline; }
+
+    // kills the child once now is past the deadline, the event loop has to call it since nothing else will
+    bool killIfTimedOut(std::chrono::steady_clock::time_point now) noexcept;
+#endif
+
+    // appends what the child has written so far to output(), returns false once the child closed its output
+    bool readChildOutput();
+
+    // Kills the child and the processes it started while it runs, it still has to be reaped. A child started by
+    // execute() is reaped by execute(), which then returns the exit code of the killed child.
+    void kill() noexcept;
+
 private:
+    // closes the handles, on POSIX also reaps a child that was not reaped yet
+    void release();
+
     bool createStdIOHandles();
-    tl::expected<int, std::errc> createChildProcess();
 
-    void readChildOutput();
+#ifdef _WIN32
+    tl::expected<int, std::errc> createChildProcess(const std::stop_token& cancellationToken);
+#else
+    tl::expected<void, std::errc> createChildProcess();
+    tl::expected<int, std::errc> waitForChildProcess(const std::stop_token& cancellationToken);
+
+    [[nodiscard]] tl::expected<void, std::errc> applyResourceLimits(int processId) const;
+
+    // turns the wait status of the reaped child into its exit code and records why it ended
+    [[nodiscard]] int decodeExitStatus(int status);
+#endif
+
+#ifndef _WIN32
+    void closeStdIOHandles();
+#endif
 
     std::wstring mCommand;
     std::vector<std::wstring> mArguments;
     std::wstring mArgumentsString;
     std::vector<std::byte> mOutput;
+    OutputCallback mOutputCallback;
 
+    ProcessLimits mLimits;
+    std::shared_ptr<DxcJobServer> mJobServer;
+    ProcessTermination mTermination = ProcessTermination::Exited;
+    std::chrono::steady_clock::time_point mDeadline = std::chrono::steady_clock::time_point::max();
+
+#ifdef _WIN32
     void* mChildStdOutRead = nullptr;
     void* mChildStdOutWrite = nullptr;
     void* mChildStdInRead = nullptr;
@@ -75,5 +181,13 @@ private:
 
     void* mProcessHandle = nullptr;
     void* mThreadHandle = nullptr;
+#else
+    std::vector<int> mInheritedFileDescriptors;
+
+    int mChildStdOutRead = -1;
+    int mChildStdOutWrite = -1;
+
+    int mProcessId = -1;
+#endif
 };
 } // namespace shadercompile
\ No newline at end of file
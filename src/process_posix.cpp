@@ -0,0 +1,500 @@
+#include "process.h"
+
+#include "utility.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+extern char** environ;
+
+namespace shadercompile
+{
+namespace
+{
+// how often a child that closed its output is checked for exit while a deadline is set
+constexpr std::chrono::milliseconds kExitPollInterval{5};
+} // namespace
+
+Process::Process(std::string_view command)
+    : mCommand(utf8Decode(command))
+{}
+
+Process::Process(std::wstring_view command)
+    : mCommand(command)
+{}
+
+Process::Process(std::wstring command)
+    : mCommand(std::move(command))
+{}
+
+Process::Process(const std::filesystem::path& command)
+    : mCommand(command.wstring())
+{}
+
+Process::Process(Process&& other)
+{
+    *this = std::move(other);
+}
+
+Process::~Process()
+{
+    release();
+}
+
+Process& Process::operator=(Process&& other)
+{
+    if(this == &other) { return *this; }
+
+    release();
+
+    mCommand = std::move(other.mCommand);
+    mArguments = std::move(other.mArguments);
+    mArgumentsString = std::move(other.mArgumentsString);
+    mOutput = std::move(other.mOutput);
+    mOutputCallback = std::move(other.mOutputCallback);
+    mLimits = other.mLimits;
+    mJobServer = std::move(other.mJobServer);
+    mTermination = other.mTermination;
+    mDeadline = other.mDeadline;
+    mInheritedFileDescriptors = std::move(other.mInheritedFileDescriptors);
+
+    // the descriptors and the child belong to this process now, other must neither close nor reap them
+    mChildStdOutRead = std::exchange(other.mChildStdOutRead, -1);
+    mChildStdOutWrite = std::exchange(other.mChildStdOutWrite, -1);
+    mProcessId = std::exchange(other.mProcessId, -1);
+
+    return *this;
+}
+
+void Process::addArgument(std::string_view arg)
+{
+    mArguments.push_back(utf8Decode(arg));
+}
+
+void Process::addArgument(std::wstring_view arg)
+{
+    mArguments.emplace_back(arg);
+}
+
+void Process::addArgument(const std::string& arg)
+{
+    addArgument(std::string_view(arg));
+}
+
+void Process::addArgument(std::wstring arg)
+{
+    mArguments.push_back(std::move(arg));
+}
+
+void Process::addArgument(const std::filesystem::path& path)
+{
+    mArguments.push_back(path.wstring());
+}
+
+tl::expected<int, std::errc> Process::execute(std::stop_token cancellationToken)
+{
+    DxcJobServer::Token jobToken;
+
+    if(mJobServer != nullptr)
+    {
+        tl::expected<DxcJobServer::Token, std::errc> acquireResult = mJobServer->acquire(cancellationToken);
+
+        if(!acquireResult) { return tl::make_unexpected(acquireResult.error()); }
+
+        jobToken = std::move(acquireResult.value());
+    }
+
+    auto closeHandles = finally([this]() { closeStdIOHandles(); });
+
+    if(!createStdIOHandles()) { return tl::make_unexpected(std::errc::broken_pipe); }
+
+    tl::expected<void, std::errc> createResult = createChildProcess();
+
+    if(!createResult) { return tl::make_unexpected(createResult.error()); }
+
+    return waitForChildProcess(cancellationToken);
+}
+
+tl::expected<void, std::errc> Process::start()
+{
+    if(!createStdIOHandles())
+    {
+        closeStdIOHandles();
+        return tl::make_unexpected(std::errc::broken_pipe);
+    }
+
+    tl::expected<void, std::errc> createResult = createChildProcess();
+
+    if(!createResult) { closeStdIOHandles(); }
+
+    return createResult;
+}
+
+std::optional<tl::expected<int, std::errc>> Process::tryReap()
+{
+    if(mProcessId <= 0) { return tl::expected<int, std::errc>(tl::make_unexpected(std::errc::no_child_process)); }
+
+    int status = 0;
+    const pid_t waitResult = waitpid(mProcessId, &status, WNOHANG);
+
+    if(waitResult == 0 || (waitResult == -1 && errno == EINTR)) { return std::nullopt; }
+
+    mProcessId = -1;
+    closeStdIOHandles();
+
+    if(waitResult == -1) { return tl::expected<int, std::errc>(tl::make_unexpected(std::errc::no_child_process)); }
+
+    return decodeExitStatus(status);
+}
+
+void Process::release()
+{
+    closeStdIOHandles();
+
+    if(mProcessId > 0)
+    {
+        int status;
+        while(waitpid(mProcessId, &status, 0) == -1 && errno == EINTR) {}
+
+        mProcessId = -1;
+    }
+}
+
+void Process::kill() noexcept
+{
+    if(mProcessId <= 0) { return; }
+
+    ::kill(-mProcessId, SIGKILL);
+
+    if(mTermination == ProcessTermination::Exited) { mTermination = ProcessTermination::Killed; }
+}
+
+bool Process::killIfTimedOut(std::chrono::steady_clock::time_point now) noexcept
+{
+    if(mProcessId <= 0 || now < mDeadline) { return false; }
+
+    ::kill(-mProcessId, SIGKILL);
+    mTermination = ProcessTermination::TimedOut;
+    mDeadline = std::chrono::steady_clock::time_point::max();
+
+    return true;
+}
+
+bool Process::createStdIOHandles()
+{
+    closeStdIOHandles();
+
+    std::array<int, 2> pipeFds;
+
+    // both ends are close-on-exec so that children spawned concurrently from other threads do not inherit them. The
+    // write end is dup'ed onto the child's stdout and stderr, which clears the flag on the duplicates only.
+    if(pipe2(pipeFds.data(), O_CLOEXEC) != 0) { return false; }
+
+    mChildStdOutRead = pipeFds[0];
+    mChildStdOutWrite = pipeFds[1];
+
+    const int flags = fcntl(mChildStdOutRead, F_GETFL);
+
+    if(flags == -1 || fcntl(mChildStdOutRead, F_SETFL, flags | O_NONBLOCK) == -1) { return false; }
+
+    return true;
+}
+
+void Process::closeStdIOHandles()
+{
+    if(mChildStdOutRead != -1)
+    {
+        close(mChildStdOutRead);
+        mChildStdOutRead = -1;
+    }
+
+    if(mChildStdOutWrite != -1)
+    {
+        close(mChildStdOutWrite);
+        mChildStdOutWrite = -1;
+    }
+}
+
+tl::expected<void, std::errc> Process::createChildProcess()
+{
+    mTermination = ProcessTermination::Exited;
+    mDeadline = std::chrono::steady_clock::time_point::max();
+
+#ifndef __linux__
+    if(mLimits.cpuTime.count() > 0 || mLimits.addressSpaceBytes != 0)
+    {
+        return tl::make_unexpected(std::errc::not_supported);
+    }
+#endif
+
+    const std::string command = utf8Encode(mCommand);
+
+    std::vector<std::string> utf8Arguments;
+    utf8Arguments.reserve(mArguments.size());
+
+    for(const std::wstring& arg : mArguments)
+    {
+        utf8Arguments.push_back(utf8Encode(arg));
+    }
+
+    std::vector<char*> argv;
+    argv.reserve(utf8Arguments.size() + 2);
+    argv.push_back(const_cast<char*>(command.c_str()));
+
+    for(std::string& arg : utf8Arguments)
+    {
+        argv.push_back(arg.data());
+    }
+
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t fileActions;
+    if(posix_spawn_file_actions_init(&fileActions) != 0) { return tl::make_unexpected(std::errc::not_enough_memory); }
+
+    auto destroyFileActions = finally([&]() { posix_spawn_file_actions_destroy(&fileActions); });
+
+    // stdout and stderr share a pipe, the same as the Win32 implementation, so that the interleaving of the compiler
+    // output is preserved
+    posix_spawn_file_actions_addopen(&fileActions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fileActions, mChildStdOutWrite, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, mChildStdOutWrite, STDERR_FILENO);
+
+    // dup2 onto the same descriptor only clears its close-on-exec flag
+    for(const int fileDescriptor : mInheritedFileDescriptors)
+    {
+        posix_spawn_file_actions_adddup2(&fileActions, fileDescriptor, fileDescriptor);
+    }
+
+    posix_spawnattr_t attributes;
+    if(posix_spawnattr_init(&attributes) != 0) { return tl::make_unexpected(std::errc::not_enough_memory); }
+
+    auto destroyAttributes = finally([&]() { posix_spawnattr_destroy(&attributes); });
+
+    // the child leads its own process group, so that a cancellation also kills the processes it started, which would
+    // otherwise keep the pipe open
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    pid_t processId;
+    const int spawnResult = posix_spawnp(&processId, command.c_str(), &fileActions, &attributes, argv.data(), environ);
+
+    if(spawnResult != 0) { return tl::make_unexpected(std::errc::invalid_argument); }
+
+    mProcessId = processId;
+
+    // the parent must drop its copy of the write end, otherwise the read end never reaches end-of-file
+    close(mChildStdOutWrite);
+    mChildStdOutWrite = -1;
+
+    // A child that cannot be limited does not run. It has only been running for the time it took to get here, which
+    // CPU time limits still account for.
+    if(tl::expected<void, std::errc> limitResult = applyResourceLimits(processId); !limitResult)
+    {
+        ::kill(-processId, SIGKILL);
+
+        int status;
+        while(waitpid(processId, &status, 0) == -1 && errno == EINTR) {}
+
+        mProcessId = -1;
+
+        return limitResult;
+    }
+
+    if(mLimits.wallClockTimeout.count() > 0)
+    {
+        mDeadline = std::chrono::steady_clock::now() + mLimits.wallClockTimeout;
+    }
+
+    return {};
+}
+
+tl::expected<void, std::errc> Process::applyResourceLimits([[maybe_unused]] int processId) const
+{
+#ifdef __linux__
+    if(mLimits.cpuTime.count() > 0)
+    {
+        // the soft limit raises SIGXCPU, the hard limit a second later kills a child that handles it
+        const rlim_t cpuSeconds = (rlim_t)mLimits.cpuTime.count();
+        const rlimit cpuLimit{.rlim_cur = cpuSeconds, .rlim_max = cpuSeconds + 1};
+
+        if(prlimit(processId, RLIMIT_CPU, &cpuLimit, nullptr) != 0) { return tl::make_unexpected(std::errc(errno)); }
+    }
+
+    if(mLimits.addressSpaceBytes != 0)
+    {
+        const rlimit addressSpaceLimit{.rlim_cur = (rlim_t)mLimits.addressSpaceBytes,
+                                       .rlim_max = (rlim_t)mLimits.addressSpaceBytes};
+
+        if(prlimit(processId, RLIMIT_AS, &addressSpaceLimit, nullptr) != 0)
+        {
+            return tl::make_unexpected(std::errc(errno));
+        }
+    }
+#endif
+
+    return {};
+}
+
+int Process::decodeExitStatus(int status)
+{
+    if(WIFEXITED(status)) { return WEXITSTATUS(status); }
+
+    if(!WIFSIGNALED(status)) { return 0; }
+
+    const int signal = WTERMSIG(status);
+
+    if(mTermination == ProcessTermination::Exited)
+    {
+        if(mLimits.cpuTime.count() > 0 && (signal == SIGXCPU || signal == SIGKILL))
+        {
+            mTermination = ProcessTermination::CpuTimeLimitExceeded;
+        }
+        else if(mLimits.addressSpaceBytes != 0 && (signal == SIGABRT || signal == SIGSEGV || signal == SIGBUS))
+        {
+            mTermination = ProcessTermination::MemoryLimitExceeded;
+        }
+    }
+
+    // the same code a shell reports for a child killed by a signal
+    return 128 + signal;
+}
+
+tl::expected<int, std::errc> Process::waitForChildProcess(const std::stop_token& cancellationToken)
+{
+    const pid_t processId = mProcessId;
+
+    // Killing the child closes its end of the pipe, which ends the loop below. The child is only reaped once it can no
+    // longer be killed from here, so its process id cannot belong to another process by then.
+    std::mutex killMutex;
+    bool exited = false;
+    bool killed = false;
+
+    std::stop_callback killOnCancel(cancellationToken,
+                                    [&]()
+                                    {
+                                        std::lock_guard lock(killMutex);
+
+                                        if(exited) { return; }
+
+                                        ::kill(-processId, SIGKILL);
+                                        killed = true;
+                                    });
+
+    // Block until there is output to drain or the child closes its end of the pipe, which happens when it exits. There
+    // is no polling interval, so the call returns as soon as the child is gone. With a timeout the wait ends at the
+    // deadline at the latest, after which the killed child closes the pipe.
+    for(;;)
+    {
+        pollfd pollFd{.fd = mChildStdOutRead, .events = POLLIN, .revents = 0};
+
+        int timeout = -1;
+
+        if(mDeadline != std::chrono::steady_clock::time_point::max())
+        {
+            const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(mDeadline -
+                                                                                std::chrono::steady_clock::now());
+            timeout = (int)std::max<std::chrono::milliseconds::rep>(remaining.count(), 0);
+        }
+
+        const int pollResult = poll(&pollFd, 1, timeout);
+
+        if(pollResult == -1)
+        {
+            if(errno == EINTR) { continue; }
+            break;
+        }
+
+        if(pollResult == 0)
+        {
+            killIfTimedOut(std::chrono::steady_clock::now());
+            continue;
+        }
+
+        if(!readChildOutput()) { break; }
+    }
+
+    // Waits for the child to exit without reaping it. A child can close its output and keep running, so the deadline
+    // still applies here, the wait checks for it in short slices until the child is killed or exits. Without a deadline
+    // the wait blocks, a cancellation kills the child, which ends it.
+    for(;;)
+    {
+        const bool hasDeadline = mDeadline != std::chrono::steady_clock::time_point::max();
+
+        siginfo_t exitInfo{};
+        const int waitResult = waitid(P_PID, processId, &exitInfo, WEXITED | WNOWAIT | (hasDeadline ? WNOHANG : 0));
+
+        if(waitResult == -1)
+        {
+            if(errno == EINTR) { continue; }
+            break;
+        }
+
+        // si_pid stays zero while a child waited for with WNOHANG still runs
+        if(exitInfo.si_pid != 0) { break; }
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if(killIfTimedOut(now)) { continue; }
+
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(mDeadline - now, kExitPollInterval));
+    }
+
+    {
+        std::lock_guard lock(killMutex);
+        exited = true;
+    }
+
+    int status = 0;
+    pid_t waitResult;
+
+    do
+    {
+        waitResult = waitpid(mProcessId, &status, 0);
+    } while(waitResult == -1 && errno == EINTR);
+
+    mProcessId = -1;
+
+    if(waitResult == -1) { return tl::make_unexpected(std::errc::no_child_process); }
+
+    if(killed) { return tl::make_unexpected(std::errc::operation_canceled); }
+
+    return decodeExitStatus(status);
+}
+
+bool Process::readChildOutput()
+{
+    std::array<std::byte, 4096> buffer;
+
+    for(;;)
+    {
+        const ssize_t bytesRead = read(mChildStdOutRead, buffer.data(), buffer.size());
+
+        if(bytesRead > 0)
+        {
+            mOutput.insert(mOutput.cend(), buffer.cbegin(), buffer.cbegin() + bytesRead);
+
+            if(mOutputCallback) { mOutputCallback(std::span<const std::byte>(buffer).first(bytesRead)); }
+
+            continue;
+        }
+
+        if(bytesRead == 0) { return false; }
+
+        if(errno == EINTR) { continue; }
+
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+} // namespace shadercompile
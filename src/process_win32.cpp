@@ -5,6 +5,8 @@
 #include <Windows.h>
 
 #include <array>
+#include <atomic>
+#include <utility>
 
 #ifdef UNICODE
 #define CHAR_LITERAL(x) L#x
@@ -78,19 +80,56 @@ Process::Process(const std::filesystem::path& command)
     : mCommand(command.native())
 {}
 
+Process::Process(Process&& other)
+{
+    *this = std::move(other);
+}
+
 Process::~Process()
 {
-    if(mChildStdOutRead != nullptr) { CloseHandle(mChildStdOutRead); }
+    release();
+}
+
+Process& Process::operator=(Process&& other)
+{
+    if(this == &other) { return *this; }
+
+    release();
+
+    mCommand = std::move(other.mCommand);
+    mArguments = std::move(other.mArguments);
+    mArgumentsString = std::move(other.mArgumentsString);
+    mOutput = std::move(other.mOutput);
+    mOutputCallback = std::move(other.mOutputCallback);
+    mLimits = other.mLimits;
+    mJobServer = std::move(other.mJobServer);
+    mTermination = other.mTermination;
+    mDeadline = other.mDeadline;
+
+    // the handles belong to this process now, other must not close them
+    mChildStdOutRead = std::exchange(other.mChildStdOutRead, nullptr);
+    mChildStdOutWrite = std::exchange(other.mChildStdOutWrite, nullptr);
+    mChildStdInRead = std::exchange(other.mChildStdInRead, nullptr);
+    mChildStdInWrite = std::exchange(other.mChildStdInWrite, nullptr);
+    mProcessHandle = std::exchange(other.mProcessHandle, nullptr);
+    mThreadHandle = std::exchange(other.mThreadHandle, nullptr);
+
+    return *this;
+}
+
+void Process::release()
+{
+    if(mChildStdOutRead != nullptr) { CloseHandle(std::exchange(mChildStdOutRead, nullptr)); }
 
-    if(mChildStdOutWrite != nullptr) { CloseHandle(mChildStdOutWrite); }
+    if(mChildStdOutWrite != nullptr) { CloseHandle(std::exchange(mChildStdOutWrite, nullptr)); }
 
-    if(mChildStdInRead != nullptr) { CloseHandle(mChildStdInRead); }
+    if(mChildStdInRead != nullptr) { CloseHandle(std::exchange(mChildStdInRead, nullptr)); }
 
-    if(mChildStdInWrite != nullptr) { CloseHandle(mChildStdInWrite); }
+    if(mChildStdInWrite != nullptr) { CloseHandle(std::exchange(mChildStdInWrite, nullptr)); }
 
-    if(mProcessHandle != nullptr) { CloseHandle(mProcessHandle); }
+    if(mProcessHandle != nullptr) { CloseHandle(std::exchange(mProcessHandle, nullptr)); }
 
-    if(mThreadHandle != nullptr) { CloseHandle(mThreadHandle); }
+    if(mThreadHandle != nullptr) { CloseHandle(std::exchange(mThreadHandle, nullptr)); }
 }
 
 void Process::addArgument(std::string_view arg)
@@ -118,11 +157,22 @@ void Process::addArgument(const std::filesystem::path& path)
     mArguments.emplace_back(path.native());
 }
 
-tl::expected<int, std::errc> Process::execute()
+tl::expected<int, std::errc> Process::execute(std::stop_token cancellationToken)
 {
+    DxcJobServer::Token jobToken;
+
+    if(mJobServer != nullptr)
+    {
+        tl::expected<DxcJobServer::Token, std::errc> acquireResult = mJobServer->acquire(cancellationToken);
+
+        if(!acquireResult) { return tl::make_unexpected(acquireResult.error()); }
+
+        jobToken = std::move(acquireResult.value());
+    }
+
     if(!createStdIOHandles()) { return tl::make_unexpected(std::errc::broken_pipe); }
 
-    return createChildProcess();
+    return createChildProcess(cancellationToken);
 }
 
 bool Process::createStdIOHandles()
@@ -143,8 +193,17 @@ bool Process::createStdIOHandles()
     return true;
 }
 
-tl::expected<int, std::errc> Process::createChildProcess()
+tl::expected<int, std::errc> Process::createChildProcess(const std::stop_token& cancellationToken)
 {
+    mTermination = ProcessTermination::Exited;
+    mDeadline = std::chrono::steady_clock::time_point::max();
+
+    // only the timeout is supported, limits would need a job object
+    if(mLimits.cpuTime.count() > 0 || mLimits.addressSpaceBytes != 0)
+    {
+        return tl::make_unexpected(std::errc::not_supported);
+    }
+
     STARTUPINFO startupInfo;
     ZeroMemory(&startupInfo, sizeof(startupInfo));
 
@@ -190,6 +249,21 @@ tl::expected<int, std::errc> Process::createChildProcess()
     mProcessHandle = processInfo.hProcess;
     mThreadHandle = processInfo.hThread;
 
+    if(mLimits.wallClockTimeout.count() > 0)
+    {
+        mDeadline = std::chrono::steady_clock::now() + mLimits.wallClockTimeout;
+    }
+
+    // The handle stays open until the process object is destroyed, so it cannot refer to another process, and
+    // terminating a process that already exited fails.
+    std::atomic<bool> terminated = false;
+
+    std::stop_callback terminateOnCancel(cancellationToken,
+                                         [&]()
+                                         {
+                                             if(TerminateProcess(mProcessHandle, 1)) { terminated = true; }
+                                         });
+
     for(;;)
     {
         readChildOutput();
@@ -202,15 +276,23 @@ tl::expected<int, std::errc> Process::createChildProcess()
             break;
         }
         else if(ret == WAIT_FAILED) { break; }
+
+        if(mTermination == ProcessTermination::Exited && std::chrono::steady_clock::now() >= mDeadline &&
+           TerminateProcess(mProcessHandle, 1))
+        {
+            mTermination = ProcessTermination::TimedOut;
+        }
     }
 
+    if(terminated) { return tl::make_unexpected(std::errc::operation_canceled); }
+
     DWORD exitCode;
     if(GetExitCodeProcess(mProcessHandle, &exitCode)) { return exitCode; }
 
     return 0;
 }
 
-void Process::readChildOutput()
+bool Process::readChildOutput()
 {
     std::array<std::byte, 4096> buffer;
 
@@ -219,15 +301,28 @@ void Process::readChildOutput()
         DWORD bytesRead = 0;
         DWORD bytesAvailable = 0;
 
-        if(!PeekNamedPipe(mChildStdOutRead, nullptr, 0, nullptr, &bytesAvailable, nullptr)) { return; }
+        if(!PeekNamedPipe(mChildStdOutRead, nullptr, 0, nullptr, &bytesAvailable, nullptr)) { return false; }
 
-        if(bytesAvailable == 0) { return; }
+        if(bytesAvailable == 0) { return true; }
 
         BOOL readSuccess = ReadFile(mChildStdOutRead, buffer.data(), (DWORD)buffer.size(), &bytesRead, nullptr);
 
-        if(!readSuccess || bytesRead == 0) { return; }
+        if(!readSuccess || bytesRead == 0) { return false; }
 
         mOutput.insert(mOutput.cend(), buffer.cbegin(), buffer.cbegin() + bytesRead);
+
+        if(mOutputCallback) { mOutputCallback(std::span<const std::byte>(buffer).first(bytesRead)); }
+    }
+}
+
+void Process::kill() noexcept
+{
+    if(mProcessHandle == nullptr) { return; }
+
+    // terminating a process that already exited fails
+    if(TerminateProcess(mProcessHandle, 1) && mTermination == ProcessTermination::Exited)
+    {
+        mTermination = ProcessTermination::Killed;
     }
 }
 
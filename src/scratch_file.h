@@ -0,0 +1,51 @@
+#pragma once
+
+#include "memory_file.h"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace shadercompile
+{
+// A short lived file handed to a child process as an output path. On Linux it is a memfd, elsewhere it is a
+// counter-named file in a per-process scratch directory under the temp directory. The file is removed when the object
+// is destroyed and the scratch directory is removed when the process exits.
+class ScratchFile
+{
+public:
+    [[nodiscard]] static tl::expected<ScratchFile, std::errc> create(std::wstring_view suffix);
+
+    ScratchFile(const ScratchFile&) = delete;
+    ScratchFile(ScratchFile&& other) noexcept;
+    ~ScratchFile();
+
+    ScratchFile& operator=(const ScratchFile&) = delete;
+    ScratchFile& operator=(ScratchFile&& other) noexcept;
+
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return mPath; }
+
+#ifdef __linux__
+    // the child must inherit this descriptor for path() to resolve
+    [[nodiscard]] int fileDescriptor() const noexcept { return mMemoryFile.fileDescriptor(); }
+#endif
+
+    // maps the file and copies out its contents
+    [[nodiscard]] tl::expected<std::vector<std::byte>, std::errc> read() const;
+
+private:
+    ScratchFile() = default;
+
+    void remove() noexcept;
+
+    std::filesystem::path mPath;
+
+#ifdef __linux__
+    MemoryFile mMemoryFile;
+#endif
+};
+} // namespace shadercompile
@@ -0,0 +1,164 @@
+#include "scratch_file.h"
+
+#include "utility.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace shadercompile
+{
+namespace
+{
+tl::expected<std::vector<std::byte>, std::errc> readMappedFile(int fileDescriptor)
+{
+    struct stat fileStat;
+    if(fstat(fileDescriptor, &fileStat) != 0) { return tl::make_unexpected(std::errc(errno)); }
+
+    const size_t size = (size_t)fileStat.st_size;
+
+    if(size == 0) { return std::vector<std::byte>(); }
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+    if(mapping == MAP_FAILED) { return tl::make_unexpected(std::errc(errno)); }
+
+    const auto* begin = static_cast<const std::byte*>(mapping);
+    std::vector<std::byte> contents(begin, begin + size);
+
+    munmap(mapping, size);
+
+    return contents;
+}
+
+#ifndef __linux__
+class ScratchDirectory
+{
+public:
+    ~ScratchDirectory()
+    {
+        if(mPath.empty()) { return; }
+
+        std::error_code errorCode;
+        std::filesystem::remove_all(mPath, errorCode);
+    }
+
+    tl::expected<std::filesystem::path, std::errc> makeFilePath(std::wstring_view suffix)
+    {
+        std::call_once(mCreateFlag,
+                       [this]()
+                       {
+                           std::error_code errorCode;
+                           std::filesystem::path path = std::filesystem::temp_directory_path(errorCode);
+
+                           if(errorCode) { return; }
+
+                           path /= "shadercompile-" + std::to_string(getpid());
+
+                           if(std::filesystem::create_directories(path, errorCode) || !errorCode)
+                           {
+                               mPath = std::move(path);
+                           }
+                       });
+
+        if(mPath.empty()) { return tl::make_unexpected(std::errc::io_error); }
+
+        std::wstring fileName = std::to_wstring(mCounter.fetch_add(1, std::memory_order_relaxed));
+        fileName.append(suffix);
+
+        return mPath / fileName;
+    }
+
+private:
+    std::once_flag mCreateFlag;
+    std::filesystem::path mPath;
+    std::atomic<uint64_t> mCounter = 0;
+};
+
+ScratchDirectory gScratchDirectory;
+#endif
+} // namespace
+
+tl::expected<ScratchFile, std::errc> ScratchFile::create(std::wstring_view suffix)
+{
+    ScratchFile scratchFile;
+
+#ifdef __linux__
+    const std::string debugName = "shadercompile-artifact" + utf8Encode(suffix);
+    tl::expected<MemoryFile, std::errc> memoryFile = MemoryFile::create(debugName.c_str());
+
+    if(!memoryFile) { return tl::make_unexpected(memoryFile.error()); }
+
+    scratchFile.mMemoryFile = std::move(memoryFile.value());
+    scratchFile.mPath = scratchFile.mMemoryFile.path();
+#else
+    tl::expected<std::filesystem::path, std::errc> path = gScratchDirectory.makeFilePath(suffix);
+
+    if(!path) { return tl::make_unexpected(path.error()); }
+
+    scratchFile.mPath = std::move(path.value());
+#endif
+
+    return scratchFile;
+}
+
+ScratchFile::ScratchFile(ScratchFile&& other) noexcept
+    : mPath(std::exchange(other.mPath, {}))
+#ifdef __linux__
+    , mMemoryFile(std::move(other.mMemoryFile))
+#endif
+{}
+
+ScratchFile::~ScratchFile()
+{
+    remove();
+}
+
+ScratchFile& ScratchFile::operator=(ScratchFile&& other) noexcept
+{
+    if(this != &other)
+    {
+        remove();
+        mPath = std::exchange(other.mPath, {});
+#ifdef __linux__
+        mMemoryFile = std::move(other.mMemoryFile);
+#endif
+    }
+
+    return *this;
+}
+
+void ScratchFile::remove() noexcept
+{
+#ifndef __linux__
+    // the memfd goes away with its descriptor, only real files need removing
+    if(!mPath.empty())
+    {
+        std::error_code errorCode;
+        std::filesystem::remove(mPath, errorCode);
+    }
+#endif
+}
+
+tl::expected<std::vector<std::byte>, std::errc> ScratchFile::read() const
+{
+#ifdef __linux__
+    return readMappedFile(mMemoryFile.fileDescriptor());
+#else
+    const int fileDescriptor = open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(fileDescriptor == -1) { return tl::make_unexpected(std::errc(errno)); }
+
+    auto closeFile = finally([&]() { close(fileDescriptor); });
+
+    return readMappedFile(fileDescriptor);
+#endif
+}
+} // namespace shadercompile
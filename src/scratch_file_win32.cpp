@@ -0,0 +1,139 @@
+#include "scratch_file.h"
+
+#include "utility.h"
+
+#include <Windows.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace shadercompile
+{
+namespace
+{
+class ScratchDirectory
+{
+public:
+    ~ScratchDirectory()
+    {
+        if(mPath.empty()) { return; }
+
+        std::error_code errorCode;
+        std::filesystem::remove_all(mPath, errorCode);
+    }
+
+    tl::expected<std::filesystem::path, std::errc> makeFilePath(std::wstring_view suffix)
+    {
+        std::call_once(mCreateFlag,
+                       [this]()
+                       {
+                           std::error_code errorCode;
+                           std::filesystem::path path = std::filesystem::temp_directory_path(errorCode);
+
+                           if(errorCode) { return; }
+
+                           path /= L"shadercompile-" + std::to_wstring(GetCurrentProcessId());
+
+                           if(std::filesystem::create_directories(path, errorCode) || !errorCode)
+                           {
+                               mPath = std::move(path);
+                           }
+                       });
+
+        if(mPath.empty()) { return tl::make_unexpected(std::errc::io_error); }
+
+        std::wstring fileName = std::to_wstring(mCounter.fetch_add(1, std::memory_order_relaxed));
+        fileName.append(suffix);
+
+        return mPath / fileName;
+    }
+
+private:
+    std::once_flag mCreateFlag;
+    std::filesystem::path mPath;
+    std::atomic<uint64_t> mCounter = 0;
+};
+
+ScratchDirectory gScratchDirectory;
+} // namespace
+
+tl::expected<ScratchFile, std::errc> ScratchFile::create(std::wstring_view suffix)
+{
+    tl::expected<std::filesystem::path, std::errc> path = gScratchDirectory.makeFilePath(suffix);
+
+    if(!path) { return tl::make_unexpected(path.error()); }
+
+    ScratchFile scratchFile;
+    scratchFile.mPath = std::move(path.value());
+
+    return scratchFile;
+}
+
+ScratchFile::ScratchFile(ScratchFile&& other) noexcept
+    : mPath(std::exchange(other.mPath, {}))
+{}
+
+ScratchFile::~ScratchFile()
+{
+    remove();
+}
+
+ScratchFile& ScratchFile::operator=(ScratchFile&& other) noexcept
+{
+    if(this != &other)
+    {
+        remove();
+        mPath = std::exchange(other.mPath, {});
+    }
+
+    return *this;
+}
+
+void ScratchFile::remove() noexcept
+{
+    if(mPath.empty()) { return; }
+
+    std::error_code errorCode;
+    std::filesystem::remove(mPath, errorCode);
+}
+
+tl::expected<std::vector<std::byte>, std::errc> ScratchFile::read() const
+{
+    HANDLE file = CreateFileW(mPath.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+
+    if(file == INVALID_HANDLE_VALUE) { return tl::make_unexpected(std::errc::no_such_file_or_directory); }
+
+    auto closeFile = finally([&]() { CloseHandle(file); });
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize)) { return tl::make_unexpected(std::errc::io_error); }
+
+    // a zero length file cannot be mapped
+    if(fileSize.QuadPart == 0) { return std::vector<std::byte>(); }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if(mapping == nullptr) { return tl::make_unexpected(std::errc::io_error); }
+
+    auto closeMapping = finally([&]() { CloseHandle(mapping); });
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if(view == nullptr) { return tl::make_unexpected(std::errc::io_error); }
+
+    const auto* begin = static_cast<const std::byte*>(view);
+    std::vector<std::byte> contents(begin, begin + fileSize.QuadPart);
+
+    UnmapViewOfFile(view);
+
+    return contents;
+}
+} // namespace shadercompile
@@ -1,12 +1,21 @@
 #include "utility.h"
 
+#ifdef _WIN32
 #include <combaseapi.h>
 #include <Windows.h>
 
 #include <format>
+#else
+#include <array>
+#include <charconv>
+#include <random>
+#endif
+
+#include <fstream>
 
 namespace shadercompile
 {
+#ifdef _WIN32
 void utf8Encode(std::wstring_view wideStr, std::string& outUtf8Str)
 {
     if(wideStr.empty()) { return; }
@@ -27,13 +36,6 @@ void utf8Encode(std::wstring_view wideStr, std::string& outUtf8Str)
                         nullptr);
 }
 
-std::string utf8Encode(std::wstring_view str)
-{
-    std::string utf8Str;
-    utf8Encode(str, utf8Str);
-    return utf8Str;
-}
-
 void utf8Decode(std::string_view utf8Str, std::wstring& outWideStr)
 {
     if(utf8Str.empty()) { return; }
@@ -52,13 +54,6 @@ void utf8Decode(std::string_view utf8Str, std::wstring& outWideStr)
                         wideCharCount);
 }
 
-std::wstring utf8Decode(std::string_view utf8Str)
-{
-    std::wstring wideStr;
-    utf8Decode(utf8Str, wideStr);
-    return wideStr;
-}
-
 tl::expected<std::filesystem::path, std::errc>
 createTemporaryFilePath(std::wstring_view fileNamePrefix, std::wstring_view fileNameSuffix, std::wstring_view extension)
 {
@@ -95,4 +90,178 @@ createTemporaryFilePath(std::wstring_view fileNamePrefix, std::wstring_view file
 
     return std::filesystem::path(tempPathStr) / fileName;
 }
+#else
+void utf8Encode(std::wstring_view wideStr, std::string& outUtf8Str)
+{
+    if(wideStr.empty()) { return; }
+
+    outUtf8Str.reserve(outUtf8Str.size() + wideStr.size());
+
+    for(const wchar_t wideChar : wideStr)
+    {
+        char32_t codePoint = static_cast<char32_t>(wideChar);
+
+        if(codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) { codePoint = 0xFFFD; }
+
+        if(codePoint < 0x80) { outUtf8Str.push_back(static_cast<char>(codePoint)); }
+        else if(codePoint < 0x800)
+        {
+            outUtf8Str.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if(codePoint < 0x10000)
+        {
+            outUtf8Str.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            outUtf8Str.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            outUtf8Str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+}
+
+void utf8Decode(std::string_view utf8Str, std::wstring& outWideStr)
+{
+    if(utf8Str.empty()) { return; }
+
+    outWideStr.reserve(outWideStr.size() + utf8Str.size());
+
+    size_t index = 0;
+
+    while(index < utf8Str.size())
+    {
+        const auto leadByte = static_cast<unsigned char>(utf8Str[index]);
+
+        size_t sequenceLength;
+        char32_t codePoint;
+
+        if(leadByte < 0x80)
+        {
+            sequenceLength = 1;
+            codePoint = leadByte;
+        }
+        else if((leadByte & 0xE0) == 0xC0)
+        {
+            sequenceLength = 2;
+            codePoint = leadByte & 0x1F;
+        }
+        else if((leadByte & 0xF0) == 0xE0)
+        {
+            sequenceLength = 3;
+            codePoint = leadByte & 0x0F;
+        }
+        else if((leadByte & 0xF8) == 0xF0)
+        {
+            sequenceLength = 4;
+            codePoint = leadByte & 0x07;
+        }
+        else
+        {
+            // invalid lead byte
+            outWideStr.push_back(L'\uFFFD');
+            ++index;
+            continue;
+        }
+
+        if(index + sequenceLength > utf8Str.size())
+        {
+            // truncated sequence
+            outWideStr.push_back(L'\uFFFD');
+            break;
+        }
+
+        bool valid = true;
+
+        for(size_t continuationIndex = 1; continuationIndex < sequenceLength; ++continuationIndex)
+        {
+            const auto continuationByte = static_cast<unsigned char>(utf8Str[index + continuationIndex]);
+
+            if((continuationByte & 0xC0) != 0x80)
+            {
+                valid = false;
+                sequenceLength = continuationIndex;
+                break;
+            }
+
+            codePoint = (codePoint << 6) | (continuationByte & 0x3F);
+        }
+
+        outWideStr.push_back(valid ? static_cast<wchar_t>(codePoint) : L'\uFFFD');
+        index += sequenceLength;
+    }
+}
+
+tl::expected<std::filesystem::path, std::errc>
+createTemporaryFilePath(std::wstring_view fileNamePrefix, std::wstring_view fileNameSuffix, std::wstring_view extension)
+{
+    thread_local std::mt19937_64 randomEngine(std::random_device{}());
+
+    std::array<char, 32> nameBuffer;
+    char* nameEnd = nameBuffer.data();
+
+    for(int i = 0; i < 2; ++i)
+    {
+        const std::uint64_t value = randomEngine();
+        const std::to_chars_result result = std::to_chars(nameEnd, nameBuffer.data() + nameBuffer.size(), value, 16);
+
+        if(result.ec != std::errc{}) { return tl::make_unexpected(std::errc::state_not_recoverable); }
+
+        nameEnd = result.ptr;
+    }
+
+    std::wstring fileName;
+    fileName.reserve(fileNamePrefix.size() + nameBuffer.size() + fileNameSuffix.size() + extension.size());
+    fileName.append(fileNamePrefix);
+    fileName.append(nameBuffer.data(), nameEnd);
+    fileName.append(fileNameSuffix);
+    fileName.append(extension);
+
+    std::error_code errorCode;
+    std::filesystem::path tempPath = std::filesystem::temp_directory_path(errorCode);
+
+    if(errorCode) { return tl::make_unexpected(std::errc::state_not_recoverable); }
+
+    return tempPath / fileName;
+}
+#endif
+
+std::string utf8Encode(std::wstring_view str)
+{
+    std::string utf8Str;
+    utf8Encode(str, utf8Str);
+    return utf8Str;
+}
+
+std::wstring utf8Decode(std::string_view utf8Str)
+{
+    std::wstring wideStr;
+    utf8Decode(utf8Str, wideStr);
+    return wideStr;
+}
+
+std::optional<std::vector<std::byte>> readFileContents(const std::filesystem::path& path)
+{
+    std::ifstream fileStream(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+
+    if(!fileStream.is_open()) { return std::nullopt; }
+
+    // a directory opens on some platforms and reports a size of -1 or a meaningless one
+    std::error_code errorCode;
+    const std::streamoff fileSize = fileStream.tellg();
+
+    if(fileSize < 0 || !std::filesystem::is_regular_file(path, errorCode)) { return std::nullopt; }
+
+    std::vector<std::byte> contents((size_t)fileSize);
+    fileStream.seekg(0);
+    fileStream.read(reinterpret_cast<char*>(contents.data()), (std::streamsize)contents.size());
+
+    if(!fileStream) { return std::nullopt; }
+
+    return contents;
+}
 } // namespace shadercompile
\ No newline at end of file
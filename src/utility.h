@@ -2,10 +2,14 @@
 
 #include <tl/expected.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace shadercompile
 {
@@ -61,6 +65,27 @@ struct Overloaded : Ts...
     using Ts::operator()...;
 };
 
+// 64-bit FNV-1a. Used to key caches by content; it is not collision resistant, so callers that depend on a match must
+// also compare the contents.
+class Fnv1aHash
+{
+public:
+    constexpr void update(std::span<const std::byte> bytes) noexcept
+    {
+        for(const std::byte byte : bytes)
+        {
+            mValue = (mValue ^ (uint64_t)byte) * 1099511628211ull;
+        }
+    }
+
+    void update(std::string_view str) noexcept { update(std::as_bytes(std::span<const char>(str))); }
+
+    [[nodiscard]] constexpr uint64_t value() const noexcept { return mValue; }
+
+private:
+    uint64_t mValue = 14695981039346656037ull;
+};
+
 void utf8Encode(std::wstring_view wideStr, std::string& outUtf8Str);
 
 std::string utf8Encode(std::wstring_view str);
@@ -69,6 +94,8 @@ void utf8Decode(std::string_view utf8Str, std::wstring& outWideStr);
 
 std::wstring utf8Decode(std::string_view utf8Str);
 
+[[nodiscard]] std::optional<std::vector<std::byte>> readFileContents(const std::filesystem::path& path);
+
 template<class CharT>
 struct CaseInsensitiveCharTraits : public std::char_traits<CharT>
 {
@@ -124,7 +151,8 @@ template<class CharT, size_t N, class CharTraitsU>
            std::basic_string_view<CharT, CaseInsensitiveCharTraits<CharT>>(right.data(), right.size());
 }
 
-template<std::output_iterator InsertIteratorT, class CharT, class CharTraitsT>
+template<class InsertIteratorT, class CharT, class CharTraitsT>
+    requires std::output_iterator<InsertIteratorT, CharT>
 void makeQuotedString(InsertIteratorT insertItr, std::basic_string_view<CharT, CharTraitsT> str)
 {
     if(!str.starts_with('"')) { insertItr++ = '"'; }
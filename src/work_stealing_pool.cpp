@@ -0,0 +1,141 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace shadercompile
+{
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+
+    mQueues.reserve(threadCount);
+
+    for(size_t workerIndex = 0; workerIndex < threadCount; ++workerIndex)
+    {
+        mQueues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    mThreads.reserve(threadCount);
+
+    for(size_t workerIndex = 0; workerIndex < threadCount; ++workerIndex)
+    {
+        mThreads.emplace_back([this, workerIndex]() { workerMain(workerIndex); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+
+    mWorkAvailable.notify_all();
+
+    for(std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::run(size_t count, Task task)
+{
+    if(count == 0) { return; }
+
+    std::lock_guard runLock(mRunMutex);
+
+    std::unique_lock lock(mMutex);
+
+    mTask = std::move(task);
+    mRemainingCount = count;
+
+    const size_t workerCount = mQueues.size();
+
+    for(size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+    {
+        const size_t begin = (count * workerIndex) / workerCount;
+        const size_t end = (count * (workerIndex + 1)) / workerCount;
+
+        std::lock_guard queueLock(mQueues[workerIndex]->mutex);
+
+        for(size_t index = begin; index < end; ++index)
+        {
+            mQueues[workerIndex]->indices.push_back(index);
+        }
+    }
+
+    ++mGeneration;
+    mWorkAvailable.notify_all();
+
+    mBatchFinished.wait(lock, [this]() { return mRemainingCount == 0; });
+
+    mTask = nullptr;
+}
+
+void WorkStealingPool::workerMain(size_t workerIndex)
+{
+    uint64_t generation = 0;
+
+    for(;;)
+    {
+        {
+            std::unique_lock lock(mMutex);
+            mWorkAvailable.wait(lock, [&]() { return mStopping || mGeneration != generation; });
+
+            if(mStopping) { return; }
+
+            generation = mGeneration;
+        }
+
+        // mTask is only written by run() while no batch is in flight, and every index popped here belongs to the
+        // current batch, so it can be called without holding mMutex
+        size_t completedCount = 0;
+        size_t index;
+
+        while(popOrSteal(workerIndex, index))
+        {
+            mTask(index, workerIndex);
+            ++completedCount;
+        }
+
+        if(completedCount == 0) { continue; }
+
+        std::lock_guard lock(mMutex);
+        mRemainingCount -= completedCount;
+
+        if(mRemainingCount == 0) { mBatchFinished.notify_all(); }
+    }
+}
+
+bool WorkStealingPool::popOrSteal(size_t workerIndex, size_t& index)
+{
+    {
+        WorkerQueue& queue = *mQueues[workerIndex];
+        std::lock_guard lock(queue.mutex);
+
+        if(!queue.indices.empty())
+        {
+            index = queue.indices.front();
+            queue.indices.pop_front();
+            return true;
+        }
+    }
+
+    const size_t workerCount = mQueues.size();
+
+    for(size_t offset = 1; offset < workerCount; ++offset)
+    {
+        WorkerQueue& victim = *mQueues[(workerIndex + offset) % workerCount];
+        std::lock_guard lock(victim.mutex);
+
+        if(!victim.indices.empty())
+        {
+            index = victim.indices.back();
+            victim.indices.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+} // namespace shadercompile
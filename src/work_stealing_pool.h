@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shadercompile
+{
+// A fixed set of worker threads that run batches of indexed tasks. Each batch is split into one contiguous block of
+// indices per worker. A worker drains its own block from the front and, once it is empty, steals from the back of the
+// other workers' blocks, so a few slow tasks do not leave the rest of the workers idle.
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void(size_t index, size_t workerIndex)>;
+
+    explicit WorkStealingPool(size_t threadCount);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    [[nodiscard]] size_t threadCount() const noexcept { return mThreads.size(); }
+
+    // Calls task(index, workerIndex) for every index in [0, count) and returns once all calls have finished.
+    // workerIndex is below threadCount() and no two calls with the same workerIndex run at the same time. Batches from
+    // different threads run one after another.
+    void run(size_t count, Task task);
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> indices;
+    };
+
+    void workerMain(size_t workerIndex);
+
+    [[nodiscard]] bool popOrSteal(size_t workerIndex, size_t& index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mRunMutex;
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mBatchFinished;
+    Task mTask;
+    uint64_t mGeneration = 0;
+    size_t mRemainingCount = 0;
+    bool mStopping = false;
+};
+} // namespace shadercompile
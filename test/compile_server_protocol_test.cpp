@@ -0,0 +1,246 @@
+#include "compile_server_protocol.h"
+
+#include <array>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace shadercompile;
+using namespace shadercompile::detail;
+
+// Encodes compile server requests and responses, decodes them again and checks that nothing was lost, that every
+// truncation of a frame is rejected and that a frame size over the limit is refused.
+
+namespace
+{
+constexpr size_t kFrameHeaderSize = 4;
+
+int gFailureCount = 0;
+
+void check(bool condition, std::string_view description)
+{
+    if(condition) { return; }
+
+    std::cout << "FAILED: " << description << std::endl;
+    ++gFailureCount;
+}
+
+std::vector<std::byte> toBytes(std::string_view text)
+{
+    const std::span<const std::byte> bytes = std::as_bytes(std::span(text));
+    return std::vector<std::byte>(bytes.begin(), bytes.end());
+}
+
+// checks the size prefix of frame and returns its payload
+std::span<const std::byte> framePayload(const std::vector<std::byte>& frame, std::string_view description)
+{
+    if(frame.size() < kFrameHeaderSize)
+    {
+        check(false, std::string(description) + ": the frame holds a size prefix");
+        return {};
+    }
+
+    const std::span<const std::byte> payload = std::span(frame).subspan(kFrameHeaderSize);
+    const std::optional<uint32_t> payloadSize =
+        decodeFrameSize(std::span<const std::byte, kFrameHeaderSize>(frame.data(), kFrameHeaderSize));
+
+    check(payloadSize.has_value() && payloadSize.value() == payload.size(),
+          std::string(description) + ": the size prefix is the size of the payload");
+
+    return payload;
+}
+
+CompileServerRequest makeRequest()
+{
+    CompileServerRequest request;
+    request.sourceKind = CompileServerSourceKind::File;
+    request.arguments = {"-T", "ps_6_0", "-E", "main", ""};
+    request.artifacts[(size_t)DxcArtifactType::Object] =
+        CompileServerArtifactSink{.sinkType = DxcSinkType::MemoryBuffer, .path = ""};
+    request.artifacts[(size_t)DxcArtifactType::Debug] =
+        CompileServerArtifactSink{.sinkType = DxcSinkType::File, .path = "shaders/pixel.pdb"};
+    request.sourceName = "shaders/pixel.hlsl";
+    request.source = toBytes("float4 main() : SV_Target { return 1; }");
+    request.maxMessageCount = 16;
+
+    return request;
+}
+
+CompileServerResponse makeResponse()
+{
+    const std::string text = "pixel.hlsl:3:5: warning: unused variable\npixel.hlsl:7:1: error: expected ';'\n";
+
+    CompilerMessages::Builder builder(text);
+
+    CompilerMessage warning;
+    warning.fullMessage = builder.text().substr(0, 40);
+    warning.line = 3;
+    warning.column = 5;
+    warning.filePathOffset = 0;
+    warning.filePathCount = 10;
+    warning.type = CompilerMessageType::Warning;
+    warning.messageOffset = 25;
+    warning.messageCount = 15;
+    builder.add(warning);
+
+    CompilerMessage error;
+    error.fullMessage = builder.text().substr(41, 35);
+    error.line = 7;
+    error.column = 1;
+    error.type = CompilerMessageType::Error;
+    builder.add(error);
+
+    builder.addDropped(CompilerMessageType::Warning, 3);
+
+    CompileServerResponse response;
+    response.returnCode = 1;
+    response.messages = std::move(builder).build();
+    response.artifacts[(size_t)DxcArtifactType::Object] = toBytes("DXBC");
+    response.artifacts[(size_t)DxcArtifactType::Debug] = std::vector<std::byte>();
+
+    return response;
+}
+
+bool equalMessages(const CompilerMessages& left, const CompilerMessages& right)
+{
+    if(left.size() != right.size() || left.totalCount() != right.totalCount()) { return false; }
+
+    for(size_t index = 0; index < left.size(); ++index)
+    {
+        const CompilerMessage leftMessage = left[index];
+        const CompilerMessage rightMessage = right[index];
+
+        if(leftMessage.fullMessage != rightMessage.fullMessage || leftMessage.line != rightMessage.line ||
+           leftMessage.column != rightMessage.column || leftMessage.filePathOffset != rightMessage.filePathOffset ||
+           leftMessage.filePathCount != rightMessage.filePathCount || leftMessage.type != rightMessage.type ||
+           leftMessage.messageOffset != rightMessage.messageOffset ||
+           leftMessage.messageCount != rightMessage.messageCount)
+        {
+            return false;
+        }
+    }
+
+    for(size_t typeIndex = 0; typeIndex < (size_t)CompilerMessageType::_count; ++typeIndex)
+    {
+        if(left.count((CompilerMessageType)typeIndex) != right.count((CompilerMessageType)typeIndex)) { return false; }
+    }
+
+    return true;
+}
+
+// every payload that is cut short must be rejected rather than decoded with default fields
+template<class DecodeF>
+void checkTruncations(std::span<const std::byte> payload, DecodeF decode, std::string_view description)
+{
+    for(size_t size = 0; size < payload.size(); ++size)
+    {
+        const auto result = decode(payload.first(size));
+
+        if(result || result.error() != std::errc::bad_message)
+        {
+            check(false, std::string(description) + " truncated to " + std::to_string(size) + " bytes is rejected");
+        }
+    }
+}
+
+void testRequestRoundTrip()
+{
+    const CompileServerRequest request = makeRequest();
+
+    std::vector<std::byte> frame;
+    encodeCompileServerRequest(request, frame);
+
+    const std::span<const std::byte> payload = framePayload(frame, "request");
+    const tl::expected<CompileServerRequest, std::errc> decoded = decodeCompileServerRequest(payload);
+
+    check(decoded.has_value(), "a request decodes");
+
+    if(decoded)
+    {
+        check(decoded->sourceKind == request.sourceKind, "the request's source kind survives");
+        check(decoded->arguments == request.arguments, "the request's arguments survive");
+        check(decoded->sourceName == request.sourceName, "the request's source name survives");
+        check(decoded->source == request.source, "the request's source survives");
+        check(decoded->maxMessageCount == request.maxMessageCount, "the request's message limit survives");
+
+        for(size_t index = 0; index < request.artifacts.size(); ++index)
+        {
+            check(decoded->artifacts[index].sinkType == request.artifacts[index].sinkType &&
+                      decoded->artifacts[index].path == request.artifacts[index].path,
+                  "the request's artifact sinks survive");
+        }
+    }
+
+    checkTruncations(payload, decodeCompileServerRequest, "a request");
+
+    std::vector<std::byte> extendedPayload(payload.begin(), payload.end());
+    extendedPayload.push_back(std::byte(0));
+    check(!decodeCompileServerRequest(extendedPayload), "a request with trailing bytes is rejected");
+}
+
+void testResponseRoundTrip()
+{
+    const CompileServerResponse response = makeResponse();
+
+    std::vector<std::byte> frame;
+    encodeCompileServerResponse(response, frame);
+
+    const std::span<const std::byte> payload = framePayload(frame, "response");
+    const tl::expected<CompileServerResponse, std::errc> decoded = decodeCompileServerResponse(payload);
+
+    check(decoded.has_value(), "a response decodes");
+
+    if(decoded)
+    {
+        check(decoded->error == response.error, "the response's error survives");
+        check(decoded->returnCode == response.returnCode, "the response's return code survives");
+        check(equalMessages(decoded->messages, response.messages), "the response's messages survive");
+        check(decoded->artifacts == response.artifacts, "the response's artifacts survive");
+    }
+
+    checkTruncations(payload, decodeCompileServerResponse, "a response");
+}
+
+void testFrameSize()
+{
+    constexpr std::array<std::byte, kFrameHeaderSize> kEmptyFrame = {};
+    constexpr std::array<std::byte, kFrameHeaderSize> kLargestFrame = {
+        std::byte(0x00), std::byte(0x00), std::byte(0x00), std::byte(0x40)};
+    constexpr std::array<std::byte, kFrameHeaderSize> kOversizedFrame = {
+        std::byte(0x01), std::byte(0x00), std::byte(0x00), std::byte(0x40)};
+
+    check(decodeFrameSize(kEmptyFrame) == 0u, "an empty frame has a size of 0");
+    check(decodeFrameSize(kLargestFrame) == kMaxCompileServerFrameSize, "a frame of the maximum size is accepted");
+    check(!decodeFrameSize(kOversizedFrame).has_value(), "a frame over the maximum size is refused");
+}
+
+void testCorruptCount()
+{
+    CompileServerRequest request = makeRequest();
+    request.arguments.clear();
+
+    std::vector<std::byte> frame;
+    encodeCompileServerRequest(request, frame);
+
+    // the argument count follows the 1-byte source kind, a count the payload cannot hold must fail before allocating
+    std::vector<std::byte> payload(frame.begin() + kFrameHeaderSize, frame.end());
+    payload[1] = std::byte(0xff);
+    payload[2] = std::byte(0xff);
+    payload[3] = std::byte(0xff);
+    payload[4] = std::byte(0xff);
+
+    check(!decodeCompileServerRequest(payload), "a request with an argument count larger than the frame is rejected");
+}
+} // namespace
+
+int main()
+{
+    testRequestRoundTrip();
+    testResponseRoundTrip();
+    testFrameSize();
+    testCorruptCount();
+
+    return (gFailureCount == 0) ? 0 : 1;
+}
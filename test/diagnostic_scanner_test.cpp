@@ -0,0 +1,101 @@
+#include "diagnostic_scanner.h"
+
+#include <array>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace shadercompile::detail;
+
+// Checks that the SIMD diagnostic scanners find the same spans as the scalar one. The inputs put newlines, colons and
+// indentation on both sides of the 64-byte block boundaries and into the tail that is scanned one byte at a time.
+
+namespace
+{
+constexpr size_t kBlockSize = 64;
+constexpr size_t kMaxRandomSize = 4 * kBlockSize + 16;
+constexpr int kRandomInputsPerSize = 64;
+
+constexpr std::array<DiagnosticScanner, 2> kSimdScanners = {DiagnosticScanner::Sse2, DiagnosticScanner::Neon};
+
+int gFailureCount = 0;
+
+bool equalSpans(const DiagnosticSpans& left, const DiagnosticSpans& right)
+{
+    return left.messageOffsets == right.messageOffsets && left.messageSizes == right.messageSizes &&
+           left.colonStarts == right.colonStarts && left.colonOffsets == right.colonOffsets;
+}
+
+void checkScanners(std::string_view output)
+{
+    DiagnosticSpans scalarSpans;
+    scanDiagnostics(output, scalarSpans, DiagnosticScanner::Scalar);
+
+    for(const DiagnosticScanner scanner : kSimdScanners)
+    {
+        // a scanner the build does not support falls back to the scalar one, which then trivially matches
+        DiagnosticSpans simdSpans;
+        scanDiagnostics(output, simdSpans, scanner);
+
+        if(equalSpans(scalarSpans, simdSpans)) { continue; }
+
+        std::cout << "FAILED: " << ((scanner == DiagnosticScanner::Sse2) ? "sse2" : "neon")
+                  << " scanner differs from the scalar one for a " << output.size() << " byte output" << std::endl;
+        ++gFailureCount;
+    }
+}
+
+// a single newline, colon or indented line start at every offset around the block boundaries
+void testBlockBoundaries()
+{
+    constexpr std::array<std::string_view, 4> kMarkers = {"\n", ":", "\n  ", "\r\n"};
+
+    for(size_t offset = 0; offset <= 2 * kBlockSize + 2; ++offset)
+    {
+        for(const std::string_view marker : kMarkers)
+        {
+            for(size_t tailSize = 0; tailSize < 3; ++tailSize)
+            {
+                std::string output(offset, 'a');
+                output += marker;
+                output.append(tailSize, 'b');
+
+                checkScanners(output);
+            }
+        }
+    }
+}
+
+// outputs of every size up to a few blocks, made mostly of the bytes the scanners look for
+void testRandomOutputs()
+{
+    constexpr std::string_view kAlphabet = "\n\n::  \ra";
+
+    std::mt19937 random(0x5eed);
+    std::uniform_int_distribution<size_t> characterIndex(0, kAlphabet.size() - 1);
+
+    for(size_t size = 0; size <= kMaxRandomSize; ++size)
+    {
+        for(int input = 0; input < kRandomInputsPerSize; ++input)
+        {
+            std::string output(size, '\0');
+
+            for(char& character : output)
+            {
+                character = kAlphabet[characterIndex(random)];
+            }
+
+            checkScanners(output);
+        }
+    }
+}
+} // namespace
+
+int main()
+{
+    testBlockBoundaries();
+    testRandomOutputs();
+
+    return (gFailureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#include <dxcapi.h>
+
+// Stands in for libdxcompiler.so in shadercompile_library_loader_test. It creates no objects and counts how often it
+// was asked to.
+
+namespace
+{
+int gCreateInstanceCallCount = 0;
+}
+
+extern "C" __attribute__((visibility("default"))) HRESULT DxcCreateInstance(REFCLSID /*rclsid*/,
+                                                                            REFIID /*riid*/,
+                                                                            LPVOID* ppv)
+{
+    ++gCreateInstanceCallCount;
+    *ppv = nullptr;
+    return E_NOINTERFACE;
+}
+
+extern "C" __attribute__((visibility("default"))) int shadercompileStubCreateInstanceCallCount()
+{
+    return gCreateInstanceCallCount;
+}
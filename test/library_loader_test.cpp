@@ -0,0 +1,89 @@
+#include <shadercompile/dxc_library_compiler.h>
+
+#include <dlfcn.h>
+
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <string_view>
+
+using namespace shadercompile;
+
+// Points DxcLibraryCompiler at a stub libdxcompiler.so and checks that it is only loaded by the first compile, that a
+// library that cannot be loaded fails the compile, and that the library path is fixed once it was loaded.
+//
+// usage: shadercompile_library_loader_test <path of the stub libdxcompiler.so>
+
+namespace
+{
+using CallCountProc = int (*)();
+
+int gFailureCount = 0;
+
+void check(bool condition, std::string_view description)
+{
+    if(condition) { return; }
+
+    std::cout << "FAILED: " << description << std::endl;
+    ++gFailureCount;
+}
+
+bool isLoaded(const std::filesystem::path& libraryPath)
+{
+    void* library = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_NOLOAD);
+
+    if(library == nullptr) { return false; }
+
+    dlclose(library);
+    return true;
+}
+
+tl::expected<CompileSummary, std::errc> compileEmptySource(DxcLibraryCompiler& compiler)
+{
+    return compiler.compileFromBuffer(std::span<const std::byte>(), std::string_view("empty.hlsl"));
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cout << "usage: shadercompile_library_loader_test <path of the stub libdxcompiler.so>" << std::endl;
+        return 1;
+    }
+
+    const std::filesystem::path stubPath = std::filesystem::absolute(argv[1]);
+    const std::filesystem::path missingPath = stubPath.parent_path() / "libdxcompiler_missing.so";
+
+    DxcLibraryCompiler compiler;
+
+    check(DxcLibraryCompiler::setLibraryPath(missingPath), "the library path can be set before the first compile");
+
+    const tl::expected<CompileSummary, std::errc> missingResult = compileEmptySource(compiler);
+
+    check(!missingResult && missingResult.error() == std::errc::state_not_recoverable,
+          "a compile fails when the library cannot be loaded");
+    check(!isLoaded(stubPath), "the stub is not loaded before a compile asks for it");
+
+    check(DxcLibraryCompiler::setLibraryPath(stubPath), "the library path can be set after a failed load");
+
+    const tl::expected<CompileSummary, std::errc> stubResult = compileEmptySource(compiler);
+
+    check(!stubResult && stubResult.error() == std::errc::state_not_recoverable,
+          "a compile fails when the library creates no compiler");
+    check(isLoaded(stubPath), "the first compile loads the library");
+
+    if(void* library = dlopen(stubPath.c_str(), RTLD_NOW | RTLD_NOLOAD); library != nullptr)
+    {
+        const auto callCount =
+            reinterpret_cast<CallCountProc>(dlsym(library, "shadercompileStubCreateInstanceCallCount"));
+
+        check(callCount != nullptr && callCount() > 0, "the compile creates its instances through DxcCreateInstance");
+
+        dlclose(library);
+    }
+
+    check(!DxcLibraryCompiler::setLibraryPath(missingPath), "the library path cannot change once it was loaded");
+
+    return (gFailureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+
+// The child that shadercompile_process_test runs.
+//
+// usage: shadercompile_process_stub print <text> <exit code>
+//        shadercompile_process_stub sleep <milliseconds>
+//        shadercompile_process_stub close-output-and-sleep <milliseconds>
+
+int main(int argc, char** argv)
+{
+    if(argc < 3) { return 100; }
+
+    const std::string_view mode = argv[1];
+
+    if(mode == "print" && argc > 3)
+    {
+        std::fputs(argv[2], stdout);
+        std::fflush(stdout);
+        return std::atoi(argv[3]);
+    }
+
+    const std::chrono::milliseconds duration(std::atoi(argv[2]));
+
+    if(mode == "sleep")
+    {
+        std::this_thread::sleep_for(duration);
+        return 0;
+    }
+
+    if(mode == "close-output-and-sleep")
+    {
+        // the parent sees the end of the output long before the child exits
+        std::fclose(stdout);
+        std::fclose(stderr);
+        std::this_thread::sleep_for(duration);
+        return 0;
+    }
+
+    return 100;
+}
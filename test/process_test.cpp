@@ -0,0 +1,135 @@
+#include "process.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+using namespace shadercompile;
+using namespace std::chrono_literals;
+
+// Runs shadercompile_process_stub through Process and checks the exit codes, the output and the timeout.
+//
+// usage: shadercompile_process_test <path of shadercompile_process_stub>
+
+namespace
+{
+// long enough that a test only passes if the child was killed
+constexpr std::chrono::milliseconds kStubSleep = 20s;
+constexpr std::chrono::milliseconds kTimeout = 300ms;
+constexpr std::chrono::milliseconds kTimeoutTolerance = 5s;
+
+int gFailureCount = 0;
+
+void check(bool condition, std::string_view description)
+{
+    if(condition) { return; }
+
+    std::cout << "FAILED: " << description << std::endl;
+    ++gFailureCount;
+}
+
+std::string_view outputText(const Process& process)
+{
+    const std::span<const std::byte> output = process.output();
+    return std::string_view(reinterpret_cast<const char*>(output.data()), output.size());
+}
+
+void testExitCodeAndOutput(const std::filesystem::path& stubPath)
+{
+    Process process(stubPath);
+    process.addArgument(std::string_view("print"));
+    process.addArgument(std::string_view("hello"));
+    process.addArgument(std::string_view("3"));
+
+    const tl::expected<int, std::errc> result = process.execute();
+
+    check(result.has_value() && result.value() == 3, "execute() returns the exit code of the child");
+    check(outputText(process) == "hello", "execute() reads the output of the child");
+    check(process.termination() == ProcessTermination::Exited, "a child that exits on its own is not reported killed");
+}
+
+void testTimeout(const std::filesystem::path& stubPath, std::string_view mode)
+{
+    Process process(stubPath);
+    process.addArgument(mode);
+    process.addArgument(std::to_string(kStubSleep.count()));
+    process.setLimits(ProcessLimits{.wallClockTimeout = kTimeout});
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const tl::expected<int, std::errc> result = process.execute();
+    const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+    const std::string description(mode);
+    check(result.has_value(), description + ": execute() returns the exit code of the killed child");
+    check(process.termination() == ProcessTermination::TimedOut, description + ": the child is reported timed out");
+    check(elapsed >= kTimeout && elapsed < kTimeout + kTimeoutTolerance,
+          description + ": the child is killed once the timeout expires");
+}
+
+void testMove(const std::filesystem::path& stubPath)
+{
+    Process process(stubPath);
+    process.addArgument(std::string_view("print"));
+    process.addArgument(std::string_view("moved"));
+    process.addArgument(std::string_view("5"));
+
+    Process movedProcess;
+    movedProcess = std::move(process);
+
+    const tl::expected<int, std::errc> result = movedProcess.execute();
+
+    check(result.has_value() && result.value() == 5, "a moved process runs its child");
+    check(outputText(movedProcess) == "moved", "a moved process reads the output of its child");
+
+#ifndef _WIN32
+    // the child and its output belong to the process it was moved to, destroying the moved-from one must not touch them
+    std::optional<Process> startedProcess(std::in_place, stubPath);
+    startedProcess->addArgument(std::string_view("print"));
+    startedProcess->addArgument(std::string_view("started"));
+    startedProcess->addArgument(std::string_view("7"));
+
+    check(startedProcess->start().has_value(), "start() spawns the child");
+
+    Process ownerProcess(std::move(startedProcess.value()));
+    startedProcess.reset();
+
+    while(ownerProcess.readChildOutput())
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    std::optional<tl::expected<int, std::errc>> reapResult;
+
+    while(!(reapResult = ownerProcess.tryReap()))
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    check(reapResult->has_value() && reapResult->value() == 7, "a started process reaps its child after a move");
+    check(outputText(ownerProcess) == "started", "a started process reads the output of its child after a move");
+#endif
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::cout << "usage: shadercompile_process_test <path of shadercompile_process_stub>" << std::endl;
+        return 1;
+    }
+
+    const std::filesystem::path stubPath = argv[1];
+
+    testExitCodeAndOutput(stubPath);
+    testTimeout(stubPath, "sleep");
+    testTimeout(stubPath, "close-output-and-sleep");
+    testMove(stubPath);
+
+    return (gFailureCount == 0) ? 0 : 1;
+}
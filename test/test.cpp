@@ -106,6 +106,7 @@ void compileShader(ICompiler& compiler, std::string_view shaderSource)
 
 int main(int /*argc*/, char** /*argv*/)
 {
+#ifdef _WIN32
     DxcReleaseManager releaseManager("");
     releaseManager.downloadLatestRelease();
 
@@ -113,6 +114,10 @@ int main(int /*argc*/, char** /*argv*/)
         releaseManager.getReleaseDirectory(releaseManager.getLastestReleaseVersion().value());
 
     DxcExternalCompiler compiler(dxcDirectory / "bin/x64/dxc.exe");
+#else
+    // releases are only downloaded on Windows, elsewhere dxc is looked up on the PATH
+    DxcExternalCompiler compiler(std::filesystem::path("dxc"));
+#endif
     //DxcLibraryCompiler compiler;
     {
         compiler.setTargetProfile(DxcTargetProfile::vs_6_7);